@@ -0,0 +1,547 @@
+/*
+  ==============================================================================
+
+    BenchmarkMain.cpp
+    Created: 22 Oct 2026 6:21:09pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <cairo/cairo-pdf.h>
+#include "../../Source/PdfPageRenderer.h"
+#include "../../Source/PageImageCache.h"
+#include "../../Source/MarkerTimeline.h"
+#include "../../Source/MarkerSlider.h"
+#include "../../Source/AudioDeckPlayer.h"
+#include "../../Source/MultiStemAudioSource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+// 热点路径的基准测试：PDF 栅格化、Cairo -> juce::Image 转换、波形峰值、标记查找、音频回调和 16 轨混音回调。
+// 用到的 PDF 和音频都在运行时按固定的随机种子生成，每次运行的输入完全一样。
+// 结果以 JSON 输出（每项的百分位数，单位微秒），用来比较 JUCE / Poppler 升级前后的差别：
+//   benchmarks [--iterations N] [--filter 名称片段] [--output results.json]
+namespace
+{
+    struct Options
+    {
+        int iterations = 50;
+        juce::String filter;
+        juce::File outputFile;
+    };
+
+    class BenchmarkRunner
+    {
+    public:
+        explicit BenchmarkRunner(const Options& optionsToUse) : options(optionsToUse) {}
+
+        // 先跑几次预热，再计时 iterations 次；itemsPerIteration 用来换算每一项的耗时，
+        // setup 在每次之前调用，不计时
+        void measure(const juce::String& name, int iterations, const std::function<void()>& body, int itemsPerIteration = 1,
+                     const std::function<void()>& setup = {})
+        {
+            if (options.filter.isNotEmpty() && !name.contains(options.filter))
+                return;
+
+            for (int i = 0; i < std::min(3, iterations); ++i)
+            {
+                if (setup)
+                    setup();
+                body();
+            }
+
+            std::vector<double> samples;
+            samples.reserve(static_cast<size_t>(iterations));
+
+            for (int i = 0; i < iterations; ++i)
+            {
+                if (setup)
+                    setup();
+
+                const double start = juce::Time::getMillisecondCounterHiRes();
+                body();
+                samples.push_back((juce::Time::getMillisecondCounterHiRes() - start) * 1000.0 / itemsPerIteration);
+            }
+
+            std::sort(samples.begin(), samples.end());
+
+            auto* result = new juce::DynamicObject();
+            result->setProperty("name", name);
+            result->setProperty("unit", "us");
+            result->setProperty("iterations", iterations);
+            result->setProperty("itemsPerIteration", itemsPerIteration);
+            result->setProperty("min", samples.front());
+            result->setProperty("p50", percentile(samples, 0.50));
+            result->setProperty("p90", percentile(samples, 0.90));
+            result->setProperty("p99", percentile(samples, 0.99));
+            result->setProperty("max", samples.back());
+            result->setProperty("mean", std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size());
+            results.add(juce::var(result));
+
+            std::cerr << name << ": p50 " << percentile(samples, 0.50) << " us" << std::endl;
+        }
+
+        juce::var toJson() const
+        {
+            auto* root = new juce::DynamicObject();
+            root->setProperty("juceVersion", juce::SystemStats::getJUCEVersion());
+            root->setProperty("popplerVersion", juce::String(poppler_get_version()));
+            root->setProperty("cairoVersion", juce::String(cairo_version_string()));
+            root->setProperty("cpu", juce::SystemStats::getCpuModel());
+            root->setProperty("numCpus", juce::SystemStats::getNumCpus());
+            root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+            root->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+            root->setProperty("results", results);
+            return juce::var(root);
+        }
+
+        int getIterations(int scale = 1) const { return std::max(1, options.iterations / scale); }
+
+    private:
+        // 最近秩法
+        static double percentile(const std::vector<double>& sorted, double fraction)
+        {
+            const auto rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+            return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+        }
+
+        Options options;
+        juce::Array<juce::var> results;
+    };
+
+    //==============================================================================
+    // 生成一份像乐谱的 PDF：每页十行五线谱，随机的符头、符干和小节线，再加标题文字
+    bool writeSyntheticScore(const juce::File& file, int numPages)
+    {
+        constexpr double pageWidth = 595.0, pageHeight = 842.0;  // A4，单位是点
+        cairo_surface_t* surface = cairo_pdf_surface_create(file.getFullPathName().toRawUTF8(), pageWidth, pageHeight);
+        if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
+        {
+            cairo_surface_destroy(surface);
+            return false;
+        }
+
+        cairo_t* cr = cairo_create(surface);
+        juce::Random random(0x5eed);
+
+        for (int page = 0; page < numPages; ++page)
+        {
+            cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+            cairo_paint(cr);
+            cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+
+            cairo_select_font_face(cr, "serif", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_BOLD);
+            cairo_set_font_size(cr, 18.0);
+            cairo_move_to(cr, 200.0, 50.0);
+            cairo_show_text(cr, ("Synthetic Etude - page " + juce::String(page + 1)).toRawUTF8());
+
+            for (int staff = 0; staff < 10; ++staff)
+            {
+                const double top = 90.0 + staff * 74.0;
+                cairo_set_line_width(cr, 0.6);
+
+                for (int line = 0; line < 5; ++line)
+                {
+                    cairo_move_to(cr, 40.0, top + line * 6.0);
+                    cairo_line_to(cr, pageWidth - 40.0, top + line * 6.0);
+                }
+                cairo_stroke(cr);
+
+                for (double x = 60.0; x < pageWidth - 50.0; x += 14.0 + random.nextInt(10))
+                {
+                    const double y = top - 6.0 + random.nextInt(13) * 3.0;
+
+                    cairo_save(cr);
+                    cairo_translate(cr, x, y);
+                    cairo_rotate(cr, -0.35);
+                    cairo_scale(cr, 4.2, 3.0);
+                    cairo_arc(cr, 0.0, 0.0, 1.0, 0.0, juce::MathConstants<double>::twoPi);
+                    cairo_restore(cr);
+                    cairo_fill(cr);
+
+                    cairo_set_line_width(cr, 0.9);
+                    cairo_move_to(cr, x + 3.8, y);
+                    cairo_line_to(cr, x + 3.8, y - 20.0);
+                    cairo_stroke(cr);
+
+                    if (random.nextInt(8) == 0)
+                    {
+                        cairo_set_line_width(cr, 1.0);
+                        cairo_move_to(cr, x + 9.0, top);
+                        cairo_line_to(cr, x + 9.0, top + 24.0);
+                        cairo_stroke(cr);
+                    }
+                }
+            }
+
+            cairo_show_page(cr);
+        }
+
+        cairo_destroy(cr);
+        cairo_surface_finish(surface);
+        const bool succeeded = cairo_surface_status(surface) == CAIRO_STATUS_SUCCESS;
+        cairo_surface_destroy(surface);
+        return succeeded;
+    }
+
+    // 生成一段立体声的测试音频：几个泛音加上带包络的噪声
+    juce::AudioBuffer<float> createSyntheticAudio(double sampleRate, double seconds)
+    {
+        const int numSamples = static_cast<int>(sampleRate * seconds);
+        juce::AudioBuffer<float> buffer(2, numSamples);
+        juce::Random random(0xa0d10);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const double t = i / sampleRate;
+            const double envelope = std::exp(-6.0 * std::fmod(t, 0.5));
+            const double tone = 0.3 * std::sin(juce::MathConstants<double>::twoPi * 220.0 * t)
+                              + 0.1 * std::sin(juce::MathConstants<double>::twoPi * 660.0 * t);
+            const double noise = 0.2 * envelope * (random.nextDouble() * 2.0 - 1.0);
+
+            buffer.setSample(0, i, static_cast<float>(tone + noise));
+            buffer.setSample(1, i, static_cast<float>(tone * 0.8 - noise));
+        }
+
+        return buffer;
+    }
+
+    std::vector<Marker> createMarkers(int numMarkers, double lengthSeconds, int numPages)
+    {
+        std::vector<Marker> markers;
+        markers.reserve(static_cast<size_t>(numMarkers));
+
+        for (int i = 0; i < numMarkers; ++i)
+        {
+            Marker marker(lengthSeconds * (i + 1) / (numMarkers + 1));
+
+            // 混入跳页、半页翻和保持，和实际的反复记号差不多
+            if (i % 17 == 16)
+                marker.targetPage = (i / 17) % numPages;
+            else if (i % 11 == 10)
+                marker.action = MarkerAction::halfTurn;
+            else if (i % 13 == 12)
+                marker.action = MarkerAction::hold;
+
+            markers.push_back(marker);
+        }
+
+        return markers;
+    }
+
+    //==============================================================================
+    void benchmarkRendering(BenchmarkRunner& runner, const juce::File& pdfFile)
+    {
+        PopplerDocument* document = openPdfDocument(pdfFile);
+        if (document == nullptr)
+        {
+            std::cerr << "Could not open the synthetic score" << std::endl;
+            return;
+        }
+
+        const int numPages = poppler_document_get_n_pages(document);
+        double pageWidth = 0.0, pageHeight = 0.0;
+        PopplerPage* firstPage = poppler_document_get_page(document, 0);
+        poppler_page_get_size(firstPage, &pageWidth, &pageHeight);
+        g_object_unref(firstPage);
+
+        for (int dpi : { 72, 150, 300 })
+        {
+            const int maxWidth = juce::roundToInt(pageWidth * dpi / 72.0);
+            const int maxHeight = juce::roundToInt(pageHeight * dpi / 72.0);
+            int pageIndex = 0;
+
+            // 和 renderPdfPageToComponent 缓存未命中时一样：取页面、Poppler 渲染、转换成 juce::Image
+            runner.measure("render/poppler_" + juce::String(dpi) + "dpi", runner.getIterations(dpi >= 300 ? 5 : 1), [&]
+            {
+                PopplerPage* page = poppler_document_get_page(document, pageIndex++ % numPages);
+                auto image = renderPdfPageToImage(page, maxWidth, maxHeight);
+                g_object_unref(page);
+                jassert(image.isValid());
+            });
+
+            // Cairo ARGB32 surface 复制成 juce::Image
+            PopplerPage* page = poppler_document_get_page(document, 0);
+            const auto size = getFittedPageSize(pageWidth, pageHeight, maxWidth, maxHeight);
+            cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size.getWidth(), size.getHeight());
+            cairo_t* cr = cairo_create(surface);
+            cairo_scale(cr, size.getWidth() / pageWidth, size.getWidth() / pageWidth);
+            poppler_page_render(page, cr);
+            cairo_destroy(cr);
+            g_object_unref(page);
+
+            runner.measure("convert/cairo_to_image_" + juce::String(dpi) + "dpi", runner.getIterations(), [surface]
+            {
+                auto image = convertCairoSurfaceToImage(surface);
+                jassert(image.isValid());
+            });
+
+            cairo_surface_destroy(surface);
+        }
+
+        // 缓存命中时：从 300 DPI 的栅格缩小到窗口大小和预览大小
+        PageImageCache cache;
+        PopplerPage* page = poppler_document_get_page(document, 0);
+        cache.addRaster(0, renderPdfPageToImage(page, juce::roundToInt(pageWidth * 300.0 / 72.0), juce::roundToInt(pageHeight * 300.0 / 72.0)));
+        g_object_unref(page);
+        int width = 700;
+
+        runner.measure("render/cache_downscale", runner.getIterations(), [&]
+        {
+            // 每次换一个尺寸，避免命中缓存里已经缩放好的图
+            width = width >= 900 ? 700 : width + 1;
+            auto lookup = cache.getImageFor(0, width, 2000);
+            jassert(!lookup.needsRender);
+        });
+
+        g_object_unref(document);
+    }
+
+    void benchmarkPeaks(BenchmarkRunner& runner, const juce::AudioBuffer<float>& audio, double sampleRate)
+    {
+        juce::AudioFormatManager formatManager;
+        juce::AudioThumbnailCache thumbnailCache(1);
+
+        // 和批处理模式一样：按 65536 个样本一块交给 AudioThumbnail
+        runner.measure("peaks/build_" + juce::String(audio.getNumSamples() / sampleRate, 0) + "s", runner.getIterations(5), [&]
+        {
+            juce::AudioThumbnail thumbnail(512, formatManager, thumbnailCache);
+            thumbnail.reset(audio.getNumChannels(), sampleRate, audio.getNumSamples());
+
+            constexpr int blockSize = 65536;
+            for (int position = 0; position < audio.getNumSamples(); position += blockSize)
+            {
+                const int numSamples = std::min(blockSize, audio.getNumSamples() - position);
+                juce::AudioBuffer<float> block(const_cast<float* const*>(audio.getArrayOfReadPointers()), audio.getNumChannels(), position, numSamples);
+                thumbnail.addBlock(position, block, 0, numSamples);
+            }
+
+            jassert(thumbnail.isFullyLoaded());
+        });
+    }
+
+    void benchmarkMarkers(BenchmarkRunner& runner)
+    {
+        constexpr double lengthSeconds = 600.0;
+        constexpr int numPages = 40;
+        constexpr int lookupsPerIteration = 1000;
+
+        for (int numMarkers : { 10, 100, 1000, 10000 })
+        {
+            const auto markers = createMarkers(numMarkers, lengthSeconds, numPages);
+            const juce::String suffix = "_" + juce::String(numMarkers);
+
+            MarkerTimeline timeline;
+            runner.measure("markers/timeline_rebuild" + suffix, runner.getIterations(), [&] { timeline.rebuild(markers, numPages); });
+
+            // 每个定时器回调做一次的查找，用 1000 个不同的位置
+            juce::Random random(numMarkers);
+            std::vector<double> positions(lookupsPerIteration);
+            for (auto& position : positions)
+                position = random.nextDouble() * lengthSeconds;
+
+            int checksum = 0;
+            runner.measure("markers/timeline_lookup" + suffix, runner.getIterations(), [&]
+            {
+                for (double position : positions)
+                    checksum += timeline.getViewForPosition(position).page;
+            }, lookupsPerIteration);
+
+            runner.measure("markers/upcoming_pages" + suffix, runner.getIterations(), [&]
+            {
+                for (double position : positions)
+                    checksum += static_cast<int>(timeline.getUpcomingPages(position, 4).size());
+            }, lookupsPerIteration);
+
+            // 滑块每次播放位置变化时更新已触发的标记
+            MarkerSlider slider;
+            slider.setRange(0.0, lengthSeconds, 0.1);
+            for (const auto& marker : markers)
+                slider.addMarker(marker);
+
+            double position = 0.0;
+            runner.measure("markers/slider_update_triggered" + suffix, runner.getIterations(), [&]
+            {
+                for (int i = 0; i < 100; ++i)
+                {
+                    position = std::fmod(position + 0.03, lengthSeconds);
+                    slider.updateTriggeredMarkers(position);
+                }
+            }, 100);
+
+            juce::ignoreUnused(checksum);
+        }
+    }
+
+    // 生成的音频先写成内存里的 WAV，走和播放时一样的解码路径
+    juce::MemoryBlock writeWav(const juce::AudioBuffer<float>& audio, double sampleRate)
+    {
+        juce::MemoryBlock wavData;
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(new juce::MemoryOutputStream(wavData, false),
+                                                                            sampleRate, 2, 24, {}, 0));
+        writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples());
+        writer.reset();
+        return wavData;
+    }
+
+    void benchmarkAudioCallback(BenchmarkRunner& runner, const juce::MemoryBlock& wavData, double sampleRate)
+    {
+        for (int blockSize : { 64, 256, 1024 })
+        {
+            for (double tempo : { 1.0, 0.75 })
+            {
+                juce::WavAudioFormat wav;
+                std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(new juce::MemoryInputStream(wavData, false), true));
+
+                AudioDeckPlayer player;
+                player.prepareToPlay(blockSize, sampleRate);
+                player.setTempo(tempo);
+                player.swapTo(AudioDeck::create(std::move(reader), blockSize, sampleRate));
+                player.start();
+
+                juce::AudioBuffer<float> output(2, blockSize);
+                const juce::AudioSourceChannelInfo info(&output, 0, blockSize);
+                const double lengthSeconds = player.getLengthInSeconds();
+
+                // 音频线程在第一个回调里取走新的 deck
+                player.getNextAudioBlock(info);
+
+                runner.measure("audio/callback_" + juce::String(blockSize) + "_tempo" + juce::String(tempo, 2),
+                               runner.getIterations() * 20, [&]
+                {
+                    if (player.getCurrentPosition() > lengthSeconds - 1.0)
+                        player.setPosition(0.0);
+
+                    player.getNextAudioBlock(info);
+                });
+
+                player.releaseResources();
+            }
+        }
+    }
+
+    // 最多 16 轨同时播放时的回调：各轨从预读缓冲读取再按增益混音。
+    // 每次计时之前等预读线程把接下来的数据准备好，所以计的只是音频线程上的读取+混音，不含后台解码
+    void benchmarkMultiStemCallback(BenchmarkRunner& runner, const juce::MemoryBlock& wavData, double sampleRate)
+    {
+        constexpr int numStems = MultiStemAudioSource::maxStems;
+
+        for (int blockSize : { 64, 256, 1024 })
+        {
+            AudioDeckPlayer player;
+            player.prepareToPlay(blockSize, sampleRate);
+
+            std::vector<std::unique_ptr<juce::AudioFormatReader>> readers;
+            juce::Array<juce::File> stemFiles;
+            juce::WavAudioFormat wav;
+
+            for (int i = 0; i < numStems; ++i)
+            {
+                readers.emplace_back(wav.createReaderFor(new juce::MemoryInputStream(wavData, false), true));
+                stemFiles.add(juce::File::getCurrentWorkingDirectory().getChildFile("stem" + juce::String(i + 1) + ".wav"));
+            }
+
+            player.swapTo(AudioDeck::createMultiStem(std::move(readers), stemFiles, player.getReadAheadThread(), blockSize, sampleRate));
+            player.start();
+
+            juce::AudioBuffer<float> output(2, blockSize);
+            const juce::AudioSourceChannelInfo info(&output, 0, blockSize);
+            const double lengthSeconds = player.getLengthInSeconds();
+
+            // 音频线程在第一个回调里取走新的 deck
+            player.getNextAudioBlock(info);
+            auto* stems = player.getCurrentStems();
+            jassert(stems != nullptr && stems->getNumStems() == numStems);
+
+            runner.measure("audio/stems" + juce::String(numStems) + "_callback_" + juce::String(blockSize) + "_" + juce::String(sampleRate / 1000.0, 0) + "k",
+                           runner.getIterations() * 20, [&]
+            {
+                player.getNextAudioBlock(info);
+            }, 1, [&]
+            {
+                if (player.getCurrentPosition() > lengthSeconds - 1.0)
+                    player.setPosition(0.0);
+
+                if (!stems->waitUntilReadAheadReady(blockSize * 2, 2000))
+                    std::cerr << "Stem read-ahead did not catch up" << std::endl;
+            });
+
+            player.releaseResources();
+        }
+    }
+
+    Options parseOptions(const juce::StringArray& arguments)
+    {
+        Options options;
+
+        const int iterationsIndex = arguments.indexOf("--iterations");
+        if (iterationsIndex >= 0)
+            options.iterations = std::max(1, arguments[iterationsIndex + 1].getIntValue());
+
+        const int filterIndex = arguments.indexOf("--filter");
+        if (filterIndex >= 0)
+            options.filter = arguments[filterIndex + 1];
+
+        const int outputIndex = arguments.indexOf("--output");
+        if (outputIndex >= 0)
+            options.outputFile = juce::File::getCurrentWorkingDirectory().getChildFile(arguments[outputIndex + 1]);
+
+        return options;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    // MarkerSlider 和 AudioDeckPlayer 需要消息线程
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray arguments;
+    for (int i = 1; i < argc; ++i)
+        arguments.add(juce::CharPointer_UTF8(argv[i]));
+
+    const auto options = parseOptions(arguments);
+    BenchmarkRunner runner(options);
+
+    juce::TemporaryFile scoreFile(".pdf");
+    if (!writeSyntheticScore(scoreFile.getFile(), 8))
+    {
+        std::cerr << "Failed to generate the synthetic score" << std::endl;
+        return 1;
+    }
+
+    constexpr double sampleRate = 48000.0;
+    const auto audio = createSyntheticAudio(sampleRate, 60.0);
+    const auto wavData = writeWav(audio, sampleRate);
+
+    benchmarkRendering(runner, scoreFile.getFile());
+    benchmarkPeaks(runner, audio, sampleRate);
+    benchmarkMarkers(runner);
+    benchmarkAudioCallback(runner, wavData, sampleRate);
+    benchmarkMultiStemCallback(runner, wavData, sampleRate);
+
+    const auto json = juce::JSON::toString(runner.toJson());
+
+    if (options.outputFile != juce::File{})
+    {
+        if (!options.outputFile.replaceWithText(json))
+        {
+            std::cerr << "Failed to write " << options.outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+/*
+  ==============================================================================
+
+    ActivityMeter.cpp
+    Created: 23 Oct 2026 9:41:25pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "ActivityMeter.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#else
+ #include <sys/resource.h>
+#endif
+
+void ActivityMeter::setPlaying(bool shouldBePlaying)
+{
+    if (shouldBePlaying == playing)
+        return;
+
+    const auto now = capture();
+    const auto rates = getRates(current, now);
+    (playing ? playingRates : idleRates) = rates;
+
+    DBG(juce::String(playing ? "Playing" : "Idle") + " for " + juce::String(rates.seconds, 1) + "s: CPU "
+        + juce::String(rates.cpuPercent, 2) + "%, " + juce::String(rates.wakeupsPerSecond, 1) + " wakeups/s, "
+        + juce::String(rates.timerCallbacksPerSecond, 1) + " timer callbacks/s, "
+        + juce::String(static_cast<juce::int64>(rates.paintedPixelsPerSecond)) + " px/s painted");
+
+    playing = shouldBePlaying;
+    current = now;
+}
+
+ActivityMeter::Snapshot ActivityMeter::capture()
+{
+    Snapshot snapshot;
+    snapshot.wallSeconds = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+    snapshot.timerCallbacks = timerCallbacks.load(std::memory_order_relaxed);
+    snapshot.paintedPixels = paintedPixels.load(std::memory_order_relaxed);
+
+   #if JUCE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    {
+        auto toSeconds = [](const FILETIME& time)
+        {
+            return static_cast<double>((static_cast<juce::uint64>(time.dwHighDateTime) << 32) | time.dwLowDateTime) / 1.0e7;
+        };
+        snapshot.cpuSeconds = toSeconds(kernel) + toSeconds(user);
+    }
+   #else
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        snapshot.cpuSeconds = static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+                            + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1.0e6;
+        snapshot.contextSwitches = static_cast<juce::int64>(usage.ru_nvcsw);
+    }
+   #endif
+
+    return snapshot;
+}
+
+ActivityMeter::Rates ActivityMeter::getRates(const Snapshot& start, const Snapshot& end)
+{
+    Rates rates;
+    rates.seconds = end.wallSeconds - start.wallSeconds;
+    if (rates.seconds <= 0.0)
+        return rates;
+
+    rates.cpuPercent = 100.0 * (end.cpuSeconds - start.cpuSeconds) / rates.seconds;
+    if (start.contextSwitches >= 0 && end.contextSwitches >= 0)
+        rates.wakeupsPerSecond = static_cast<double>(end.contextSwitches - start.contextSwitches) / rates.seconds;
+    rates.timerCallbacksPerSecond = static_cast<double>(end.timerCallbacks - start.timerCallbacks) / rates.seconds;
+    rates.paintedPixelsPerSecond = static_cast<double>(end.paintedPixels - start.paintedPixels) / rates.seconds;
+    return rates;
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    ActivityMeter.h
+    Created: 23 Oct 2026 9:41:25pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <atomic>
+
+// 分别统计空闲（没有播放）和播放时整个进程的 CPU 占用和每秒唤醒次数，用来确认空闲时真的不做事。
+// 唤醒次数是进程的自愿上下文切换（getrusage 的 ru_nvcsw，包括音频线程），平台不支持时为 -1；
+// 另外单独统计消息线程的定时器回调次数和重绘的像素数。setPlaying 在消息线程调用，note* 可以在任意线程调用。
+class ActivityMeter
+{
+public:
+    struct Rates
+    {
+        double seconds = 0.0;
+        double cpuPercent = 0.0;               // 所有线程的 CPU 时间 / 墙上时间（一个核满载是 100%）
+        double wakeupsPerSecond = -1.0;
+        double timerCallbacksPerSecond = 0.0;
+        double paintedPixelsPerSecond = 0.0;
+    };
+
+    ActivityMeter() { current = capture(); }
+
+    // 传输状态变化时调用：结束上一段（空闲或播放）的测量，开始新的一段
+    void setPlaying(bool shouldBePlaying);
+    bool isPlaying() const { return playing; }
+
+    // 最近一段已经结束的空闲 / 播放测量；还没有时 seconds 为 0
+    const Rates& getIdleRates() const { return idleRates; }
+    const Rates& getPlayingRates() const { return playingRates; }
+
+    // 当前这一段到现在为止
+    Rates getCurrentRates() const { return getRates(current, capture()); }
+
+    static void noteTimerCallback() { timerCallbacks.fetch_add(1, std::memory_order_relaxed); }
+    static void notePaint(juce::Rectangle<int> area) { paintedPixels.fetch_add(static_cast<juce::int64>(area.getWidth()) * area.getHeight(), std::memory_order_relaxed); }
+
+private:
+    struct Snapshot
+    {
+        double wallSeconds = 0.0;
+        double cpuSeconds = 0.0;
+        juce::int64 contextSwitches = -1;
+        juce::int64 timerCallbacks = 0;
+        juce::int64 paintedPixels = 0;
+    };
+
+    static Snapshot capture();
+    static Rates getRates(const Snapshot& start, const Snapshot& end);
+
+    bool playing = false;
+    Snapshot current;
+    Rates idleRates, playingRates;
+
+    static inline std::atomic<juce::int64> timerCallbacks { 0 };
+    static inline std::atomic<juce::int64> paintedPixels { 0 };
+};
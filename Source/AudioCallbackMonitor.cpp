@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    AudioCallbackMonitor.cpp
+    Created: 23 Oct 2026 2:26:41pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "AudioCallbackMonitor.h"
+
+namespace
+{
+    template <typename Type>
+    void storeMaximum(std::atomic<Type>& target, Type value)
+    {
+        auto current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+}
+
+void AudioCallbackMonitor::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate, std::memory_order_relaxed);
+    lastStartTicks.store(0, std::memory_order_relaxed);
+}
+
+void AudioCallbackMonitor::endCallback(juce::int64 startTicks, int numSamples)
+{
+    const double rate = sampleRate.load(std::memory_order_relaxed);
+    if (rate <= 0.0 || numSamples <= 0)
+        return;
+
+    const auto endTicks = juce::Time::getHighResolutionTicks();
+    const auto ticksPerSecond = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    const double deadlineTicks = numSamples / rate * ticksPerSecond;
+    const auto elapsedTicks = endTicks - startTicks;
+    const float load = static_cast<float>(static_cast<double>(elapsedTicks) / deadlineTicks);
+
+    // 块大小可能每次不同，期限按这一块算
+    deadlineMs.store(deadlineTicks * 1000.0 / ticksPerSecond, std::memory_order_relaxed);
+    numCallbacks.fetch_add(1, std::memory_order_relaxed);
+
+    if (load > 1.0f)
+        numOverruns.fetch_add(1, std::memory_order_relaxed);
+
+    const auto previousStart = lastStartTicks.exchange(startTicks, std::memory_order_relaxed);
+    if (previousStart != 0 && static_cast<double>(startTicks - previousStart) > lateFactor * deadlineTicks)
+        numLateCallbacks.fetch_add(1, std::memory_order_relaxed);
+
+    const auto bin = juce::jlimit(0, numHistogramBins - 1, static_cast<int>(load / histogramBinLoad));
+    histogram[static_cast<size_t>(bin)].fetch_add(1, std::memory_order_relaxed);
+
+    // 只有音频线程写平均值，读-改-写不需要 CAS
+    const float average = averageLoad.load(std::memory_order_relaxed);
+    averageLoad.store(average + loadSmoothing * (load - average), std::memory_order_relaxed);
+
+    storeMaximum(worstLoad, load);
+    storeMaximum(peakLoadSinceCheck, load);
+    storeMaximum(worstTicks, elapsedTicks);
+}
+
+double AudioCallbackMonitor::getWorstCallbackMs() const
+{
+    return static_cast<double>(worstTicks.load(std::memory_order_relaxed)) * 1000.0
+         / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+}
+
+std::array<juce::uint32, AudioCallbackMonitor::numHistogramBins> AudioCallbackMonitor::getHistogram() const
+{
+    std::array<juce::uint32, numHistogramBins> bins {};
+    for (size_t i = 0; i < bins.size(); ++i)
+        bins[i] = histogram[i].load(std::memory_order_relaxed);
+    return bins;
+}
+
+void AudioCallbackMonitor::setDeviceXRunCount(int count)
+{
+    if (count < 0)
+        return;
+
+    // 设备重新打开后计数会从头开始
+    if (deviceXRunBase < 0 || count < deviceXRunBase)
+        deviceXRunBase = count - deviceXRuns;
+
+    deviceXRuns = count - deviceXRunBase;
+}
+
+void AudioCallbackMonitor::reset()
+{
+    averageLoad.store(0.0f, std::memory_order_relaxed);
+    worstLoad.store(0.0f, std::memory_order_relaxed);
+    peakLoadSinceCheck.store(0.0f, std::memory_order_relaxed);
+    worstTicks.store(0, std::memory_order_relaxed);
+    numCallbacks.store(0, std::memory_order_relaxed);
+    numOverruns.store(0, std::memory_order_relaxed);
+    numLateCallbacks.store(0, std::memory_order_relaxed);
+    for (auto& bin : histogram)
+        bin.store(0, std::memory_order_relaxed);
+
+    deviceXRunBase += deviceXRuns;
+    deviceXRuns = 0;
+    problemsAtLastCheck = 0;
+}
+
+bool AudioCallbackMonitor::checkForWarning()
+{
+    const float peak = peakLoadSinceCheck.exchange(0.0f, std::memory_order_relaxed);
+    const auto problems = getNumOverruns() + getNumLateCallbacks() + static_cast<juce::uint32>(deviceXRuns);
+    const bool newProblems = problems != problemsAtLastCheck;
+    problemsAtLastCheck = problems;
+
+    if (warningThreshold <= 0.0f)
+        return false;
+
+    return newProblems || peak > warningThreshold;
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    AudioCallbackMonitor.h
+    Created: 23 Oct 2026 2:26:41pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+
+// 音频回调的负载和 xrun 监视：每次回调的耗时和它的期限（块长度 / 采样率）比较。
+// 音频线程只做几次 relaxed 的原子操作，不加锁、不分配；消息线程随时读取。
+//   负载 —— 耗时 / 期限，按 10% 一格累计直方图，最后一格是所有超过 150% 的回调；
+//   超时 —— 耗时超过期限，这一块一定没有按时交给设备；
+//   迟到 —— 两次回调开始的间隔超过 1.5 个块长，说明设备那边已经断过音（例如被别的线程饿住）；
+//   设备 xrun —— 驱动报告的次数（AudioIODevice::getXRunCount，不支持时为 -1）。
+class AudioCallbackMonitor
+{
+public:
+    // 音频线程（prepareToPlay）
+    void prepare(double newSampleRate);
+
+    // 音频线程：包住整个回调
+    juce::int64 beginCallback() const { return juce::Time::getHighResolutionTicks(); }
+    void endCallback(juce::int64 startTicks, int numSamples);
+
+    // 以下在消息线程调用
+    float getAverageLoad() const { return averageLoad.load(std::memory_order_relaxed); }
+    float getWorstLoad() const { return worstLoad.load(std::memory_order_relaxed); }
+    double getWorstCallbackMs() const;
+    double getDeadlineMs() const { return deadlineMs.load(std::memory_order_relaxed); }
+    juce::uint32 getNumCallbacks() const { return numCallbacks.load(std::memory_order_relaxed); }
+    juce::uint32 getNumOverruns() const { return numOverruns.load(std::memory_order_relaxed); }
+    juce::uint32 getNumLateCallbacks() const { return numLateCallbacks.load(std::memory_order_relaxed); }
+
+    static constexpr int numHistogramBins = 16;
+    static constexpr float histogramBinLoad = 0.1f;
+    std::array<juce::uint32, numHistogramBins> getHistogram() const;
+
+    // 设备报告的 xrun（由消息线程定期从 AudioIODevice 读取后设置），从 reset 时算起
+    void setDeviceXRunCount(int count);
+    int getNumDeviceXRuns() const { return deviceXRuns; }
+
+    // 清零所有统计。和音频线程同时写入时最多丢掉一两次回调的数据
+    void reset();
+
+    // 负载警告：上次检查以来有回调超过 threshold（0 表示关闭），或者出现新的超时、迟到、设备 xrun
+    void setWarningThreshold(float newThreshold) { warningThreshold = newThreshold; }
+    float getWarningThreshold() const { return warningThreshold; }
+    bool checkForWarning();
+
+private:
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<double> deadlineMs { 0.0 };
+    std::atomic<float> averageLoad { 0.0f };
+    std::atomic<float> worstLoad { 0.0f };
+    std::atomic<float> peakLoadSinceCheck { 0.0f };
+    std::atomic<juce::int64> worstTicks { 0 };
+    std::atomic<juce::int64> lastStartTicks { 0 };
+    std::atomic<juce::uint32> numCallbacks { 0 }, numOverruns { 0 }, numLateCallbacks { 0 };
+    std::array<std::atomic<juce::uint32>, numHistogramBins> histogram {};
+
+    // 只在消息线程访问
+    int deviceXRunBase = -1, deviceXRuns = 0;
+    float warningThreshold = 0.0f;
+    juce::uint32 problemsAtLastCheck = 0;
+
+    static constexpr float loadSmoothing = 0.05f;
+    static constexpr double lateFactor = 1.5;
+};
@@ -0,0 +1,306 @@
+/*
+  ==============================================================================
+
+    AudioDeckPlayer.cpp
+    Created: 19 Oct 2026 5:02:37pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "AudioDeckPlayer.h"
+
+AudioDeck::~AudioDeck()
+{
+    transport.setSource(nullptr);
+}
+
+std::unique_ptr<AudioDeck> AudioDeck::create(std::unique_ptr<juce::AudioFormatReader> reader, int blockSize, double sampleRate)
+{
+    if (reader == nullptr)
+        return nullptr;
+
+    auto deck = std::make_unique<AudioDeck>();
+    deck->sourceSampleRate = reader->sampleRate;
+    deck->readerSource = std::make_unique<juce::AudioFormatReaderSource>(reader.release(), true);
+    deck->connectSources();
+
+    if (blockSize > 0 && sampleRate > 0.0)
+        deck->prepare(blockSize, sampleRate);
+
+    return deck;
+}
+
+std::unique_ptr<AudioDeck> AudioDeck::createMultiStem(std::vector<std::unique_ptr<juce::AudioFormatReader>> readers,
+                                                      const juce::Array<juce::File>& stemFiles,
+                                                      juce::TimeSliceThread& readAheadThread,
+                                                      int blockSize, double sampleRate)
+{
+    auto stemSource = std::make_unique<MultiStemAudioSource>(std::move(readers), stemFiles, readAheadThread);
+    if (stemSource->getNumStems() == 0)
+        return nullptr;
+
+    auto deck = std::make_unique<AudioDeck>();
+    deck->sourceSampleRate = stemSource->getSampleRate();
+    deck->stems = stemSource.get();
+    deck->readerSource = std::move(stemSource);
+    deck->connectSources();
+
+    if (blockSize > 0 && sampleRate > 0.0)
+        deck->prepare(blockSize, sampleRate);
+
+    return deck;
+}
+
+void AudioDeck::connectSources()
+{
+    loopPrefetchSource = std::make_unique<LoopPrefetchSource>(readerSource.get(), stems);
+    stretchSource = std::make_unique<TimeStretchAudioSource>(loopPrefetchSource.get());
+    clickSource = std::make_unique<ClickTrackAudioSource>(stretchSource.get());
+    loopSource = std::make_unique<LoopAudioSource>(clickSource.get(), stretchSource.get(), loopPrefetchSource.get());
+    transport.setSource(loopSource.get(), 0, nullptr, sourceSampleRate, maxChannels);
+}
+
+void AudioDeck::prepare(int blockSize, double sampleRate)
+{
+    transport.prepareToPlay(blockSize, sampleRate);
+    preparedBlockSize = blockSize;
+    preparedSampleRate = sampleRate;
+}
+
+size_t AudioDeck::getMemoryUsage() const
+{
+    size_t bytes = stems != nullptr ? stems->getBufferBytes() : 0;
+
+    if (const auto* region = loopSource != nullptr ? loopSource->getRegion() : nullptr)
+        bytes += region->getMemoryUsage();
+
+    return bytes;
+}
+
+//==============================================================================
+AudioDeckPlayer::AudioDeckPlayer()
+{
+    readAheadThread.startThread(juce::Thread::Priority::high);
+
+    decks.onRelease = [this](AudioDeck& released)
+    {
+        released.transport.removeChangeListener(this);
+        released.transport.stop();
+    };
+}
+
+AudioDeckPlayer::~AudioDeckPlayer()
+{
+    // 到这里音频设备已经关闭，可以直接释放
+    decks.clear();
+    readAheadThread.stopThread(2000);
+}
+
+size_t AudioDeckPlayer::getMemoryUsage() const
+{
+    size_t bytes = static_cast<size_t>(fadeBuffer.getNumChannels()) * static_cast<size_t>(fadeBuffer.getNumSamples()) * sizeof(float);
+    for (const auto& deck : decks.getOwned())
+        bytes += deck->getMemoryUsage();
+    return bytes;
+}
+
+void AudioDeckPlayer::swapTo(std::unique_ptr<AudioDeck> newDeck)
+{
+    if (newDeck == nullptr)
+        return;
+
+    // 后台 prepare 时的设备设置已经变了，重新 prepare
+    const int blockSize = preparedBlockSize.load();
+    const double sampleRate = preparedSampleRate.load();
+    if (blockSize > 0 && (newDeck->preparedBlockSize != blockSize || newDeck->preparedSampleRate != sampleRate))
+        newDeck->prepare(blockSize, sampleRate);
+
+    newDeck->stretchSource->setTempo(tempo.load());
+    newDeck->clickSource->setEnabled(clickEnabled);
+    newDeck->clickSource->setSeparateOutput(clickSeparateOutput);
+    if (newDeck->stems != nullptr)
+        newDeck->stems->setWaitForReadAhead(waitForReadAhead);
+
+    newDeck->transport.addChangeListener(this);
+    currentDeck = decks.post(std::move(newDeck));
+
+    // 新 deck 可能在换上之前就已经 start 了，那时还没有监听它
+    if (onTransportStateChanged)
+        onTransportStateChanged();
+}
+
+void AudioDeckPlayer::changeListenerCallback(juce::ChangeBroadcaster* source)
+{
+    if (currentDeck != nullptr && source == &currentDeck->transport && onTransportStateChanged)
+        onTransportStateChanged();
+}
+
+void AudioDeckPlayer::start()
+{
+    if (currentDeck != nullptr)
+        currentDeck->transport.start();
+}
+
+void AudioDeckPlayer::stop()
+{
+    if (currentDeck != nullptr)
+        currentDeck->transport.stop();
+}
+
+bool AudioDeckPlayer::isPlaying() const
+{
+    return currentDeck != nullptr && currentDeck->transport.isPlaying();
+}
+
+void AudioDeckPlayer::setPosition(double newPosition)
+{
+    if (currentDeck != nullptr)
+        currentDeck->transport.setPosition(newPosition);
+}
+
+double AudioDeckPlayer::getCurrentPosition() const
+{
+    return currentDeck != nullptr ? currentDeck->transport.getCurrentPosition() : 0.0;
+}
+
+double AudioDeckPlayer::getLengthInSeconds() const
+{
+    return currentDeck != nullptr ? currentDeck->getLengthInSeconds() : 0.0;
+}
+
+void AudioDeckPlayer::setTempo(double newTempo)
+{
+    tempo = juce::jlimit(TimeStretchAudioSource::minimumTempo, TimeStretchAudioSource::maximumTempo, newTempo);
+
+    if (currentDeck != nullptr)
+        currentDeck->stretchSource->setTempo(tempo.load());
+}
+
+void AudioDeckPlayer::setLoopRegion(std::unique_ptr<LoopRegion> region)
+{
+    if (currentDeck == nullptr || region == nullptr || region->file != currentDeck->file)
+        return;
+
+    currentDeck->loopSource->setRegion(std::move(region));
+}
+
+void AudioDeckPlayer::clearLoopRegion()
+{
+    if (currentDeck != nullptr && currentDeck->loopSource->getRegion() != nullptr)
+        currentDeck->loopSource->setRegion(nullptr);
+}
+
+void AudioDeckPlayer::setClickBeats(const std::vector<ClickBeat>& beats)
+{
+    if (currentDeck == nullptr)
+        return;
+
+    auto pattern = std::make_unique<ClickPattern>();
+    pattern->clicks.reserve(beats.size());
+
+    for (const auto& beat : beats)
+        pattern->clicks.push_back({ static_cast<juce::int64>(std::llround(beat.time * currentDeck->sourceSampleRate)), beat.isDownbeat });
+
+    currentDeck->clickSource->setPattern(std::move(pattern));
+}
+
+void AudioDeckPlayer::setClickEnabled(bool shouldBeEnabled)
+{
+    clickEnabled = shouldBeEnabled;
+
+    if (currentDeck != nullptr)
+        currentDeck->clickSource->setEnabled(clickEnabled);
+}
+
+void AudioDeckPlayer::setWaitForReadAhead(bool shouldWait)
+{
+    waitForReadAhead = shouldWait;
+
+    if (currentDeck != nullptr && currentDeck->stems != nullptr)
+        currentDeck->stems->setWaitForReadAhead(waitForReadAhead);
+}
+
+void AudioDeckPlayer::setClickSeparateOutput(bool shouldUseSeparateOutput)
+{
+    clickSeparateOutput = shouldUseSeparateOutput;
+
+    if (currentDeck != nullptr)
+        currentDeck->clickSource->setSeparateOutput(clickSeparateOutput);
+}
+
+//==============================================================================
+void AudioDeckPlayer::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    preparedBlockSize = samplesPerBlockExpected;
+    preparedSampleRate = sampleRate;
+    fadeLengthSamples = std::max(1, juce::roundToInt(crossfadeSeconds * sampleRate));
+    fadeBuffer.setSize(maxFadeChannels, fadeLengthSamples);
+
+    for (auto& deck : decks.getOwned())
+        deck->prepare(samplesPerBlockExpected, sampleRate);
+}
+
+void AudioDeckPlayer::releaseResources()
+{
+    for (auto& deck : decks.getOwned())
+        deck->transport.releaseResources();
+}
+
+void AudioDeckPlayer::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    // 取走消息线程换上的新 deck，当前的 deck 开始淡出
+    if (auto* incoming = decks.takePending())
+    {
+        decks.retire(fadingDeck);
+        fadingDeck = activeDeck;
+        activeDeck = incoming;
+        fadeSamplesDone = 0;
+    }
+
+    if (activeDeck == nullptr)
+    {
+        bufferToFill.clearActiveBufferRegion();
+        return;
+    }
+
+    activeDeck->transport.getNextAudioBlock(bufferToFill);
+
+    if (fadingDeck == nullptr)
+        return;
+
+    const int numFadeSamples = std::min(bufferToFill.numSamples, fadeLengthSamples - fadeSamplesDone);
+
+    // 旧 deck 已经停了就没有需要淡出的声音，直接切换
+    if (numFadeSamples > 0 && fadingDeck->transport.isPlaying())
+    {
+        const float startGain = 1.0f - static_cast<float>(fadeSamplesDone) / static_cast<float>(fadeLengthSamples);
+        const float endGain = 1.0f - static_cast<float>(fadeSamplesDone + numFadeSamples) / static_cast<float>(fadeLengthSamples);
+        const int numChannels = std::min(bufferToFill.buffer->getNumChannels(), maxFadeChannels);
+
+        // 新 deck 淡入
+        for (int channel = 0; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+            bufferToFill.buffer->applyGainRamp(channel, bufferToFill.startSample, numFadeSamples, 1.0f - startGain, 1.0f - endGain);
+
+        // 旧 deck 渲染到预先分配的缓冲里，再按淡出曲线叠加
+        juce::AudioBuffer<float> fadeView(fadeBuffer.getArrayOfWritePointers(), numChannels, numFadeSamples);
+        juce::AudioSourceChannelInfo fadeInfo(&fadeView, 0, numFadeSamples);
+        fadingDeck->transport.getNextAudioBlock(fadeInfo);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            bufferToFill.buffer->addFromWithRamp(channel, bufferToFill.startSample, fadeView.getReadPointer(channel),
+                                                 numFadeSamples, startGain, endGain);
+
+        fadeSamplesDone += numFadeSamples;
+    }
+    else
+    {
+        fadeSamplesDone = fadeLengthSamples;
+    }
+
+    if (fadeSamplesDone >= fadeLengthSamples)
+    {
+        decks.retire(fadingDeck);
+        fadingDeck = nullptr;
+    }
+}
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    AudioDeckPlayer.h
+    Created: 19 Oct 2026 5:02:37pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "TimeStretchAudioSource.h"
+#include "LoopAudioSource.h"
+#include "MultiStemAudioSource.h"
+#include "ClickTrackAudioSource.h"
+#include "TempoMap.h"
+#include "AudioThreadHandoff.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 一个已经打开并准备好播放的音频文件（或一组同步播放的分轨）：
+// 读取源 -> 循环区间预读 -> 变速不变调 -> 节拍器 -> A/B 循环 -> 自己的 AudioTransportSource。
+// 可以在后台线程创建和 prepare，之后整个交给 AudioDeckPlayer。
+struct AudioDeck
+{
+    ~AudioDeck();
+
+    // 在任意线程创建；blockSize/sampleRate 为 0 时先不 prepare，由播放器稍后 prepare
+    static std::unique_ptr<AudioDeck> create(std::unique_ptr<juce::AudioFormatReader> reader, int blockSize, double sampleRate);
+
+    // 多轨：每轨在 readAheadThread 上预读；没有可用的分轨时返回 nullptr
+    static std::unique_ptr<AudioDeck> createMultiStem(std::vector<std::unique_ptr<juce::AudioFormatReader>> readers,
+                                                      const juce::Array<juce::File>& stemFiles,
+                                                      juce::TimeSliceThread& readAheadThread,
+                                                      int blockSize, double sampleRate);
+
+    void prepare(int blockSize, double sampleRate);
+    double getLengthInSeconds() const { return transport.getLengthInSeconds(); }
+
+    // 分轨预读缓冲和读进内存的循环区间（消息线程）
+    size_t getMemoryUsage() const;
+
+    std::unique_ptr<juce::PositionableAudioSource> readerSource;
+    MultiStemAudioSource* stems = nullptr;  // 多轨时指向 readerSource
+    std::unique_ptr<LoopPrefetchSource> loopPrefetchSource;
+    std::unique_ptr<TimeStretchAudioSource> stretchSource;
+    std::unique_ptr<ClickTrackAudioSource> clickSource;
+    std::unique_ptr<LoopAudioSource> loopSource;
+    juce::AudioTransportSource transport;
+    juce::File file;
+    int preparedBlockSize = 0;
+    double preparedSampleRate = 0.0;
+    double sourceSampleRate = 0.0;
+
+    static constexpr int maxChannels = 4;  // 主输出 + 节拍器单独输出
+
+private:
+    void connectSources();
+};
+
+// 播放当前的 AudioDeck，并支持无锁地换上新的 AudioDeck。
+// 消息线程通过 AudioThreadHandoff 交出新 deck，音频线程在下一个回调开始时取走，
+// 旧 deck 在音频线程里短暂淡出（新 deck 同时淡入），然后交回消息线程释放。
+// 音频线程里不分配内存、不加锁。
+class AudioDeckPlayer : public juce::AudioSource,
+                        private juce::ChangeListener
+{
+public:
+    AudioDeckPlayer();
+    ~AudioDeckPlayer() override;
+
+    // 消息线程：换上新的音频
+    void swapTo(std::unique_ptr<AudioDeck> newDeck);
+
+    // 以下都作用于最近换上的 deck（消息线程）
+    bool hasSource() const { return currentDeck != nullptr; }
+    void start();
+    void stop();
+    bool isPlaying() const;
+    void setPosition(double newPosition);
+
+    // 当前 deck 开始或停止播放（包括播放到结尾自己停下）以及换了 deck 时，在消息线程调用
+    std::function<void()> onTransportStateChanged;
+    double getCurrentPosition() const;
+    double getLengthInSeconds() const;
+    juce::File getCurrentFile() const { return currentDeck != nullptr ? currentDeck->file : juce::File(); }
+
+    // 练习速度（不变调），对当前和之后换上的 deck 都有效
+    void setTempo(double newTempo);
+    double getTempo() const { return tempo.load(); }
+
+    // A/B 循环：区间在后台读进内存后交给当前 deck；不是当前文件的区间会被丢弃
+    void setLoopRegion(std::unique_ptr<LoopRegion> region);
+    void clearLoopRegion();
+    bool hasLoopRegion() const { return currentDeck != nullptr && currentDeck->loopSource->hasLoopRegion(); }
+    const LoopRegion* getLoopRegion() const { return hasLoopRegion() ? currentDeck->loopSource->getRegion() : nullptr; }
+
+    // 节拍器：拍子按当前 deck 的采样率换算后交给音频线程；开关和输出方式对之后换上的 deck 同样有效
+    void setClickBeats(const std::vector<ClickBeat>& beats);
+    void setClickEnabled(bool shouldBeEnabled);
+    void setClickSeparateOutput(bool shouldUseSeparateOutput);
+
+    // 离线渲染（会话回放）：多轨取数据前等预读缓冲准备好；对之后换上的 deck 同样有效
+    void setWaitForReadAhead(bool shouldWait);
+
+    // 多轨 deck 的分轨（单文件时为 nullptr），以及各轨共享的预读线程
+    MultiStemAudioSource* getCurrentStems() const { return currentDeck != nullptr ? currentDeck->stems : nullptr; }
+    juce::TimeSliceThread& getReadAheadThread() { return readAheadThread; }
+
+    // 设备当前的块大小和采样率，后台线程创建 deck 时用来提前 prepare
+    int getPreparedBlockSize() const { return preparedBlockSize.load(); }
+    double getPreparedSampleRate() const { return preparedSampleRate.load(); }
+
+    // 所有还没释放的 deck 的缓冲，加上交叉淡化用的缓冲（消息线程）
+    size_t getMemoryUsage() const;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+private:
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
+
+    // 必须比所有 deck 活得久
+    juce::TimeSliceThread readAheadThread { "Stem read-ahead" };
+
+    AudioThreadHandoff<AudioDeck> decks;
+    AudioDeck* currentDeck = nullptr;  // 最近换上的 deck（消息线程）
+
+    // 只在音频线程访问
+    AudioDeck* activeDeck = nullptr;
+    AudioDeck* fadingDeck = nullptr;
+    int fadeSamplesDone = 0;
+    juce::AudioBuffer<float> fadeBuffer;
+
+    std::atomic<int> preparedBlockSize { 0 };
+    std::atomic<double> preparedSampleRate { 0.0 };
+    std::atomic<double> tempo { 1.0 };
+    bool clickEnabled = false, clickSeparateOutput = false, waitForReadAhead = false;
+    int fadeLengthSamples = 0;
+
+    static constexpr double crossfadeSeconds = 0.03;
+    static constexpr int maxFadeChannels = 8;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioDeckPlayer)
+};
@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    AudioFileLoader.cpp
+    Created: 19 Oct 2026 5:24:09pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "AudioFileLoader.h"
+
+AudioFileLoader::AudioFileLoader(juce::AudioFormatManager& formatManagerToUse, AudioDeckPlayer& playerToPrepareFor)
+    : formatManager(formatManagerToUse),
+      player(playerToPrepareFor)
+{
+    worker.process = [this](const juce::Array<juce::File>& files, int generation) { process(files, generation); };
+    worker.onResult = [this](Loaded loaded)
+    {
+        if (loaded.deck == nullptr)
+        {
+            DBG("Failed to open audio file: " + loaded.file.getFullPathName());
+
+            if (onFailed)
+                onFailed(loaded.file);
+        }
+        else if (onLoaded)
+        {
+            onLoaded(std::move(loaded.deck));
+        }
+    };
+    worker.onIdle = [this]
+    {
+        if (onBusyChanged)
+            onBusyChanged(false);
+    };
+    worker.start();
+}
+
+AudioFileLoader::~AudioFileLoader()
+{
+    worker.stop();
+}
+
+void AudioFileLoader::load(const juce::File& file)
+{
+    loadStems({ file });
+}
+
+void AudioFileLoader::loadStems(const juce::Array<juce::File>& stemFiles)
+{
+    if (stemFiles.isEmpty())
+        return;
+
+    worker.request(stemFiles);
+
+    if (onBusyChanged)
+        onBusyChanged(true);
+}
+
+void AudioFileLoader::process(const juce::Array<juce::File>& files, int generation)
+{
+    // 打开文件并识别格式，这一步可能很慢，所以不放在消息线程
+    const juce::File file = files.getFirst();
+    std::unique_ptr<AudioDeck> deck;
+
+    if (files.size() == 1)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        deck = AudioDeck::create(std::move(reader), player.getPreparedBlockSize(), player.getPreparedSampleRate());
+    }
+    else
+    {
+        std::vector<std::unique_ptr<juce::AudioFormatReader>> readers;
+
+        for (const auto& stemFile : files)
+            readers.emplace_back(formatManager.createReaderFor(stemFile));
+
+        deck = AudioDeck::createMultiStem(std::move(readers), files, player.getReadAheadThread(),
+                                          player.getPreparedBlockSize(), player.getPreparedSampleRate());
+    }
+
+    if (deck != nullptr)
+        deck->file = file;
+
+    worker.emit(generation, { file, std::move(deck) });
+}
@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    AudioFileLoader.h
+    Created: 19 Oct 2026 5:24:09pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "AudioDeckPlayer.h"
+#include "LatestRequestWorker.h"
+
+#include <functional>
+#include <memory>
+
+// 在后台线程打开音频文件、识别格式并创建好 AudioDeck，完成后在消息线程回调。
+// 一次给多个文件时作为多轨同步播放。连续请求时只保留最新的一个。
+class AudioFileLoader
+{
+public:
+    AudioFileLoader(juce::AudioFormatManager& formatManagerToUse, AudioDeckPlayer& playerToPrepareFor);
+    ~AudioFileLoader();
+
+    void load(const juce::File& file);
+    void loadStems(const juce::Array<juce::File>& stemFiles);
+
+    // 最近的请求还没交给 onLoaded / onFailed
+    bool isBusy() const { return worker.isBusy(); }
+
+    // 在消息线程上调用
+    std::function<void(std::unique_ptr<AudioDeck> deck)> onLoaded;
+    std::function<void(const juce::File& file)> onFailed;
+    std::function<void(bool isBusy)> onBusyChanged;  // 开始加载，以及最新的请求处理完之后
+
+private:
+    // deck 为空表示打开失败
+    struct Loaded
+    {
+        juce::File file;
+        std::unique_ptr<AudioDeck> deck;
+    };
+
+    void process(const juce::Array<juce::File>& files, int generation);
+
+    juce::AudioFormatManager& formatManager;
+    AudioDeckPlayer& player;
+    LatestRequestWorker<juce::Array<juce::File>, Loaded> worker { "Audio file loader", juce::Thread::Priority::normal, 4000 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioFileLoader)
+};
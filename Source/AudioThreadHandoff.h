@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    AudioThreadHandoff.h
+    Created: 25 Oct 2026 10:02:18am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 消息线程把新对象（deck、循环区间、节拍器拍子……）交给音频线程，音频线程用完后再交回来释放：
+// 消息线程拥有所有对象，新对象放进原子指针，音频线程在回调开始时取走；
+// 不再使用的对象经无锁 FIFO 交回，由消息线程上的 Timer 释放。音频线程里不分配内存、不加锁。
+// 拥有者析构时音频线程必须已经不再使用这些对象。
+template <typename Object>
+class AudioThreadHandoff : private juce::Timer
+{
+public:
+    AudioThreadHandoff() = default;
+
+    ~AudioThreadHandoff() override
+    {
+        clear();
+    }
+
+    // 消息线程：交出新对象，返回它的指针（拥有权留在这里）
+    Object* post(std::unique_ptr<Object> object)
+    {
+        auto* posted = object.get();
+        owned.push_back(std::move(object));
+
+        // 上一个还没被音频线程取走的对象从没被用过，可以直接释放
+        if (auto* neverUsed = pending.exchange(posted, std::memory_order_acq_rel))
+            release(neverUsed);
+
+        startTimer(100);
+        return posted;
+    }
+
+    // 音频线程：取走消息线程交出的新对象，没有时返回 nullptr
+    Object* takePending()
+    {
+        return pending.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    // 音频线程：交回不再使用的对象
+    void retire(Object* object)
+    {
+        if (object == nullptr)
+            return;
+
+        auto scope = retiredFifo.write(1);
+        if (scope.blockSize1 > 0)
+            retired[static_cast<size_t>(scope.startIndex1)] = object;
+        else
+            jassertfalse;  // 消息线程太久没有回收；这个对象会在 clear 或析构时释放
+    }
+
+    // 消息线程：所有还没释放的对象
+    const std::vector<std::unique_ptr<Object>>& getOwned() const { return owned; }
+
+    // 消息线程：音频线程已经不再使用任何对象时，全部释放
+    void clear()
+    {
+        stopTimer();
+        pending = nullptr;
+        owned.clear();
+    }
+
+    // 消息线程：对象被释放之前调用（clear 时不调用）
+    std::function<void(Object&)> onRelease;
+
+private:
+    void timerCallback() override
+    {
+        // 释放音频线程已经不再使用的对象
+        const auto scope = retiredFifo.read(retiredFifo.getNumReady());
+
+        for (int i = 0; i < scope.blockSize1; ++i)
+            release(retired[static_cast<size_t>(scope.startIndex1 + i)]);
+
+        for (int i = 0; i < scope.blockSize2; ++i)
+            release(retired[static_cast<size_t>(scope.startIndex2 + i)]);
+
+        if (owned.size() <= 1)
+            stopTimer();
+    }
+
+    void release(Object* object)
+    {
+        if (onRelease)
+            onRelease(*object);
+
+        owned.erase(std::remove_if(owned.begin(), owned.end(),
+                                   [object](const std::unique_ptr<Object>& candidate) { return candidate.get() == object; }),
+                    owned.end());
+    }
+
+    // 消息线程拥有所有对象，直到音频线程把它们交回
+    std::vector<std::unique_ptr<Object>> owned;
+
+    // 消息线程 -> 音频线程
+    std::atomic<Object*> pending { nullptr };
+
+    // 音频线程 -> 消息线程
+    static constexpr int maxRetired = 16;
+    juce::AbstractFifo retiredFifo { maxRetired };
+    std::array<Object*, maxRetired> retired {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioThreadHandoff)
+};
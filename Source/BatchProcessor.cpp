@@ -0,0 +1,303 @@
+/*
+  ==============================================================================
+
+    BatchProcessor.cpp
+    Created: 22 Oct 2026 3:47:12pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "BatchProcessor.h"
+#include "BeatTracker.h"
+#include "MarkerFile.h"
+#include "PageRasterDiskCache.h"
+#include "PdfPageRenderer.h"
+#include "ProjectFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    double secondsSince(double startMilliseconds)
+    {
+        return (juce::Time::getMillisecondCounterHiRes() - startMilliseconds) / 1000.0;
+    }
+
+    juce::String formatSeconds(double seconds)
+    {
+        return juce::String(seconds, 2) + "s";
+    }
+}
+
+bool BatchProcessor::parseCommandLine(const juce::String& commandLine, Options& options)
+{
+    auto arguments = juce::StringArray::fromTokens(commandLine, true);
+    for (auto& argument : arguments)
+        argument = argument.unquoted();
+
+    const int batchIndex = arguments.indexOf("--batch");
+    if (batchIndex < 0)
+        return false;
+
+    options = Options();
+    const auto directory = arguments[batchIndex + 1];
+    if (directory.isNotEmpty() && !directory.startsWith("--"))
+        options.directory = juce::File::getCurrentWorkingDirectory().getChildFile(directory);
+
+    const int pageSizeIndex = arguments.indexOf("--page-size");
+    if (pageSizeIndex >= 0)
+    {
+        const auto size = arguments[pageSizeIndex + 1];
+        options.pageWidth = juce::jmax(1, size.upToFirstOccurrenceOf("x", false, true).getIntValue());
+        options.pageHeight = juce::jmax(1, size.fromFirstOccurrenceOf("x", false, true).getIntValue());
+    }
+
+    const int threadsIndex = arguments.indexOf("--threads");
+    if (threadsIndex >= 0)
+        options.numThreads = juce::jmax(0, arguments[threadsIndex + 1].getIntValue());
+
+    options.overwriteMarkers = arguments.contains("--overwrite-markers");
+    return true;
+}
+
+BatchProcessor::BatchProcessor(const Options& optionsToUse)
+    : options(optionsToUse),
+      pool(optionsToUse.numThreads > 0 ? optionsToUse.numThreads : juce::SystemStats::getNumCpus())
+{
+    formatManager.registerBasicFormats();
+}
+
+int BatchProcessor::run()
+{
+    if (!options.directory.isDirectory())
+    {
+        std::cerr << "Usage: --batch <directory> [--page-size WIDTHxHEIGHT] [--threads N] [--overwrite-markers]" << std::endl;
+        return 1;
+    }
+
+    // 音频和同名的 PDF 组成一对
+    auto audioFiles = options.directory.findChildFiles(juce::File::findFiles, false, "*.wav;*.mp3");
+    audioFiles.sort();
+
+    std::cout << "Processing " << audioFiles.size() << " audio files in " << options.directory.getFullPathName()
+              << " on " << pool.getNumThreads() << " threads" << std::endl;
+
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+    int numProcessed = 0, numFailed = 0;
+
+    for (const auto& audioFile : audioFiles)
+    {
+        const auto pdfFile = audioFile.withFileExtension(".pdf");
+        if (!pdfFile.existsAsFile())
+        {
+            std::cout << audioFile.getFileName() << ": no matching PDF, skipped" << std::endl;
+            continue;
+        }
+
+        const auto result = processPair(audioFile, pdfFile);
+        ++numProcessed;
+
+        if (!result.succeeded)
+        {
+            ++numFailed;
+            std::cout << audioFile.getFileName() << ": FAILED after " << formatSeconds(result.totalSeconds) << std::endl;
+            continue;
+        }
+
+        std::cout << audioFile.getFileName()
+                  << ": analysis " << formatSeconds(result.analysisSeconds) << " (" << result.numBars << " bars)"
+                  << ", peaks " << formatSeconds(result.peaksSeconds)
+                  << ", " << result.numPages << " pages " << formatSeconds(result.pagesSeconds)
+                  << ", " << result.numMarkers << " markers"
+                  << ", total " << formatSeconds(result.totalSeconds) << std::endl;
+    }
+
+    std::cout << numProcessed << " pairs processed, " << numFailed << " failed, "
+              << formatSeconds(secondsSince(startTime)) << " total" << std::endl;
+
+    return numFailed > 0 ? 1 : 0;
+}
+
+BatchProcessor::FileResult BatchProcessor::processPair(const juce::File& audioFile, const juce::File& pdfFile)
+{
+    FileResult result;
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    // 页数
+    PopplerDocument* document = openPdfDocument(pdfFile);
+    if (document == nullptr)
+    {
+        result.totalSeconds = secondsSince(startTime);
+        return result;
+    }
+
+    const int numPages = poppler_document_get_n_pages(document);
+    g_object_unref(document);
+    result.numPages = numPages;
+
+    PageRasterDiskCache diskCache;
+    diskCache.setDocument(pdfFile);
+
+    // 波形峰值一个任务，页面按线程数分段、每段一个任务（各自打开一份文档，Poppler 文档不能跨线程共用）
+    const int pagesPerJob = juce::jmax(1, (numPages + pool.getNumThreads() - 1) / juce::jmax(1, pool.getNumThreads()));
+    const int numPageJobs = (numPages + pagesPerJob - 1) / pagesPerJob;
+
+    std::atomic<int> jobsRemaining { 1 + numPageJobs };
+    std::atomic<int> pageJobsRemaining { numPageJobs };
+    std::atomic<bool> failed { false };
+    juce::WaitableEvent allJobsDone;
+    double pagesEndTime = startTime;
+
+    auto finishJob = [&]
+    {
+        if (--jobsRemaining == 0)
+            allJobsDone.signal();
+    };
+
+    juce::AudioThumbnailCache thumbnailCache(1);
+    juce::AudioThumbnail thumbnail(512, formatManager, thumbnailCache);
+
+    pool.addJob([&]
+    {
+        const double peaksStart = juce::Time::getMillisecondCounterHiRes();
+        if (!buildPeaks(audioFile, thumbnail))
+            failed = true;
+        result.peaksSeconds = secondsSince(peaksStart);
+        finishJob();
+        return juce::ThreadPoolJob::jobHasFinished;
+    });
+
+    const double pagesStart = juce::Time::getMillisecondCounterHiRes();
+    for (int job = 0; job < numPageJobs; ++job)
+    {
+        const int firstPage = job * pagesPerJob;
+        const int endPage = std::min(numPages, firstPage + pagesPerJob);
+
+        pool.addJob([&, firstPage, endPage]
+        {
+            if (PopplerDocument* workerDocument = openPdfDocument(pdfFile))
+            {
+                for (int i = firstPage; i < endPage; ++i)
+                {
+                    PopplerPage* page = poppler_document_get_page(workerDocument, i);
+                    if (page == nullptr || !diskCache.storePage(i, renderPdfPageToImage(page, options.pageWidth, options.pageHeight)))
+                        failed = true;
+                    if (page != nullptr)
+                        g_object_unref(page);
+                }
+                g_object_unref(workerDocument);
+            }
+            else
+            {
+                failed = true;
+            }
+
+            if (--pageJobsRemaining == 0)
+                pagesEndTime = juce::Time::getMillisecondCounterHiRes();
+
+            finishJob();
+            return juce::ThreadPoolJob::jobHasFinished;
+        });
+    }
+
+    // 节拍分析在这个线程上进行，计算起音强度的各段排在同一个线程池里
+    BeatAnalysis analysis;
+    const bool analysed = BeatTracker::analyseFile(formatManager, audioFile, pool, analysis, [] { return false; });
+    result.analysisSeconds = analysis.analysisSeconds;
+    result.numBars = static_cast<int>(analysis.barTimes.size());
+
+    allJobsDone.wait(-1);
+    result.pagesSeconds = numPageJobs > 0 ? (pagesEndTime - pagesStart) / 1000.0 : 0.0;
+
+    // 写完这份乐谱后限制整个缓存目录的大小，刚写好的这份不会被删
+    diskCache.trimToSize(PageRasterDiskCache::defaultSizeLimitBytes);
+
+    if (failed.load() || !analysed)
+    {
+        result.totalSeconds = secondsSince(startTime);
+        return result;
+    }
+
+    // 已有的标记是手动调整过的，默认保留
+    const auto markersFile = audioFile.withFileExtension(".markers");
+    std::vector<Marker> markers;
+
+    if (options.overwriteMarkers || !readMarkers(markersFile, markers))
+    {
+        markers = createAlignedMarkers(numPages, thumbnail.getTotalLength(), analysis.barTimes);
+        if (!writeMarkers(markersFile, markers))
+        {
+            result.totalSeconds = secondsSince(startTime);
+            return result;
+        }
+    }
+
+    result.numMarkers = static_cast<int>(markers.size());
+
+    const auto projectFile = audioFile.withFileExtension(ProjectFile::fileExtension);
+    ProjectData data;
+    data.audio = ProjectFileReference::create(audioFile, projectFile);
+    data.pdf = ProjectFileReference::create(pdfFile, projectFile);
+    data.audioLengthSeconds = thumbnail.getTotalLength();
+    data.numPages = numPages;
+    data.markers = markers;
+    data.analysis = analysis;
+    data.hasAnalysis = true;
+    data.barsShown = !analysis.barTimes.empty();
+
+    result.succeeded = ProjectFile::save(projectFile, data, &thumbnail);
+    result.totalSeconds = secondsSince(startTime);
+    return result;
+}
+
+bool BatchProcessor::buildPeaks(const juce::File& audioFile, juce::AudioThumbnail& thumbnail)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return false;
+
+    // 不经过 AudioThumbnailCache 的后台线程，直接把整个文件按块交给 AudioThumbnail
+    const int numChannels = static_cast<int>(reader->numChannels);
+    thumbnail.reset(numChannels, reader->sampleRate, reader->lengthInSamples);
+
+    constexpr int blockSize = 65536;
+    juce::AudioBuffer<float> buffer(numChannels, blockSize);
+
+    for (juce::int64 position = 0; position < reader->lengthInSamples; position += blockSize)
+    {
+        const int numSamples = static_cast<int>(std::min<juce::int64>(blockSize, reader->lengthInSamples - position));
+        if (!reader->read(&buffer, 0, numSamples, position, true, true))
+            return false;
+
+        thumbnail.addBlock(position, buffer, 0, numSamples);
+    }
+
+    return thumbnail.isFullyLoaded();
+}
+
+std::vector<Marker> BatchProcessor::createAlignedMarkers(int numPages, double lengthSeconds, const std::vector<double>& barTimes)
+{
+    std::vector<Marker> markers;
+    if (numPages <= 1 || lengthSeconds <= 0.0)
+        return markers;
+
+    const int numBars = static_cast<int>(barTimes.size());
+
+    for (int page = 1; page < numPages; ++page)
+    {
+        double position = lengthSeconds * page / numPages;
+
+        // 小节够多时每页分到差不多一样多的小节
+        if (numBars >= numPages)
+            position = barTimes[static_cast<size_t>(juce::jlimit(1, numBars - 1, juce::roundToInt(static_cast<double>(page) * numBars / numPages)))];
+
+        if (markers.empty() || position > markers.back().position)
+            markers.emplace_back(position);
+    }
+
+    return markers;
+}
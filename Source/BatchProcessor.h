@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    BatchProcessor.h
+    Created: 22 Oct 2026 3:47:12pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Marker.h"
+
+#include <vector>
+
+// 不打开窗口的批处理模式，演出前把整个曲库的缓存提前准备好，也可以在没有显示器的 CI 里运行：
+//   player --batch <目录> [--page-size 1400x1800] [--threads N] [--overwrite-markers]
+// 目录里每个音频文件和同名的 PDF 组成一对，对每一对：
+//   - 检测节拍，生成按小节对齐的翻页标记，写到同名的 .markers（已有时不覆盖，除非 --overwrite-markers）；
+//   - 生成波形峰值，连同音频和 PDF 的引用、页数、标记和分析结果写进同名的工程文件（页面尺寸打开时从 PDF 本身读取，不再保存）；
+//   - 把每一页渲染好存进 PageRasterDiskCache，界面打开这份 PDF 时直接读取。
+// 节拍分析的各段、波形峰值和各页的渲染都是同一个线程池里的任务，所有核心一起用。
+// 每个文件输出各阶段耗时，最后输出汇总；有文件失败时退出码不为 0。
+class BatchProcessor
+{
+public:
+    struct Options
+    {
+        juce::File directory;
+        int pageWidth = 1400, pageHeight = 1800;
+        int numThreads = 0;  // 0 表示所有核心
+        bool overwriteMarkers = false;
+    };
+
+    // 命令行里有 --batch 时返回 true 并填好 options（参数有误时 directory 为空）
+    static bool parseCommandLine(const juce::String& commandLine, Options& options);
+
+    explicit BatchProcessor(const Options& optionsToUse);
+
+    // 处理整个目录，返回进程退出码
+    int run();
+
+    // 把 numPages 页平均分给检测到的小节，每次翻页都落在小节的第一拍；没有小节时按时间平均分
+    static std::vector<Marker> createAlignedMarkers(int numPages, double lengthSeconds, const std::vector<double>& barTimes);
+
+private:
+    struct FileResult
+    {
+        bool succeeded = false;
+        int numPages = 0, numBars = 0, numMarkers = 0;
+        double analysisSeconds = 0.0, peaksSeconds = 0.0, pagesSeconds = 0.0, totalSeconds = 0.0;
+    };
+
+    FileResult processPair(const juce::File& audioFile, const juce::File& pdfFile);
+    bool buildPeaks(const juce::File& audioFile, juce::AudioThumbnail& thumbnail);
+
+    Options options;
+    juce::AudioFormatManager formatManager;
+    juce::ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BatchProcessor)
+};
@@ -0,0 +1,448 @@
+/*
+  ==============================================================================
+
+    BeatTracker.cpp
+    Created: 21 Oct 2026 10:26:40am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "BeatTracker.h"
+#include "VectorMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double minimumBpm = 40.0;
+    constexpr double maximumBpm = 220.0;
+    constexpr double preferredBpm = 120.0;
+    constexpr double bassCutoffHz = 150.0;
+    constexpr float logCompression = 100.0f;
+    constexpr double tightness = 100.0;  // 越大越不允许拍子间隔偏离周期
+    constexpr int minimumFramesPerJob = 512;
+    constexpr int maximumFramesPerJob = 2048;  // 限制每个任务一次读进内存的音频（几个小时的文件也不会占用太多内存）
+    constexpr double onsetThreshold = 1.0;     // 归一化后的起音强度至少比平均起伏高一个标准差
+    constexpr double minimumOnsetGap = 0.05;   // 两个起音之间至少隔 50ms
+
+    inline float sum(const float* data, int numSamples)
+    {
+        float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            s0 += data[i];
+            s1 += data[i + 1];
+            s2 += data[i + 2];
+            s3 += data[i + 3];
+        }
+
+        for (; i < numSamples; ++i)
+            s0 += data[i];
+
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // 计算 [firstFrame, endFrame) 的谱通量（全频段和低频段）。每个任务用自己的 reader
+    void computeOnsetChunk(juce::AudioFormatReader& reader, int fftOrder, int hopSize, int numBassBins,
+                           int firstFrame, int endFrame, float* flux, float* bassFlux)
+    {
+        const int fftSize = 1 << fftOrder;
+        const int numBins = fftSize / 2 + 1;
+
+        // 多读前一帧，这样这一段的第一帧也有可以比较的上一帧
+        const int startFrame = std::max(0, firstFrame - 1);
+        const int numSamples = (endFrame - 1 - startFrame) * hopSize + fftSize;
+        const int numChannels = static_cast<int>(std::min(2u, reader.numChannels));
+
+        juce::AudioBuffer<float> audio(std::max(1, numChannels), numSamples);
+        reader.read(&audio, 0, numSamples, static_cast<juce::int64>(startFrame) * hopSize, true, true);
+
+        // 混成单声道
+        float* mono = audio.getWritePointer(0);
+        if (numChannels > 1)
+        {
+            juce::FloatVectorOperations::add(mono, audio.getReadPointer(1), numSamples);
+            juce::FloatVectorOperations::multiply(mono, 0.5f, numSamples);
+        }
+
+        juce::dsp::FFT fft(fftOrder);
+        std::vector<float> window(static_cast<size_t>(fftSize));
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), static_cast<size_t>(fftSize),
+                                                                 juce::dsp::WindowingFunction<float>::hann, false);
+
+        std::vector<float> fftData(static_cast<size_t>(2 * fftSize));
+        std::vector<float> previous(static_cast<size_t>(numBins)), current(static_cast<size_t>(numBins)), difference(static_cast<size_t>(numBins));
+
+        for (int frame = startFrame; frame < endFrame; ++frame)
+        {
+            const float* frameStart = mono + (frame - startFrame) * hopSize;
+            juce::FloatVectorOperations::multiply(fftData.data(), frameStart, window.data(), fftSize);
+            juce::FloatVectorOperations::clear(fftData.data() + fftSize, fftSize);
+            fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+            // 对数压缩，让安静段落的起音也能被看到
+            for (int bin = 0; bin < numBins; ++bin)
+                current[static_cast<size_t>(bin)] = std::log1p(logCompression * fftData[static_cast<size_t>(bin)]);
+
+            if (frame >= firstFrame)
+            {
+                if (frame > startFrame)
+                {
+                    // 只统计能量增加的部分
+                    juce::FloatVectorOperations::subtract(difference.data(), current.data(), previous.data(), numBins);
+                    juce::FloatVectorOperations::max(difference.data(), difference.data(), 0.0f, numBins);
+                    flux[frame - firstFrame] = sum(difference.data(), numBins);
+                    bassFlux[frame - firstFrame] = sum(difference.data(), numBassBins);
+                }
+                else
+                {
+                    flux[frame - firstFrame] = bassFlux[frame - firstFrame] = 0.0f;
+                }
+            }
+
+            std::swap(previous, current);
+        }
+    }
+
+    // 去掉缓慢变化的部分（减去约 1 秒的滑动平均），只保留正值，再按标准差归一化
+    void normaliseOnsets(std::vector<float>& onsets, double frameRate)
+    {
+        const int numFrames = static_cast<int>(onsets.size());
+        const int halfWindow = std::max(1, juce::roundToInt(frameRate * 0.5));
+
+        std::vector<double> prefix(onsets.size() + 1, 0.0);
+        for (int i = 0; i < numFrames; ++i)
+            prefix[static_cast<size_t>(i + 1)] = prefix[static_cast<size_t>(i)] + onsets[static_cast<size_t>(i)];
+
+        std::vector<float> detrended(onsets.size());
+        double sumOfSquares = 0.0;
+
+        for (int i = 0; i < numFrames; ++i)
+        {
+            const int start = std::max(0, i - halfWindow);
+            const int end = std::min(numFrames, i + halfWindow + 1);
+            const double mean = (prefix[static_cast<size_t>(end)] - prefix[static_cast<size_t>(start)]) / (end - start);
+            const float value = std::max(0.0f, static_cast<float>(onsets[static_cast<size_t>(i)] - mean));
+            detrended[static_cast<size_t>(i)] = value;
+            sumOfSquares += static_cast<double>(value) * value;
+        }
+
+        const float deviation = static_cast<float>(std::sqrt(sumOfSquares / std::max(1, numFrames)));
+        if (deviation > 0.0f)
+            juce::FloatVectorOperations::multiply(detrended.data(), 1.0f / deviation, numFrames);
+
+        onsets = std::move(detrended);
+    }
+
+    // 起音强度的自相关，乘上以 120 BPM 为中心的对数高斯权重，返回拍子周期（帧）
+    double estimateBeatPeriod(const std::vector<float>& onsets, double frameRate)
+    {
+        const int numFrames = static_cast<int>(onsets.size());
+        const int minLag = std::max(1, static_cast<int>(std::floor(frameRate * 60.0 / maximumBpm)));
+        const int maxLag = std::min(numFrames / 2, static_cast<int>(std::ceil(frameRate * 60.0 / minimumBpm)));
+
+        if (maxLag <= minLag + 1)
+            return frameRate * 60.0 / preferredBpm;
+
+        std::vector<double> scores(static_cast<size_t>(maxLag + 2), 0.0);
+        int bestLag = minLag;
+
+        for (int lag = minLag; lag <= maxLag; ++lag)
+        {
+            const double correlation = VectorMath::dotProduct(onsets.data(), onsets.data() + lag, numFrames - lag) / (numFrames - lag);
+            const double octaves = std::log2(frameRate * 60.0 / lag / preferredBpm);
+            scores[static_cast<size_t>(lag)] = correlation * std::exp(-0.5 * octaves * octaves);
+
+            if (scores[static_cast<size_t>(lag)] > scores[static_cast<size_t>(bestLag)])
+                bestLag = lag;
+        }
+
+        // 抛物线插值得到小数周期
+        if (bestLag > minLag && bestLag < maxLag)
+        {
+            const double left = scores[static_cast<size_t>(bestLag - 1)];
+            const double centre = scores[static_cast<size_t>(bestLag)];
+            const double right = scores[static_cast<size_t>(bestLag + 1)];
+            const double denominator = left - 2.0 * centre + right;
+
+            if (denominator < 0.0)
+                return bestLag + 0.5 * (left - right) / denominator;
+        }
+
+        return bestLag;
+    }
+
+    // 起音：在 ±minimumOnsetGap 内最大、且超过阈值的帧
+    std::vector<int> pickOnsets(const std::vector<float>& onsets, double frameRate)
+    {
+        const int numFrames = static_cast<int>(onsets.size());
+        const int radius = std::max(1, juce::roundToInt(minimumOnsetGap * frameRate));
+        std::vector<int> picked;
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            const float value = onsets[static_cast<size_t>(frame)];
+            if (value < onsetThreshold)
+                continue;
+
+            bool isPeak = true;
+            for (int i = std::max(0, frame - radius); i <= std::min(numFrames - 1, frame + radius) && isPeak; ++i)
+            {
+                // 相等时取最前面的一帧
+                const float other = onsets[static_cast<size_t>(i)];
+                isPeak = i < frame ? other < value : other <= value;
+            }
+
+            if (isPeak)
+            {
+                picked.push_back(frame);
+                frame += radius;
+            }
+        }
+
+        return picked;
+    }
+
+    // 动态规划：每一帧的得分 = 起音强度 + 前一拍的最好得分 - 间隔偏离周期的惩罚
+    std::vector<int> trackBeats(const std::vector<float>& onsets, double period)
+    {
+        const int numFrames = static_cast<int>(onsets.size());
+        const int minStep = std::max(1, juce::roundToInt(period * 0.5));
+        const int maxStep = std::max(minStep + 1, juce::roundToInt(period * 2.0));
+
+        std::vector<double> penalty(static_cast<size_t>(maxStep + 1));
+        for (int step = minStep; step <= maxStep; ++step)
+        {
+            const double deviation = std::log(step / period);
+            penalty[static_cast<size_t>(step)] = -tightness * deviation * deviation;
+        }
+
+        std::vector<double> score(static_cast<size_t>(numFrames));
+        std::vector<int> backlink(static_cast<size_t>(numFrames), -1);
+
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            double best = -std::numeric_limits<double>::max();
+            int link = -1;
+
+            for (int step = minStep; step <= maxStep && frame - step >= 0; ++step)
+            {
+                const double candidate = score[static_cast<size_t>(frame - step)] + penalty[static_cast<size_t>(step)];
+                if (candidate > best)
+                {
+                    best = candidate;
+                    link = frame - step;
+                }
+            }
+
+            score[static_cast<size_t>(frame)] = onsets[static_cast<size_t>(frame)] + (link >= 0 ? std::max(0.0, best) : 0.0);
+            backlink[static_cast<size_t>(frame)] = link >= 0 && best > 0.0 ? link : -1;
+        }
+
+        // 从最后一个周期里得分最高的帧往回找
+        int frame = numFrames - 1;
+        for (int i = std::max(0, numFrames - maxStep); i < numFrames; ++i)
+            if (score[static_cast<size_t>(i)] > score[static_cast<size_t>(frame)])
+                frame = i;
+
+        std::vector<int> beats;
+        for (; frame >= 0; frame = backlink[static_cast<size_t>(frame)])
+            beats.push_back(frame);
+
+        std::reverse(beats.begin(), beats.end());
+        return beats;
+    }
+
+    // 低频起音在每小节第一拍最强：对每种拍号和相位比较强拍上的平均低频通量
+    void findDownbeats(const std::vector<int>& beatFrames, const std::vector<float>& bassFlux, int& beatsPerBar, int& phase)
+    {
+        const int numFrames = static_cast<int>(bassFlux.size());
+        std::vector<float> beatBass;
+        beatBass.reserve(beatFrames.size());
+
+        // 每拍附近 ±2 帧里的最大值，容忍拍子位置的小误差
+        for (int frame : beatFrames)
+        {
+            float value = 0.0f;
+            for (int i = std::max(0, frame - 2); i <= std::min(numFrames - 1, frame + 2); ++i)
+                value = std::max(value, bassFlux[static_cast<size_t>(i)]);
+            beatBass.push_back(value);
+        }
+
+        const float overall = beatBass.empty() ? 0.0f : sum(beatBass.data(), static_cast<int>(beatBass.size())) / static_cast<float>(beatBass.size());
+        double bestContrast[5] = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+        int bestPhase[5] = { 0, 0, 0, 0, 0 };
+
+        for (int meter : { 3, 4 })
+        {
+            for (int candidate = 0; candidate < meter; ++candidate)
+            {
+                double total = 0.0;
+                int count = 0;
+
+                for (size_t i = static_cast<size_t>(candidate); i < beatBass.size(); i += static_cast<size_t>(meter))
+                {
+                    total += beatBass[i];
+                    ++count;
+                }
+
+                const double contrast = count > 0 && overall > 0.0f ? total / count / overall : 0.0;
+                if (contrast > bestContrast[meter])
+                {
+                    bestContrast[meter] = contrast;
+                    bestPhase[meter] = candidate;
+                }
+            }
+        }
+
+        // 三拍子要明显更好才选，否则按四拍子
+        beatsPerBar = bestContrast[3] > bestContrast[4] * 1.1 ? 3 : 4;
+        phase = bestPhase[beatsPerBar];
+    }
+}
+
+//==============================================================================
+BeatTracker::BeatTracker(juce::AudioFormatManager& formatManagerToUse)
+    : formatManager(formatManagerToUse),
+      pool(std::max(1, juce::SystemStats::getNumCpus() - 1))
+{
+    worker.process = [this](const juce::File& file, int generation) { process(file, generation); };
+    worker.onResult = [this](Analysed analysed)
+    {
+        if (onAnalysed)
+            onAnalysed(analysed.file, analysed.analysis);
+    };
+    worker.start();
+}
+
+BeatTracker::~BeatTracker()
+{
+    // 线程池里的任务通过 isStale 看到线程要退出，尽快放弃
+    worker.stop();
+}
+
+void BeatTracker::analyse(const juce::File& audioFile)
+{
+    worker.request(audioFile);
+}
+
+void BeatTracker::process(const juce::File& file, int generation)
+{
+    BeatAnalysis analysis;
+    const bool succeeded = analyseFile(formatManager, file, pool, analysis,
+                                       [this, generation] { return worker.isStale(generation); });
+
+    if (worker.isStale(generation))
+        return;
+
+    // 失败时也交给界面，让它可以恢复按钮状态；找到的起音照样用于吸附
+    if (!succeeded)
+        DBG("Beat analysis failed (" + juce::String(static_cast<int>(analysis.onsetTimes.size())) + " onsets kept): " + file.getFullPathName());
+
+    worker.emit(generation, { file, std::move(analysis) });
+}
+
+bool BeatTracker::analyseFile(juce::AudioFormatManager& formatManager, const juce::File& audioFile, juce::ThreadPool& pool,
+                              BeatAnalysis& result, const std::function<bool()>& shouldAbort)
+{
+    const double startTime = juce::Time::getMillisecondCounterHiRes();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+    if (reader == nullptr || reader->sampleRate <= 0.0)
+        return false;
+
+    // 约 46ms 的帧、1/4 帧的步进（高采样率时帧加倍，保持时间分辨率一致）
+    const double sampleRate = reader->sampleRate;
+    const int fftOrder = sampleRate > 60000.0 ? 12 : 11;
+    const int fftSize = 1 << fftOrder;
+    const int hopSize = fftSize / 4;
+    const double frameRate = sampleRate / hopSize;
+    const int numBassBins = std::min(fftSize / 2 + 1, static_cast<int>(std::ceil(bassCutoffHz * fftSize / sampleRate)) + 1);
+
+    if (reader->lengthInSamples < fftSize * 4)
+        return false;
+
+    const int numFrames = static_cast<int>((reader->lengthInSamples - fftSize) / hopSize) + 1;
+    std::vector<float> flux(static_cast<size_t>(numFrames)), bassFlux(static_cast<size_t>(numFrames));
+    reader.reset();
+
+    // 按帧切成若干段，每段一个任务；每个任务自己打开文件解码
+    const int numJobsWanted = std::max(1, pool.getNumThreads() * 4);
+    const int framesPerJob = juce::jlimit(minimumFramesPerJob, maximumFramesPerJob, (numFrames + numJobsWanted - 1) / numJobsWanted);
+    const int numJobs = (numFrames + framesPerJob - 1) / framesPerJob;
+
+    std::atomic<int> jobsRemaining { numJobs };
+    std::atomic<bool> failed { false };
+    juce::WaitableEvent allJobsDone;
+
+    for (int job = 0; job < numJobs; ++job)
+    {
+        const int firstFrame = job * framesPerJob;
+        const int endFrame = std::min(numFrames, firstFrame + framesPerJob);
+
+        pool.addJob([&, firstFrame, endFrame]
+        {
+            if (!failed.load() && !shouldAbort())
+            {
+                std::unique_ptr<juce::AudioFormatReader> chunkReader(formatManager.createReaderFor(audioFile));
+
+                if (chunkReader != nullptr)
+                    computeOnsetChunk(*chunkReader, fftOrder, hopSize, numBassBins, firstFrame, endFrame,
+                                      flux.data() + firstFrame, bassFlux.data() + firstFrame);
+                else
+                    failed = true;
+            }
+
+            if (--jobsRemaining == 0)
+                allJobsDone.signal();
+
+            return juce::ThreadPoolJob::jobHasFinished;
+        });
+    }
+
+    allJobsDone.wait(-1);
+
+    if (failed.load() || shouldAbort())
+        return false;
+
+    normaliseOnsets(flux, frameRate);
+
+    // 帧的时间取帧的中心
+    auto frameToSeconds = [&](int frame) { return (static_cast<double>(frame) * hopSize + fftSize * 0.5) / sampleRate; };
+
+    result.beatTimes.clear();
+    result.barTimes.clear();
+    result.onsetTimes.clear();
+
+    // 起音不依赖拍子，找不到拍子时也保留
+    for (int frame : pickOnsets(flux, frameRate))
+        result.onsetTimes.push_back(frameToSeconds(frame));
+
+    const double period = estimateBeatPeriod(flux, frameRate);
+    const auto beatFrames = trackBeats(flux, period);
+    result.analysisSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+
+    if (beatFrames.size() < 2)
+        return false;
+
+    int beatsPerBar = 4, phase = 0;
+    findDownbeats(beatFrames, bassFlux, beatsPerBar, phase);
+
+    for (size_t i = 0; i < beatFrames.size(); ++i)
+    {
+        const double time = frameToSeconds(beatFrames[i]);
+        result.beatTimes.push_back(time);
+
+        if (static_cast<int>(i % static_cast<size_t>(beatsPerBar)) == phase)
+            result.barTimes.push_back(time);
+    }
+
+    result.bpm = 60.0 * frameRate / period;
+    result.beatsPerBar = beatsPerBar;
+    result.analysisSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) / 1000.0;
+    return true;
+}
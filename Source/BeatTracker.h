@@ -0,0 +1,67 @@
+/*
+  ==============================================================================
+
+    BeatTracker.h
+    Created: 21 Oct 2026 10:26:40am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "LatestRequestWorker.h"
+
+#include <functional>
+#include <vector>
+
+// 一首曲子的节拍检测结果（时间都以秒为单位）
+struct BeatAnalysis
+{
+    std::vector<double> beatTimes;
+    std::vector<double> barTimes;   // 每小节的第一拍
+    std::vector<double> onsetTimes; // 所有明显的起音，拖动标记时用来吸附
+    double bpm = 0.0;
+    int beatsPerBar = 4;
+    double analysisSeconds = 0.0;   // 分析耗时
+};
+
+// 离线节拍/强拍检测：
+// 1. 把音频按帧分成若干段，在线程池上并行计算谱通量（起音强度），FFT 用 juce::dsp::FFT，逐帧运算用 FloatVectorOperations；
+// 2. 对起音强度做自相关，在 120 BPM 附近加权，估计拍子周期；
+// 3. 动态规划找出和起音最吻合、间隔接近拍子周期的拍子序列；
+// 4. 用低频部分的谱通量决定每小节几拍以及强拍的位置。
+// 同时从起音强度里挑出局部峰值作为起音列表。
+// 在后台线程运行，结果在消息线程回调（找不到拍子时结果里只有起音，读不出音频时回调一个空结果）。
+class BeatTracker
+{
+public:
+    explicit BeatTracker(juce::AudioFormatManager& formatManagerToUse);
+    ~BeatTracker();
+
+    void analyse(const juce::File& audioFile);
+    void cancel() { worker.cancel(); }
+
+    // 在消息线程上调用
+    std::function<void(const juce::File& audioFile, const BeatAnalysis& analysis)> onAnalysed;
+
+    // 在调用线程上同步分析，计算起音强度的部分分给 pool；shouldAbort 返回 true 时尽快放弃。
+    // 找不到拍子时返回 false，但 result 里仍然有起音
+    static bool analyseFile(juce::AudioFormatManager& formatManager, const juce::File& audioFile, juce::ThreadPool& pool,
+                            BeatAnalysis& result, const std::function<bool()>& shouldAbort);
+
+private:
+    struct Analysed
+    {
+        juce::File file;
+        BeatAnalysis analysis;
+    };
+
+    void process(const juce::File& file, int generation);
+
+    juce::AudioFormatManager& formatManager;
+    juce::ThreadPool pool;
+    LatestRequestWorker<juce::File, Analysed> worker { "Beat tracker", juce::Thread::Priority::low, 10000 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BeatTracker)
+};
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    ClickTrackAudioSource.cpp
+    Created: 20 Oct 2026 9:12:07pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "ClickTrackAudioSource.h"
+
+namespace
+{
+    // 衰减很快的正弦，小节第一拍用更高的音
+    void synthesiseClick(std::vector<float>& click, double frequency, double sampleRate, int numSamples)
+    {
+        click.resize(static_cast<size_t>(numSamples));
+        const double decay = 5.0 / numSamples;
+
+        for (int i = 0; i < numSamples; ++i)
+            click[static_cast<size_t>(i)] = static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * frequency * i / sampleRate)
+                                                               * std::exp(-decay * i));
+    }
+}
+
+ClickTrackAudioSource::ClickTrackAudioSource(TimeStretchAudioSource* inputSource)
+    : input(inputSource)
+{
+    jassert(input != nullptr);
+}
+
+ClickTrackAudioSource::~ClickTrackAudioSource()
+{
+    // 到这里 deck 已经不在音频线程上了
+    patterns.clear();
+}
+
+void ClickTrackAudioSource::setPattern(std::unique_ptr<ClickPattern> newPattern)
+{
+    if (newPattern == nullptr)
+        newPattern = std::make_unique<ClickPattern>();
+
+    patterns.post(std::move(newPattern));
+}
+
+void ClickTrackAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    const int clickLength = std::max(1, juce::roundToInt(clickSeconds * sampleRate));
+    synthesiseClick(downbeatClick, 1760.0, sampleRate, clickLength);
+    synthesiseClick(beatClick, 1320.0, sampleRate, clickLength);
+}
+
+void ClickTrackAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    // 取走消息线程换上的新拍子
+    if (auto* incoming = patterns.takePending())
+    {
+        patterns.retire(activePattern);
+        activePattern = incoming;
+    }
+
+    // 渲染前的源位置就是这一段第一个输出样本对应的源位置
+    const juce::int64 startPosition = input->getNextReadPosition();
+    const double speed = input->getTempo();
+
+    input->getNextAudioBlock(bufferToFill);
+
+    if (!enabled.load() || activePattern == nullptr || activePattern->clicks.empty() || downbeatClick.empty())
+        return;
+
+    // 选择输出声道：单独输出需要设备至少打开了 4 个输出声道，否则混进主输出
+    auto* buffer = bufferToFill.buffer;
+    const bool useSeparateOutput = separateOutput.load() && buffer->getNumChannels() >= separateOutputChannel + 2;
+    const int firstChannel = useSeparateOutput ? separateOutputChannel : 0;
+    const int lastChannel = std::min(buffer->getNumChannels(), firstChannel + 2);
+    const float gain = level.load();
+
+    // 单独输出的声道只放节拍器
+    if (useSeparateOutput)
+        for (int channel = firstChannel; channel < lastChannel; ++channel)
+            buffer->clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+
+    // 覆盖这一段的源区间，往前多取一个 click 的长度，这样上一段开始的 click 会接着响完
+    const int clickLength = static_cast<int>(downbeatClick.size());
+    const auto& clicks = activePattern->clicks;
+    const auto firstSourcePosition = startPosition - static_cast<juce::int64>(std::ceil(clickLength * speed));
+    const auto endSourcePosition = startPosition + static_cast<juce::int64>(std::ceil(bufferToFill.numSamples * speed));
+
+    auto it = std::lower_bound(clicks.begin(), clicks.end(), firstSourcePosition,
+                               [](const ClickPattern::Click& click, juce::int64 position) { return click.position < position; });
+
+    for (; it != clicks.end() && it->position < endSourcePosition; ++it)
+    {
+        // click 开始的输出样本（可能在这一段之前）
+        const int offset = static_cast<int>(std::ceil(static_cast<double>(it->position - startPosition) / speed));
+        const int from = std::max(0, -offset);
+        const int to = std::min(clickLength, bufferToFill.numSamples - offset);
+
+        if (from >= to)
+            continue;
+
+        const auto& click = it->isDownbeat ? downbeatClick : beatClick;
+
+        for (int channel = firstChannel; channel < lastChannel; ++channel)
+            juce::FloatVectorOperations::addWithMultiply(buffer->getWritePointer(channel, bufferToFill.startSample + offset + from),
+                                                         click.data() + from, gain, to - from);
+    }
+}
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    ClickTrackAudioSource.h
+    Created: 20 Oct 2026 9:12:07pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "TimeStretchAudioSource.h"
+#include "AudioThreadHandoff.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 节拍器的拍子位置（源文件的样本），按位置排好序。在消息线程生成后整个交给音频线程。
+struct ClickPattern
+{
+    struct Click
+    {
+        juce::int64 position = 0;
+        bool isDownbeat = false;
+    };
+
+    std::vector<Click> clicks;
+};
+
+// 在音频回调里合成节拍器：放在变速之后、A/B 循环之前，
+// 所以拍子按源文件的时间对齐，但 click 本身不会被变速拉伸，回绕时也跟着回到 A 点。
+// click 波形在 prepareToPlay 中预先算好，回调里只做二分查找和向量加法，不分配内存、不加锁。
+// 可以混进主输出，也可以单独输出到第 3/4 声道（给指挥或乐手的耳机）。
+class ClickTrackAudioSource : public juce::PositionableAudioSource
+{
+public:
+    explicit ClickTrackAudioSource(TimeStretchAudioSource* inputSource);
+    ~ClickTrackAudioSource() override;
+
+    // 消息线程：换上新的拍子（nullptr 表示没有拍子）
+    void setPattern(std::unique_ptr<ClickPattern> newPattern);
+
+    // 以下可以在任意线程调用
+    void setEnabled(bool shouldBeEnabled) { enabled = shouldBeEnabled; }
+    bool isEnabled() const { return enabled.load(); }
+    void setSeparateOutput(bool shouldUseSeparateOutput) { separateOutput = shouldUseSeparateOutput; }
+    void setLevel(float newLevel) { level = newLevel; }
+
+    // 单独输出时使用的第一个声道（第 3/4 声道）
+    static constexpr int separateOutputChannel = 2;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override { input->releaseResources(); }
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override { input->setNextReadPosition(newPosition); }
+    juce::int64 getNextReadPosition() const override { return input->getNextReadPosition(); }
+    juce::int64 getTotalLength() const override { return input->getTotalLength(); }
+    bool isLooping() const override { return input->isLooping(); }
+    void setLooping(bool shouldLoop) override { input->setLooping(shouldLoop); }
+
+private:
+    TimeStretchAudioSource* input;
+
+    std::atomic<bool> enabled { false };
+    std::atomic<bool> separateOutput { false };
+    std::atomic<float> level { 0.5f };
+
+    AudioThreadHandoff<ClickPattern> patterns;
+
+    // 只在音频线程访问
+    ClickPattern* activePattern = nullptr;
+    std::vector<float> downbeatClick, beatClick;
+
+    static constexpr double clickSeconds = 0.03;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ClickTrackAudioSource)
+};
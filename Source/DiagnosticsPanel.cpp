@@ -0,0 +1,265 @@
+/*
+  ==============================================================================
+
+    DiagnosticsPanel.cpp
+    Created: 23 Oct 2026 11:52:07am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "DiagnosticsPanel.h"
+
+#include <algorithm>
+
+namespace
+{
+    juce::String formatMegabytes(size_t bytes)
+    {
+        return juce::String(static_cast<double>(bytes) / (1024.0 * 1024.0), 1);
+    }
+
+    juce::String formatRates(const ActivityMeter::Rates& rates)
+    {
+        if (rates.seconds <= 0.0)
+            return "-";
+
+        return "CPU " + juce::String(rates.cpuPercent, 1) + "%"
+             + "  wakeups " + (rates.wakeupsPerSecond >= 0.0 ? juce::String(rates.wakeupsPerSecond, 1) : juce::String("?")) + "/s"
+             + "  timers " + juce::String(rates.timerCallbacksPerSecond, 1) + "/s"
+             + "  paint " + juce::String(juce::roundToInt(rates.paintedPixelsPerSecond / 1000.0)) + "k px/s";
+    }
+}
+
+DiagnosticsPanel::DiagnosticsPanel(PageTurnLatencyMonitor& monitorToShow, AudioCallbackMonitor& audioMonitorToShow, MemoryAccountant& memoryToShow,
+                                   ActivityMeter& activityToShow, PageTurnLatencyMonitor& inputMonitorToShow)
+    : monitor(monitorToShow), audioMonitor(audioMonitorToShow), memory(memoryToShow), activity(activityToShow),
+      inputMonitor(inputMonitorToShow)
+{
+    for (auto* label : { &summaryLabel, &lastTurnLabel, &inputLabel, &audioLabel, &memoryLabel, &memoryDetailLabel, &activityLabel, &lastActivityLabel })
+    {
+        label->setFont(juce::Font(juce::FontOptions(12.0f)));
+        label->setColour(juce::Label::textColourId, juce::Colours::white);
+        addAndMakeVisible(label);
+    }
+
+    addAndMakeVisible(exportButton);
+    exportButton.onClick = [this] { exportLatencies(); };
+    addAndMakeVisible(clearButton);
+    clearButton.onClick = [this]
+    {
+        monitor.clear();
+        inputMonitor.clear();
+        audioMonitor.reset();
+        refreshAudio();
+    };
+
+    addAndMakeVisible(warningButton);
+    warningButton.setButtonText("Warn > " + juce::String(juce::roundToInt(defaultWarningThreshold * 100.0f)) + "%");
+    warningButton.setToggleState(audioMonitor.getWarningThreshold() > 0.0f, juce::dontSendNotification);
+    warningButton.onClick = [this]
+    {
+        const float threshold = warningButton.getToggleState() ? defaultWarningThreshold : 0.0f;
+        audioMonitor.setWarningThreshold(threshold);
+        if (onWarningThresholdChanged)
+            onWarningThresholdChanged(threshold);
+    };
+
+    refresh();
+    refreshAudio();
+    refreshMemory();
+    refreshActivity();
+}
+
+void DiagnosticsPanel::refresh()
+{
+    const auto& samples = monitor.getSamples();
+
+    summaryLabel.setText("Page turns: " + juce::String(static_cast<int>(samples.size()))
+                         + "  p50 " + juce::String(monitor.getPercentile(0.50), 1)
+                         + "  p95 " + juce::String(monitor.getPercentile(0.95), 1)
+                         + "  max " + juce::String(monitor.getMaximum(), 1) + " ms",
+                         juce::dontSendNotification);
+
+    if (samples.empty())
+    {
+        lastTurnLabel.setText("No page turns yet", juce::dontSendNotification);
+    }
+    else
+    {
+        const auto& last = samples.back();
+        lastTurnLabel.setText("Last (p" + juce::String(last.page + 1) + "): detect " + juce::String(last.detectionMs, 1)
+                              + " + render " + juce::String(last.renderMs, 1)
+                              + " + paint " + juce::String(last.paintMs, 1) + " ms",
+                              juce::dontSendNotification);
+    }
+
+    // 手动翻页：detection 是从输入到消息线程处理
+    if (inputMonitor.getSamples().empty())
+    {
+        inputLabel.setText("No manual page turns yet", juce::dontSendNotification);
+    }
+    else
+    {
+        const auto& last = inputMonitor.getSamples().back();
+        inputLabel.setText("Input turns: " + juce::String(static_cast<int>(inputMonitor.getSamples().size()))
+                           + "  p50 " + juce::String(inputMonitor.getPercentile(0.50), 1)
+                           + "  p95 " + juce::String(inputMonitor.getPercentile(0.95), 1)
+                           + "  max " + juce::String(inputMonitor.getMaximum(), 1) + " ms"
+                           + "  last: dispatch " + juce::String(last.detectionMs, 1)
+                           + " + render " + juce::String(last.renderMs, 1)
+                           + " + paint " + juce::String(last.paintMs, 1),
+                           juce::dontSendNotification);
+    }
+
+    exportButton.setEnabled(!samples.empty());
+    repaint(histogramArea);
+}
+
+void DiagnosticsPanel::refreshAudio()
+{
+    const int deviceXRuns = audioMonitor.getNumDeviceXRuns();
+
+    audioLabel.setText("Audio load " + juce::String(juce::roundToInt(audioMonitor.getAverageLoad() * 100.0f))
+                       + "%  worst " + juce::String(audioMonitor.getWorstCallbackMs(), 2)
+                       + " / " + juce::String(audioMonitor.getDeadlineMs(), 2) + " ms"
+                       + "  overruns " + juce::String(static_cast<int>(audioMonitor.getNumOverruns()))
+                       + "  late " + juce::String(static_cast<int>(audioMonitor.getNumLateCallbacks()))
+                       + "  xruns " + juce::String(deviceXRuns),
+                       juce::dontSendNotification);
+
+    const bool overloaded = audioMonitor.getWorstLoad() > 1.0f || audioMonitor.getNumLateCallbacks() > 0 || deviceXRuns > 0;
+    audioLabel.setColour(juce::Label::textColourId, overloaded ? juce::Colours::orangered : juce::Colours::white);
+    repaint(audioHistogramArea);
+}
+
+void DiagnosticsPanel::refreshMemory()
+{
+    const size_t resident = MemoryAccountant::getResidentBytes();
+    const size_t total = memory.getTotalBytes();
+
+    // 进程驻留内存减去登记过的部分，主要是 Poppler、字体和各种库的堆
+    juce::String text = "Memory " + formatMegabytes(total) + " / " + formatMegabytes(memory.getBudget())
+                      + " MB (peak " + formatMegabytes(memory.getPeakTotalBytes()) + ")";
+    if (resident > 0)
+        text << "  process " << formatMegabytes(resident) << "  other " << formatMegabytes(resident > total ? resident - total : 0);
+    memoryLabel.setText(text, juce::dontSendNotification);
+    memoryLabel.setColour(juce::Label::textColourId, total > memory.getBudget() ? juce::Colours::orangered : juce::Colours::white);
+
+    juce::StringArray details;
+    for (const auto& subsystem : memory.getReport())
+        details.add(subsystem.name + " " + formatMegabytes(subsystem.currentBytes) + "/" + formatMegabytes(subsystem.peakBytes));
+    memoryDetailLabel.setText(details.joinIntoString("  "), juce::dontSendNotification);
+}
+
+void DiagnosticsPanel::refreshActivity()
+{
+    const auto now = activity.getCurrentRates();
+    activityLabel.setText(juce::String(activity.isPlaying() ? "Playing " : "Idle ") + juce::String(juce::roundToInt(now.seconds)) + " s: "
+                          + formatRates(now), juce::dontSendNotification);
+    lastActivityLabel.setText("Last idle: " + formatRates(activity.getIdleRates())
+                              + "   last playing: " + formatRates(activity.getPlayingRates()), juce::dontSendNotification);
+}
+
+void DiagnosticsPanel::visibilityChanged()
+{
+    if (isVisible())
+    {
+        refreshAudio();
+        refreshMemory();
+        refreshActivity();
+        startTimer(500);
+    }
+    else
+    {
+        stopTimer();
+    }
+}
+
+void DiagnosticsPanel::timerCallback()
+{
+    ActivityMeter::noteTimerCallback();
+    refreshAudio();
+    refreshMemory();
+    refreshActivity();
+}
+
+template <typename Bins>
+void DiagnosticsPanel::drawHistogram(juce::Graphics& g, juce::Rectangle<int> area, const Bins& bins, const juce::String& rangeText)
+{
+    if (area.isEmpty())
+        return;
+
+    // 最后一格是所有更大的值
+    const auto highest = std::max<juce::int64>(1, static_cast<juce::int64>(*std::max_element(bins.begin(), bins.end())));
+    const int numBins = static_cast<int>(bins.size());
+    const float binWidth = static_cast<float>(area.getWidth()) / numBins;
+
+    g.setColour(juce::Colours::darkgrey);
+    g.drawHorizontalLine(area.getBottom(), static_cast<float>(area.getX()), static_cast<float>(area.getRight()));
+
+    for (int i = 0; i < numBins; ++i)
+    {
+        const float height = area.getHeight() * static_cast<float>(bins[static_cast<size_t>(i)]) / static_cast<float>(highest);
+        g.setColour(i == numBins - 1 ? juce::Colours::orangered : juce::Colours::deepskyblue);
+        g.fillRect(area.getX() + i * binWidth + 1.0f, area.getBottom() - height, binWidth - 2.0f, height);
+    }
+
+    g.setColour(juce::Colours::grey);
+    g.setFont(10.0f);
+    g.drawText("0", area.getX(), area.getY(), 40, 12, juce::Justification::topLeft);
+    g.drawText(rangeText, area.getRight() - 60, area.getY(), 60, 12, juce::Justification::topRight);
+}
+
+void DiagnosticsPanel::paint(juce::Graphics& g)
+{
+    g.fillAll(juce::Colours::black.withAlpha(0.85f));
+    g.setColour(juce::Colours::pink);
+    g.drawRect(getLocalBounds(), 2);
+
+    // 左边是翻页延迟（每格 histogramBinMs），右边是音频回调负载（每格 10%）
+    drawHistogram(g, histogramArea, monitor.getHistogram(),
+                  juce::String(static_cast<int>(PageTurnLatencyMonitor::numHistogramBins * PageTurnLatencyMonitor::histogramBinMs)) + "+ ms");
+    drawHistogram(g, audioHistogramArea, audioMonitor.getHistogram(),
+                  juce::String(juce::roundToInt(AudioCallbackMonitor::numHistogramBins * AudioCallbackMonitor::histogramBinLoad * 100.0f)) + "+ %");
+}
+
+void DiagnosticsPanel::resized()
+{
+    auto area = getLocalBounds().reduced(6);
+
+    auto buttons = area.removeFromBottom(22);
+    clearButton.setBounds(buttons.removeFromRight(60));
+    buttons.removeFromRight(4);
+    exportButton.setBounds(buttons.removeFromRight(60));
+    warningButton.setBounds(buttons.removeFromLeft(100));
+
+    for (auto* label : { &summaryLabel, &lastTurnLabel, &inputLabel, &audioLabel, &memoryLabel, &memoryDetailLabel, &activityLabel, &lastActivityLabel })
+        label->setBounds(area.removeFromTop(16));
+    area.removeFromBottom(4);
+    histogramArea = area.removeFromLeft(area.getWidth() / 2).withTrimmedRight(6);
+    audioHistogramArea = area;
+}
+
+void DiagnosticsPanel::exportLatencies()
+{
+    fileChooser = std::make_unique<juce::FileChooser>(
+        "Export page turn latencies",
+        juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("page-turn-latency.json"),
+        "*.json");
+
+    juce::Component::SafePointer<DiagnosticsPanel> safeThis(this);
+    fileChooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles,
+                             [safeThis](const juce::FileChooser& fc)
+    {
+        auto* strongThis = safeThis.getComponent();
+        if (strongThis == nullptr)
+            return;
+
+        const auto file = fc.getResult();
+        if (file != juce::File{} && !file.replaceWithText(strongThis->monitor.toJson()))
+            DBG("Failed to export page turn latencies: " + file.getFullPathName());
+
+        strongThis->fileChooser.reset();
+    });
+}
@@ -0,0 +1,72 @@
+/*
+  ==============================================================================
+
+    DiagnosticsPanel.h
+    Created: 23 Oct 2026 11:52:07am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "PageTurnLatency.h"
+#include "AudioCallbackMonitor.h"
+#include "MemoryAccountant.h"
+#include "ActivityMeter.h"
+
+#include <functional>
+#include <memory>
+
+// 诊断面板：翻页延迟的 p50/p95/最大值、最近一次翻页的分解和直方图，可以把样本导出成 JSON；
+// 手动翻页（按钮、踏板、MIDI、键盘）从输入到画面的延迟；
+// 音频回调的负载、最坏耗时、超时和 xrun 计数，以及负载直方图；各子系统的内存用量和峰值；
+// 当前和最近一段空闲/播放时的 CPU、唤醒次数、定时器回调和重绘像素（显示时每半秒刷新，面板自己的定时器也算在内）。
+class DiagnosticsPanel : public juce::Component,
+                         private juce::Timer
+{
+public:
+    DiagnosticsPanel(PageTurnLatencyMonitor& monitorToShow, AudioCallbackMonitor& audioMonitorToShow, MemoryAccountant& memoryToShow,
+                     ActivityMeter& activityToShow, PageTurnLatencyMonitor& inputMonitorToShow);
+
+    // 有新样本时调用（消息线程）
+    void refresh();
+
+    // 负载警告开关变化时调用，参数是阈值（0 表示关闭）
+    std::function<void(float)> onWarningThresholdChanged;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    void visibilityChanged() override;
+
+    static constexpr float defaultWarningThreshold = 0.8f;
+
+private:
+    void timerCallback() override;
+    void refreshAudio();
+    void refreshMemory();
+    void refreshActivity();
+    void exportLatencies();
+
+    template <typename Bins>
+    static void drawHistogram(juce::Graphics& g, juce::Rectangle<int> area, const Bins& bins, const juce::String& rangeText);
+
+    PageTurnLatencyMonitor& monitor;
+    AudioCallbackMonitor& audioMonitor;
+    MemoryAccountant& memory;
+    ActivityMeter& activity;
+    PageTurnLatencyMonitor& inputMonitor;
+    juce::Label summaryLabel;
+    juce::Label lastTurnLabel;
+    juce::Label inputLabel;
+    juce::Label audioLabel;
+    juce::Label memoryLabel, memoryDetailLabel;
+    juce::Label activityLabel, lastActivityLabel;
+    juce::ToggleButton warningButton{ "Warn" };
+    juce::TextButton exportButton{ "Export" };
+    juce::TextButton clearButton{ "Clear" };
+    juce::Rectangle<int> histogramArea, audioHistogramArea;
+    std::unique_ptr<juce::FileChooser> fileChooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DiagnosticsPanel)
+};
@@ -0,0 +1,129 @@
+/*
+  ==============================================================================
+
+    ImageDownsampler.cpp
+    Created: 19 Oct 2026 2:10:12pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "ImageDownsampler.h"
+
+namespace
+{
+    // 一个目标像素覆盖的源像素区间，以及它在权重表中的起始位置
+    struct Span
+    {
+        int first = 0;
+        int count = 0;
+        int weightIndex = 0;
+    };
+
+    // 计算每个目标像素覆盖的源像素和对应的面积权重（每个目标像素的权重之和为 1）
+    void buildSpans(int srcSize, int dstSize, std::vector<Span>& spans, std::vector<float>& weights)
+    {
+        const double scale = static_cast<double>(srcSize) / dstSize;
+
+        spans.resize(static_cast<size_t>(dstSize));
+        weights.clear();
+
+        for (int i = 0; i < dstSize; ++i)
+        {
+            const double start = i * scale;
+            const double end = (i + 1) * scale;
+            const int first = static_cast<int>(std::floor(start));
+            const int last = std::min(srcSize, static_cast<int>(std::ceil(end)));
+
+            spans[static_cast<size_t>(i)] = { first, last - first, static_cast<int>(weights.size()) };
+
+            for (int j = first; j < last; ++j)
+            {
+                const double overlap = std::min(end, static_cast<double>(j + 1)) - std::max(start, static_cast<double>(j));
+                weights.push_back(static_cast<float>(overlap / scale));
+            }
+        }
+    }
+
+    inline juce::uint8 toByte(float value)
+    {
+        return static_cast<juce::uint8>(juce::jlimit(0, 255, juce::roundToInt(value)));
+    }
+}
+
+juce::Image downsampleImage(const juce::Image& source, int width, int height)
+{
+    if (! source.isValid() || width <= 0 || height <= 0)
+        return {};
+
+    if (width == source.getWidth() && height == source.getHeight())
+        return source;
+
+    // 放大时面积平均没有意义，直接交给 JUCE
+    if (width > source.getWidth() || height > source.getHeight())
+        return source.rescaled(width, height, juce::Graphics::mediumResamplingQuality);
+
+    const juce::Image src = source.getFormat() == juce::Image::ARGB ? source
+                                                                    : source.convertedToFormat(juce::Image::ARGB);
+    const int srcWidth = src.getWidth();
+    const int srcHeight = src.getHeight();
+    const int rowValues = srcWidth * 4;
+
+    std::vector<Span> columnSpans, rowSpans;
+    std::vector<float> columnWeights, rowWeights;
+    buildSpans(srcWidth, width, columnSpans, columnWeights);
+    buildSpans(srcHeight, height, rowSpans, rowWeights);
+
+    std::vector<float> sourceRow(static_cast<size_t>(rowValues));
+    std::vector<float> accumulatedRow(static_cast<size_t>(rowValues));
+
+    juce::Image result(juce::Image::ARGB, width, height, false);
+    const juce::Image::BitmapData srcData(src, juce::Image::BitmapData::readOnly);
+    juce::Image::BitmapData dstData(result, juce::Image::BitmapData::writeOnly);
+    jassert(srcData.pixelStride == 4 && dstData.pixelStride == 4);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const Span& rowSpan = rowSpans[static_cast<size_t>(y)];
+
+        // 纵向：把覆盖的源行按权重累加到一行浮点缓冲里（向量化）
+        juce::FloatVectorOperations::clear(accumulatedRow.data(), rowValues);
+
+        for (int k = 0; k < rowSpan.count; ++k)
+        {
+            const juce::uint8* line = srcData.getLinePointer(rowSpan.first + k);
+
+            for (int i = 0; i < rowValues; ++i)
+                sourceRow[static_cast<size_t>(i)] = static_cast<float>(line[i]);
+
+            juce::FloatVectorOperations::addWithMultiply(accumulatedRow.data(), sourceRow.data(),
+                                                         rowWeights[static_cast<size_t>(rowSpan.weightIndex + k)], rowValues);
+        }
+
+        // 横向：每个目标像素对覆盖的源像素的四个通道加权求和
+        juce::uint8* out = dstData.getLinePointer(y);
+
+        for (int x = 0; x < width; ++x)
+        {
+            const Span& columnSpan = columnSpans[static_cast<size_t>(x)];
+            const float* pixel = accumulatedRow.data() + columnSpan.first * 4;
+            const float* weight = columnWeights.data() + columnSpan.weightIndex;
+            float c0 = 0.0f, c1 = 0.0f, c2 = 0.0f, c3 = 0.0f;
+
+            for (int k = 0; k < columnSpan.count; ++k, pixel += 4)
+            {
+                c0 += pixel[0] * weight[k];
+                c1 += pixel[1] * weight[k];
+                c2 += pixel[2] * weight[k];
+                c3 += pixel[3] * weight[k];
+            }
+
+            out[x * 4 + 0] = toByte(c0);
+            out[x * 4 + 1] = toByte(c1);
+            out[x * 4 + 2] = toByte(c2);
+            out[x * 4 + 3] = toByte(c3);
+        }
+    }
+
+    return result;
+}
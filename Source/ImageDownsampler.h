@@ -0,0 +1,17 @@
+/*
+  ==============================================================================
+
+    ImageDownsampler.h
+    Created: 19 Oct 2026 2:10:12pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+// 面积平均（box filter）缩小图像，在预乘 ARGB 空间里计算，结果与源图保持同一宽高比由调用者决定。
+// 纵向累加用 juce::FloatVectorOperations（SSE/NEON），只在目标尺寸小于源尺寸时使用；
+// 如果需要放大，则退回到 juce::Image::rescaled。
+juce::Image downsampleImage(const juce::Image& source, int width, int height);
@@ -0,0 +1,188 @@
+/*
+  ==============================================================================
+
+    LatestRequestWorker.h
+    Created: 25 Oct 2026 9:14:36am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// 后台加载器的公共部分：一个工作线程，连续请求时只保留最新的一个。
+// 每个请求有一个代数；新请求（或 cancel）让之前没开始的请求作废，正在做的可以用 isStale 提前放弃，
+// 做完的结果如果已经过时就丢掉。结果通过 AsyncUpdater 在消息线程交给 onResult，最新的请求全部交完后调用 onIdle。
+// process、onResult 和 onIdle 要在 start 之前设置；拥有者析构时先调用 stop，process 用到的成员那时还在。
+template <typename Request, typename Result>
+class LatestRequestWorker : private juce::Thread,
+                            private juce::AsyncUpdater
+{
+public:
+    LatestRequestWorker(const juce::String& threadName, juce::Thread::Priority priorityToUse, int stopTimeoutMsToUse)
+        : juce::Thread(threadName), priority(priorityToUse), stopTimeoutMs(stopTimeoutMsToUse)
+    {
+    }
+
+    ~LatestRequestWorker() override
+    {
+        stop();
+    }
+
+    void start() { startThread(priority); }
+
+    void stop()
+    {
+        cancelPendingUpdate();
+        signalThreadShouldExit();
+        workAvailable.signal();
+        stopThread(stopTimeoutMs);
+    }
+
+    // 替换掉之前的请求，还没交出的结果一起作废
+    void request(Request newRequest)
+    {
+        const juce::ScopedLock sl(lock);
+        pendingRequest = std::move(newRequest);
+        hasRequest = true;
+        ++requestGeneration;
+        results.clear();
+        workAvailable.signal();
+    }
+
+    // 消息线程：作废所有请求；之前还在忙时马上调用 onIdle
+    void cancel()
+    {
+        bool wasBusy = false;
+        {
+            const juce::ScopedLock sl(lock);
+            wasBusy = deliveredGeneration != requestGeneration.load();
+            hasRequest = false;
+            ++requestGeneration;
+            results.clear();
+            finishedGeneration = deliveredGeneration = requestGeneration.load();
+        }
+
+        if (wasBusy && onIdle)
+            onIdle();
+    }
+
+    // 工作线程：这个请求已经过时（或线程要退出），可以放弃
+    bool isStale(int generation) const
+    {
+        return threadShouldExit() || generation != requestGeneration.load();
+    }
+
+    // 最近的请求还没做完，或者结果还没交给 onResult
+    bool isBusy() const
+    {
+        const juce::ScopedLock sl(lock);
+        return deliveredGeneration != requestGeneration.load();
+    }
+
+    // 工作线程：交出一个结果，一个请求可以交出多个；请求已经过时则丢掉
+    void emit(int generation, Result result)
+    {
+        {
+            const juce::ScopedLock sl(lock);
+            if (generation != requestGeneration.load())
+                return;
+
+            results.push_back(std::move(result));
+        }
+
+        triggerAsyncUpdate();
+    }
+
+    // 在工作线程上处理一个请求，通过 emit 交出结果
+    std::function<void(const Request& request, int generation)> process;
+
+    // 在消息线程上调用
+    std::function<void(Result result)> onResult;
+
+    // 在消息线程上调用：最新的请求做完、结果也都交给 onResult 之后（isBusy 从 true 变成 false）
+    std::function<void()> onIdle;
+
+private:
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            Request current;
+            int generation = -1;
+
+            {
+                const juce::ScopedLock sl(lock);
+
+                if (hasRequest)
+                {
+                    current = pendingRequest;
+                    generation = requestGeneration.load();
+                    hasRequest = false;
+                }
+            }
+
+            if (generation < 0)
+            {
+                workAvailable.wait(-1);
+                continue;
+            }
+
+            process(current, generation);
+
+            {
+                const juce::ScopedLock sl(lock);
+                if (generation != requestGeneration.load())
+                    continue;
+
+                finishedGeneration = generation;
+            }
+
+            triggerAsyncUpdate();
+        }
+    }
+
+    void handleAsyncUpdate() override
+    {
+        std::vector<Result> ready;
+        bool becameIdle = false;
+
+        {
+            const juce::ScopedLock sl(lock);
+            ready.swap(results);
+
+            // 最后一个结果可能在工作线程记下 finishedGeneration 之前就交出了，
+            // 那时还不算空闲；工作线程记下之后会再触发一次，在那一次里报告空闲
+            const bool wasBusy = deliveredGeneration != requestGeneration.load();
+            deliveredGeneration = finishedGeneration;
+            becameIdle = wasBusy && deliveredGeneration == requestGeneration.load();
+        }
+
+        for (auto& result : ready)
+            if (onResult)
+                onResult(std::move(result));
+
+        // onResult 里可能又发了新请求
+        if (becameIdle && !isBusy() && onIdle)
+            onIdle();
+    }
+
+    const juce::Thread::Priority priority;
+    const int stopTimeoutMs;
+
+    mutable juce::CriticalSection lock;
+    Request pendingRequest {};
+    bool hasRequest = false;
+    std::atomic<int> requestGeneration { 0 };
+    int finishedGeneration = 0;   // 工作线程做完的请求
+    int deliveredGeneration = 0;  // 结果已经在消息线程交出的请求
+    std::vector<Result> results;
+    juce::WaitableEvent workAvailable;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LatestRequestWorker)
+};
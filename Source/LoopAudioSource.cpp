@@ -0,0 +1,292 @@
+/*
+  ==============================================================================
+
+    LoopAudioSource.cpp
+    Created: 20 Oct 2026 3:41:18pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "LoopAudioSource.h"
+
+std::unique_ptr<LoopRegion> LoopRegion::read(juce::AudioFormatReader& reader, juce::int64 startSample, juce::int64 endSample)
+{
+    startSample = juce::jlimit<juce::int64>(0, reader.lengthInSamples, startSample);
+    endSample = juce::jlimit<juce::int64>(0, reader.lengthInSamples, endSample);
+
+    if (endSample - startSample < static_cast<juce::int64>(minimumLengthSeconds * reader.sampleRate))
+        return nullptr;
+
+    // 多读一段 B 点之后的尾巴：交叉淡出和变速的预读都落在内存里
+    const juce::int64 tailEnd = std::min(reader.lengthInSamples, endSample + static_cast<juce::int64>(tailSeconds * reader.sampleRate));
+    const int numSamples = static_cast<int>(tailEnd - startSample);
+
+    auto region = std::make_unique<LoopRegion>();
+    region->start = startSample;
+    region->end = endSample;
+    region->sampleRate = reader.sampleRate;
+    region->audio.setSize(static_cast<int>(juce::jmax(1u, reader.numChannels)), numSamples);
+
+    if (!reader.read(&region->audio, 0, numSamples, startSample, true, true))
+        return nullptr;
+
+    return region;
+}
+
+std::unique_ptr<LoopRegion> LoopRegion::readStems(const std::vector<std::unique_ptr<juce::AudioFormatReader>>& readers,
+                                                  juce::int64 startSample, juce::int64 endSample)
+{
+    if (readers.empty())
+        return nullptr;
+
+    // 以最长的一轨为准，短的分轨读到结尾之后 reader 会补零
+    juce::int64 lengthInSamples = 0;
+    for (const auto& reader : readers)
+    {
+        if (reader == nullptr || reader->sampleRate != readers.front()->sampleRate)
+            return nullptr;
+
+        lengthInSamples = std::max(lengthInSamples, reader->lengthInSamples);
+    }
+
+    const double sampleRate = readers.front()->sampleRate;
+    startSample = juce::jlimit<juce::int64>(0, lengthInSamples, startSample);
+    endSample = juce::jlimit<juce::int64>(0, lengthInSamples, endSample);
+
+    if (endSample - startSample < static_cast<juce::int64>(minimumLengthSeconds * sampleRate))
+        return nullptr;
+
+    const juce::int64 tailEnd = std::min(lengthInSamples, endSample + static_cast<juce::int64>(tailSeconds * sampleRate));
+    const int numSamples = static_cast<int>(tailEnd - startSample);
+
+    auto region = std::make_unique<LoopRegion>();
+    region->start = startSample;
+    region->end = endSample;
+    region->sampleRate = sampleRate;
+    region->stemAudio.resize(readers.size());
+
+    for (size_t i = 0; i < readers.size(); ++i)
+    {
+        auto& stemAudio = region->stemAudio[i];
+        stemAudio.setSize(static_cast<int>(juce::jmax(1u, readers[i]->numChannels)), numSamples);
+
+        if (!readers[i]->read(&stemAudio, 0, numSamples, startSample, true, true))
+            return nullptr;
+    }
+
+    return region;
+}
+
+size_t LoopRegion::getMemoryUsage() const
+{
+    auto bufferBytes = [](const juce::AudioBuffer<float>& buffer)
+    {
+        return static_cast<size_t>(buffer.getNumChannels()) * static_cast<size_t>(buffer.getNumSamples()) * sizeof(float);
+    };
+
+    size_t bytes = bufferBytes(audio);
+    for (const auto& stem : stemAudio)
+        bytes += bufferBytes(stem);
+
+    return bytes;
+}
+
+//==============================================================================
+LoopPrefetchSource::LoopPrefetchSource(juce::PositionableAudioSource* inputSource, MultiStemAudioSource* stemsToMix)
+    : input(inputSource),
+      stems(stemsToMix)
+{
+    jassert(input != nullptr);
+}
+
+void LoopPrefetchSource::setNextReadPosition(juce::int64 newPosition)
+{
+    position = newPosition;
+    inputNeedsSeek = true;
+}
+
+void LoopPrefetchSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    auto* buffer = bufferToFill.buffer;
+    juce::int64 readPosition = position.load();
+    int numDone = 0;
+
+    while (numDone < bufferToFill.numSamples)
+    {
+        const int numLeft = bufferToFill.numSamples - numDone;
+        const juce::int64 regionEnd = region != nullptr ? region->start + region->getNumSamples() : 0;
+
+        if (region != nullptr && readPosition >= region->start && readPosition < regionEnd)
+        {
+            // 区间内：直接从内存复制
+            const int numToCopy = static_cast<int>(std::min<juce::int64>(numLeft, regionEnd - readPosition));
+            const int offset = static_cast<int>(readPosition - region->start);
+
+            if (!region->stemAudio.empty())
+            {
+                // 多轨：从内存里的各轨混音，不读也不 seek 各轨的预读缓冲
+                if (stems != nullptr)
+                    stems->mixFromMemory(region->stemAudio, offset, juce::AudioSourceChannelInfo(buffer, bufferToFill.startSample + numDone, numToCopy));
+                else
+                    buffer->clear(bufferToFill.startSample + numDone, numToCopy);
+
+                readPosition += numToCopy;
+                numDone += numToCopy;
+                inputNeedsSeek = true;
+                continue;
+            }
+
+            // 单声道文件复制到左右两个声道，多出来的声道（例如节拍器单独输出）保持静音
+            const int numRegionChannels = region->audio.getNumChannels();
+            for (int channel = 0; channel < buffer->getNumChannels(); ++channel)
+            {
+                if (channel < numRegionChannels || channel == 1)
+                    buffer->copyFrom(channel, bufferToFill.startSample + numDone, region->audio,
+                                     std::min(channel, numRegionChannels - 1), offset, numToCopy);
+                else
+                    buffer->clear(channel, bufferToFill.startSample + numDone, numToCopy);
+            }
+
+            readPosition += numToCopy;
+            numDone += numToCopy;
+            inputNeedsSeek = true;
+        }
+        else
+        {
+            // 区间外：从文件读，读到区间起点为止
+            int numToRead = numLeft;
+            if (region != nullptr && readPosition < region->start)
+                numToRead = static_cast<int>(std::min<juce::int64>(numToRead, region->start - readPosition));
+
+            if (inputNeedsSeek)
+            {
+                input->setNextReadPosition(readPosition);
+                inputNeedsSeek = false;
+            }
+
+            input->getNextAudioBlock(juce::AudioSourceChannelInfo(buffer, bufferToFill.startSample + numDone, numToRead));
+            readPosition += numToRead;
+            numDone += numToRead;
+        }
+    }
+
+    position = readPosition;
+}
+
+//==============================================================================
+LoopAudioSource::LoopAudioSource(juce::PositionableAudioSource* inputSource, TimeStretchAudioSource* stretchSource, LoopPrefetchSource* prefetchSource)
+    : input(inputSource),
+      stretch(stretchSource),
+      prefetch(prefetchSource)
+{
+    jassert(input != nullptr && stretch != nullptr && prefetch != nullptr);
+}
+
+LoopAudioSource::~LoopAudioSource()
+{
+    // 到这里 deck 已经不在音频线程上了
+    regions.clear();
+}
+
+void LoopAudioSource::setRegion(std::unique_ptr<LoopRegion> newRegion)
+{
+    // 取消循环也通过一个空区间交给音频线程，这样和切换区间走同一条路径
+    if (newRegion == nullptr)
+        newRegion = std::make_unique<LoopRegion>();
+
+    currentRegion = regions.post(std::move(newRegion));
+}
+
+void LoopAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    fadeLengthSamples = std::max(1, juce::roundToInt(crossfadeSeconds * sampleRate));
+    fadeBuffer.setSize(maxChannels, fadeLengthSamples);
+    fadeRemaining = 0;
+}
+
+void LoopAudioSource::setNextReadPosition(juce::int64 newPosition)
+{
+    input->setNextReadPosition(newPosition);
+    seekRequested = true;
+}
+
+void LoopAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    // 取走消息线程设置的新区间
+    if (auto* incoming = regions.takePending())
+    {
+        regions.retire(activeRegion);
+        activeRegion = incoming;
+        prefetch->setRegion(activeRegion->isActive() ? activeRegion : nullptr);
+    }
+
+    // 用户 seek 后不再混入上一遍的尾巴
+    if (seekRequested.exchange(false))
+        fadeRemaining = 0;
+
+    if (activeRegion == nullptr || !activeRegion->isActive())
+    {
+        input->getNextAudioBlock(bufferToFill);
+        return;
+    }
+
+    const int numChannels = std::min(bufferToFill.buffer->getNumChannels(), maxChannels);
+    int numDone = 0;
+
+    while (numDone < bufferToFill.numSamples)
+    {
+        const juce::int64 position = input->getNextReadPosition();
+        int numToRender = bufferToFill.numSamples - numDone;
+
+        // 还没到 B 点：只渲染到 B 点为止（按当前速度换算成输出样本数）
+        const bool beforeEnd = position < activeRegion->end;
+        if (beforeEnd)
+        {
+            const double samplesToEnd = static_cast<double>(activeRegion->end - position) / stretch->getTempo();
+            numToRender = std::min(numToRender, std::max(1, static_cast<int>(std::ceil(samplesToEnd))));
+        }
+
+        input->getNextAudioBlock(juce::AudioSourceChannelInfo(bufferToFill.buffer, bufferToFill.startSample + numDone, numToRender));
+        mixFadeTail(bufferToFill, numDone, numToRender, numChannels);
+        numDone += numToRender;
+
+        // 正好播放到 B 点：回到 A 点（从 B 点之后开始 seek 的不算）
+        if (beforeEnd && input->getNextReadPosition() >= activeRegion->end)
+            wrapToLoopStart(numChannels);
+    }
+}
+
+void LoopAudioSource::wrapToLoopStart(int numChannels)
+{
+    // 先把 B 点之后的一小段渲染到淡出缓冲，再回到 A 点；接下来的输出和它交叉淡化
+    juce::AudioBuffer<float> fadeView(fadeBuffer.getArrayOfWritePointers(), numChannels, fadeLengthSamples);
+    input->getNextAudioBlock(juce::AudioSourceChannelInfo(&fadeView, 0, fadeLengthSamples));
+
+    input->setNextReadPosition(activeRegion->start);
+    fadeRead = 0;
+    fadeRemaining = fadeLengthSamples;
+}
+
+void LoopAudioSource::mixFadeTail(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, int numChannels)
+{
+    const int numToMix = std::min(numSamples, fadeRemaining);
+    if (numToMix <= 0)
+        return;
+
+    const float startGain = static_cast<float>(fadeRemaining) / static_cast<float>(fadeLengthSamples);
+    const float endGain = static_cast<float>(fadeRemaining - numToMix) / static_cast<float>(fadeLengthSamples);
+    const int startSample = bufferToFill.startSample + offset;
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        // A 点的声音淡入，B 点之后的尾巴淡出
+        bufferToFill.buffer->applyGainRamp(channel, startSample, numToMix, 1.0f - startGain, 1.0f - endGain);
+        bufferToFill.buffer->addFromWithRamp(channel, startSample, fadeBuffer.getReadPointer(channel, fadeRead), numToMix, startGain, endGain);
+    }
+
+    fadeRead += numToMix;
+    fadeRemaining -= numToMix;
+}
@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    LoopAudioSource.h
+    Created: 20 Oct 2026 3:41:18pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "TimeStretchAudioSource.h"
+#include "MultiStemAudioSource.h"
+#include "AudioThreadHandoff.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// A/B 循环区间：[start, end) 以源文件的样本为单位，音频整个预先读进内存。
+// audio 的第 0 个样本对应源位置 start，长度多出一小段 end 之后的尾巴，用于回绕时的交叉淡出。
+// 多轨时 audio 为空，各轨分别存在 stemAudio 里（顺序和 MultiStemAudioSource 的分轨一致），播放时再按各轨增益混音。
+struct LoopRegion
+{
+    // 在后台线程从一个独立的 reader 读取；区间太短或读取失败时返回 nullptr
+    static std::unique_ptr<LoopRegion> read(juce::AudioFormatReader& reader, juce::int64 startSample, juce::int64 endSample);
+    static std::unique_ptr<LoopRegion> readStems(const std::vector<std::unique_ptr<juce::AudioFormatReader>>& readers,
+                                                 juce::int64 startSample, juce::int64 endSample);
+
+    bool isActive() const { return end > start; }
+    int getNumSamples() const { return stemAudio.empty() ? audio.getNumSamples() : stemAudio.front().getNumSamples(); }
+    size_t getMemoryUsage() const;
+    double getStartSeconds() const { return sampleRate > 0.0 ? static_cast<double>(start) / sampleRate : 0.0; }
+    double getEndSeconds() const { return sampleRate > 0.0 ? static_cast<double>(end) / sampleRate : 0.0; }
+
+    juce::File file;
+    juce::int64 start = 0, end = 0;
+    double sampleRate = 0.0;
+    juce::AudioBuffer<float> audio;
+    std::vector<juce::AudioBuffer<float>> stemAudio;
+
+    static constexpr double minimumLengthSeconds = 0.1;
+    static constexpr double tailSeconds = 0.25;
+};
+
+// 放在读取源和变速之间：读取位置落在循环区间（含尾巴）内时直接从内存取，
+// 回绕到 A 点时不需要 seek 文件（多轨时也不需要 seek 各轨的预读缓冲）。只在音频线程使用。
+class LoopPrefetchSource : public juce::PositionableAudioSource
+{
+public:
+    // stemsToMix 不为 nullptr 时 inputSource 就是它，多轨的区间交给它按当前增益混音
+    explicit LoopPrefetchSource(juce::PositionableAudioSource* inputSource, MultiStemAudioSource* stemsToMix = nullptr);
+    ~LoopPrefetchSource() override = default;
+
+    // 音频线程：设置当前使用的循环区间（nullptr 表示全部从文件读）
+    void setRegion(const LoopRegion* newRegion) { region = newRegion; }
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override { input->prepareToPlay(samplesPerBlockExpected, sampleRate); }
+    void releaseResources() override { input->releaseResources(); }
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return position.load(); }
+    juce::int64 getTotalLength() const override { return input->getTotalLength(); }
+    bool isLooping() const override { return input->isLooping(); }
+    void setLooping(bool shouldLoop) override { input->setLooping(shouldLoop); }
+
+private:
+    juce::PositionableAudioSource* input;
+    MultiStemAudioSource* stems;
+    const LoopRegion* region = nullptr;
+    std::atomic<juce::int64> position { 0 };
+    bool inputNeedsSeek = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopPrefetchSource)
+};
+
+// 在音频回调里实现 A/B 循环：播放到 B 点的那个样本时立刻回到 A 点，
+// 越过 B 点的一小段尾巴和 A 点开始的声音做短交叉淡化，避免咔嗒声。
+// 放在变速（和节拍器）之后，所以无论什么速度都按源文件的样本位置精确回绕。
+// 循环区间由消息线程通过 AudioThreadHandoff 交给音频线程，旧区间再交回消息线程释放。
+class LoopAudioSource : public juce::PositionableAudioSource
+{
+public:
+    LoopAudioSource(juce::PositionableAudioSource* inputSource, TimeStretchAudioSource* stretchSource, LoopPrefetchSource* prefetchSource);
+    ~LoopAudioSource() override;
+
+    // 消息线程：设置新的循环区间，nullptr 表示取消循环
+    void setRegion(std::unique_ptr<LoopRegion> newRegion);
+    const LoopRegion* getRegion() const { return currentRegion; }
+    bool hasLoopRegion() const { return currentRegion != nullptr && currentRegion->isActive(); }
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override { input->releaseResources(); }
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return input->getNextReadPosition(); }
+    juce::int64 getTotalLength() const override { return input->getTotalLength(); }
+    bool isLooping() const override { return input->isLooping(); }
+    void setLooping(bool shouldLoop) override { input->setLooping(shouldLoop); }
+
+private:
+    void wrapToLoopStart(int numChannels);
+    void mixFadeTail(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, int numChannels);
+
+    juce::PositionableAudioSource* input;
+    TimeStretchAudioSource* stretch;  // 用来把源样本换算成输出样本
+    LoopPrefetchSource* prefetch;
+
+    AudioThreadHandoff<LoopRegion> regions;
+    LoopRegion* currentRegion = nullptr;  // 最近交出的区间（消息线程）
+
+    // 消息线程 -> 音频线程
+    std::atomic<bool> seekRequested { false };
+
+    // 只在音频线程访问
+    LoopRegion* activeRegion = nullptr;
+    juce::AudioBuffer<float> fadeBuffer;
+    int fadeLengthSamples = 0;
+    int fadeRead = 0, fadeRemaining = 0;
+
+    static constexpr double crossfadeSeconds = 0.01;
+    static constexpr int maxChannels = 8;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopAudioSource)
+};
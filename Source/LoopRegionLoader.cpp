@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    LoopRegionLoader.cpp
+    Created: 20 Oct 2026 4:07:32pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "LoopRegionLoader.h"
+
+LoopRegionLoader::LoopRegionLoader(juce::AudioFormatManager& formatManagerToUse)
+    : formatManager(formatManagerToUse)
+{
+    worker.process = [this](const Request& request, int generation) { process(request, generation); };
+    worker.onResult = [this](std::unique_ptr<LoopRegion> region)
+    {
+        if (region != nullptr && onLoaded)
+            onLoaded(std::move(region));
+    };
+    worker.start();
+}
+
+LoopRegionLoader::~LoopRegionLoader()
+{
+    worker.stop();
+}
+
+void LoopRegionLoader::load(const juce::File& audioFile, double startSeconds, double endSeconds)
+{
+    worker.request({ audioFile, {}, std::min(startSeconds, endSeconds), std::max(startSeconds, endSeconds) });
+}
+
+void LoopRegionLoader::loadStems(const juce::File& deckFile, const juce::Array<juce::File>& stemFiles, double startSeconds, double endSeconds)
+{
+    worker.request({ deckFile, stemFiles, std::min(startSeconds, endSeconds), std::max(startSeconds, endSeconds) });
+}
+
+void LoopRegionLoader::process(const Request& request, int generation)
+{
+    // 用独立的 reader 读取，不影响音频线程正在使用的那个
+    std::vector<std::unique_ptr<juce::AudioFormatReader>> readers;
+    const auto files = request.stemFiles.isEmpty() ? juce::Array<juce::File> { request.file } : request.stemFiles;
+
+    for (const auto& file : files)
+    {
+        readers.emplace_back(formatManager.createReaderFor(file));
+        if (readers.back() == nullptr)
+        {
+            DBG("Failed to open audio file for loop region: " + file.getFullPathName());
+            return;
+        }
+    }
+
+    const double sampleRate = readers.front()->sampleRate;
+    const auto startSample = static_cast<juce::int64>(request.startSeconds * sampleRate);
+    const auto endSample = static_cast<juce::int64>(request.endSeconds * sampleRate);
+    auto region = request.stemFiles.isEmpty() ? LoopRegion::read(*readers.front(), startSample, endSample)
+                                              : LoopRegion::readStems(readers, startSample, endSample);
+    if (region == nullptr)
+    {
+        DBG("Loop region is too short or could not be read");
+        return;
+    }
+
+    region->file = request.file;
+    worker.emit(generation, std::move(region));
+}
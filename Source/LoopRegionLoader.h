@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    LoopRegionLoader.h
+    Created: 20 Oct 2026 4:07:32pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "LoopAudioSource.h"
+#include "LatestRequestWorker.h"
+
+#include <functional>
+#include <memory>
+
+// 在后台线程用独立的 reader 把 A/B 循环区间读进内存，完成后在消息线程回调。
+// 多轨时每轨分别读取。连续请求时只保留最新的一个。
+class LoopRegionLoader
+{
+public:
+    explicit LoopRegionLoader(juce::AudioFormatManager& formatManagerToUse);
+    ~LoopRegionLoader();
+
+    void load(const juce::File& audioFile, double startSeconds, double endSeconds);
+    // deckFile 是多轨 deck 的 file，用来和当前 deck 对应；stemFiles 的顺序和 MultiStemAudioSource 的分轨一致
+    void loadStems(const juce::File& deckFile, const juce::Array<juce::File>& stemFiles, double startSeconds, double endSeconds);
+    void cancel() { worker.cancel(); }
+
+    // 在消息线程上调用
+    std::function<void(std::unique_ptr<LoopRegion> region)> onLoaded;
+
+private:
+    struct Request
+    {
+        juce::File file;
+        juce::Array<juce::File> stemFiles;
+        double startSeconds = 0.0, endSeconds = 0.0;
+    };
+
+    void process(const Request& request, int generation);
+
+    juce::AudioFormatManager& formatManager;
+    LatestRequestWorker<Request, std::unique_ptr<LoopRegion>> worker { "Loop region loader", juce::Thread::Priority::normal, 4000 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoopRegionLoader)
+};
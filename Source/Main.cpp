@@ -8,6 +8,11 @@
 
 #include <JuceHeader.h>
 #include "MainComponent.h"
+#include "BatchProcessor.h"
+#include "Trace.h"
+#include "StartupProfile.h"
+
+#include <iostream>
 
 //==============================================================================
 class playerApplication  : public juce::JUCEApplication
@@ -24,8 +29,84 @@ public:
     void initialise (const juce::String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
+        StartupProfile::mark ("initialise");
+
+        // 批处理模式：不打开窗口，处理完整个目录后退出
+        BatchProcessor::Options batchOptions;
+        if (BatchProcessor::parseCommandLine (commandLine, batchOptions))
+        {
+            setApplicationReturnValue (BatchProcessor (batchOptions).run());
+            quit();
+            return;
+        }
+
+        // --trace <文件>：记录翻页、渲染和音频回调的耗时，退出时写成 Chrome trace JSON
+        auto arguments = juce::StringArray::fromTokens (commandLine, true);
+        const int traceIndex = arguments.indexOf ("--trace");
+        if (traceIndex >= 0)
+        {
+            traceFile = juce::File::getCurrentWorkingDirectory().getChildFile (arguments[traceIndex + 1].unquoted().isNotEmpty()
+                                                                                  ? arguments[traceIndex + 1].unquoted()
+                                                                                  : juce::String ("player-trace.json"));
+            Trace::setEnabled (true);
+        }
 
         mainWindow.reset (new MainWindow (getApplicationName()));
+        StartupProfile::mark ("windowShown");
+
+        // --startup-time：窗口可以使用、PDF 渲染器也预热完成后，把各阶段的时间（毫秒）打印成一行 JSON 后退出
+        if (arguments.contains ("--startup-time"))
+            if (auto* mainComponent = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                mainComponent->onStartupFinished = []
+                {
+                    std::cout << juce::JSON::toString (StartupProfile::toVar(), true) << std::endl;
+                    quit();
+                };
+
+        // --memory-budget <MB>：所有缓存加起来的上限，和 DAW 一起跑在小内存机器上时调低
+        const int budgetIndex = arguments.indexOf ("--memory-budget");
+        if (budgetIndex >= 0 && arguments[budgetIndex + 1].getLargeIntValue() > 0)
+            if (auto* mainComponent = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                mainComponent->setMemoryBudget (static_cast<size_t> (arguments[budgetIndex + 1].getLargeIntValue()) * 1024 * 1024);
+
+        // --sync-master / --sync-follow：局域网翻页同步，所有实例用同一个组播地址和端口
+        // （--sync-group <地址>、--sync-port <端口> 可以改），同一台机器上开几个实例就能测试
+        const bool syncMaster = arguments.contains ("--sync-master");
+        if (syncMaster || arguments.contains ("--sync-follow"))
+        {
+            const int groupIndex = arguments.indexOf ("--sync-group");
+            const int portIndex = arguments.indexOf ("--sync-port");
+            const juce::String group = groupIndex >= 0 ? arguments[groupIndex + 1].unquoted() : juce::String (PageTurnSync::defaultGroup);
+            const int port = portIndex >= 0 ? arguments[portIndex + 1].getIntValue() : PageTurnSync::defaultPort;
+
+            if (auto* mainComponent = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+                if (! mainComponent->startPageTurnSync (syncMaster, group, port))
+                    setApplicationReturnValue (1);
+        }
+
+        // --record-session <文件>：记录拖入文件、播放/暂停、拖动进度、标记和手动翻页；
+        // --replay-session <文件> [--replay-speed <倍数>]：用模拟时钟回放（默认尽可能快），结束后打印统计并退出
+        if (auto* mainComponent = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+        {
+            const int recordIndex = arguments.indexOf ("--record-session");
+            if (recordIndex >= 0)
+                mainComponent->startSessionRecording (juce::File::getCurrentWorkingDirectory()
+                                                          .getChildFile (arguments[recordIndex + 1].unquoted()));
+
+            const int replayIndex = arguments.indexOf ("--replay-session");
+            if (replayIndex >= 0)
+            {
+                const int speedIndex = arguments.indexOf ("--replay-speed");
+                const double speed = speedIndex >= 0 ? std::max (0.0, arguments[speedIndex + 1].getDoubleValue()) : 0.0;
+                const auto sessionFile = juce::File::getCurrentWorkingDirectory().getChildFile (arguments[replayIndex + 1].unquoted());
+
+                if (! mainComponent->startSessionReplay (sessionFile, speed, [] { quit(); }))
+                {
+                    setApplicationReturnValue (1);
+                    quit();
+                }
+            }
+        }
     }
 
     void shutdown() override
@@ -33,6 +114,12 @@ public:
         // Add your application's shutdown code here..
 
         mainWindow = nullptr; // (deletes our window)
+
+        if (traceFile != juce::File())
+        {
+            Trace::setEnabled (false);
+            Trace::writeChromeTrace (traceFile);
+        }
     }
 
     //==============================================================================
@@ -71,6 +158,7 @@ public:
             setFullScreen (true);
            #else
             setResizable (true, true);
+            setResizeLimits (MainComponent::minimumWidth, MainComponent::minimumHeight, 10000, 10000);
             centreWithSize (getWidth(), getHeight());
            #endif
 
@@ -98,6 +186,7 @@ public:
 
 private:
     std::unique_ptr<MainWindow> mainWindow;
+    juce::File traceFile;
 };
 
 //==============================================================================
@@ -7,6 +7,10 @@
 #include "WaveformDisplay.h"
 #include "MarkerSlider.h"
 #include "Marker.h"
+#include "PdfPageRenderer.h"
+#include "MarkerFile.h"
+#include "Trace.h"
+#include <iostream>
 #include <fontconfig/fontconfig.h>
 
 //==============================================================================
@@ -15,18 +19,28 @@
 MainComponent::MainComponent()
 :thumbnailCache(10),  // 初始化thumbnailCache，缓存大小为 10
 audioThumbnail(512, formatManager, thumbnailCache),  // 初始化 audioThumbnail
+piecePreloader(formatManager, thumbnailCache, audioPlayer),  // 曲目单后台预加载
+spectrogramCache(formatManager),  // 后台计算频谱图
 waveformDisplay(audioThumbnail),currentPageIndex(0),// 初始化 currentPageIndex 为 0
 totalNumPages(0),    // 初始化 totalNumPages 为 0
 pdfDocFileName(""),// 初始化 pdfDocFileName 为空字符串
-grayLookAndFeel()
+grayLookAndFeel(),
+audioFileLoader(formatManager, audioPlayer),  // 后台打开音频文件
+loopRegionLoader(formatManager),  // 后台读取循环区间
+beatTracker(formatManager)  // 后台节拍检测
 
 {
-    // 确保设备管理器已初始化，使用默认设置
-    deviceManager.initialise(0, 2, nullptr, true);
-    setAudioChannels(0, 2);  // 设置音频输入输出通道
+    StartupProfile::mark("constructor");
 
-    // 注册音频格式管理器
-    formatManager.registerBasicFormats();
+    // 打开音频设备和注册音频格式放到窗口显示之后（finishDeferredStartup），
+    // Poppler 和 fontconfig 马上在后台预热
+    pdfRendererWarmup.onFinished = [this](double milliseconds)
+    {
+        DBG("PDF renderer warmed up in " + juce::String(milliseconds, 1) + " ms");
+        StartupProfile::mark("pdfRendererWarm");
+        reportStartupIfFinished();
+    };
+    pdfRendererWarmup.start();
 
     // 添加控件
     addAndMakeVisible(waveformDisplay);
@@ -59,118 +73,63 @@ grayLookAndFeel()
     playButton.onClick = [this]
     {
         DBG("Play button clicked");
-        if (readerSource.get() != nullptr)
+        recordSessionEvent({ SessionEvent::Type::play });
+        if (audioPlayer.hasSource())
         {
-            transportSource.start();  // 确保设置了音频源后再启动播放
+            audioPlayer.start();  // 确保设置了音频源后再启动播放
             DBG("Audio started playing");
         }
     };
-    pauseButton.onClick = [this] { transportSource.stop(); };
-    nextButton.onClick = [this]
+    pauseButton.onClick = [this]
     {
-        // 处理翻到下一页
-        if (pdfDoc && currentPageIndex + 1 < totalNumPages)
-        {
-            ++currentPageIndex;
-
-            // 加载并显示当前页
-            PopplerPage* pdfPage = poppler_document_get_page(pdfDoc, currentPageIndex);
-            if (pdfPage)
-            {
-                renderPdfPageToComponent(pdfPage, pdfImageComponent, currentPageIndex);
-                g_object_unref(pdfPage);
-            }
-            else
-            {
-                DBG("Failed to load page " + juce::String(currentPageIndex));
-                return;
-            }
-
-            // 加载并显示下一页预览
-            if (currentPageIndex + 1 < totalNumPages)
-            {
-                PopplerPage* nextPdfPage = poppler_document_get_page(pdfDoc, currentPageIndex + 1);
-                if (nextPdfPage)
-                {
-                    renderPdfPageToComponent(nextPdfPage, nextPagePreview, currentPageIndex + 1);
-                    g_object_unref(nextPdfPage);
-                    nextPagePreview.setVisible(true);
-                }
-                else
-                {
-                    nextPagePreview.setVisible(false);
-                }
-            }
-            else
-            {
-                nextPagePreview.setVisible(false);
-            }
-
-            // 更新 PDF 文件名标签，显示当前页码
-            pdfFileNameLabel.setText("PDF: " + pdfDocFileName + " (Page " + juce::String(currentPageIndex + 1) + "/" + juce::String(totalNumPages) + ")", juce::dontSendNotification);
-
-            // 更新按钮的启用状态
-            beforeButton.setEnabled(currentPageIndex > 0);
-            nextButton.setEnabled(currentPageIndex + 1 < totalNumPages);
-
-            repaint();
-        }
+        recordSessionEvent({ SessionEvent::Type::pause });
+        audioPlayer.stop();
+    };
+    nextButton.onClick = [this]  // 处理翻到下一页
+    {
+        performPageAction({ PageControlInput::ActionType::next, 0, juce::Time::getMillisecondCounterHiRes() });
+    };
+    beforeButton.onClick = [this]  // 处理返回上一页
+    {
+        performPageAction({ PageControlInput::ActionType::previous, 0, juce::Time::getMillisecondCounterHiRes() });
     };
 
+    // 翻页踏板、MIDI 控制器和键盘；MIDI 输入在窗口显示后才打开
+    pageControlInput.onAction = [this](const PageControlInput::Action& action) { performPageAction(action); };
+    setWantsKeyboardFocus(true);
 
-    beforeButton.onClick = [this]
-        {
-            // 处理返回上一页
-            if (pdfDoc && currentPageIndex > 0)
-            {
-                --currentPageIndex;
+    // 音频文件在后台打开完成后换上（拖入的文件会直接开始播放）
+    audioFileLoader.onLoaded = [this](std::unique_ptr<AudioDeck> deck)
+    {
+        installAudioDeck(std::move(deck), true);
+    };
 
-                // 加载并显示当前页
-                PopplerPage* pdfPage = poppler_document_get_page(pdfDoc, currentPageIndex);
-                if (pdfPage)
-                {
-                    renderPdfPageToComponent(pdfPage, pdfImageComponent, currentPageIndex);
-                    g_object_unref(pdfPage);
-                }
-                else
-                {
-                    DBG("Failed to load page " + juce::String(currentPageIndex));
-                    return;
-                }
+    // 录制会话时，加载文件的时间不计入事件时间戳（回放时加载期间模拟时钟也是停的）
+    audioFileLoader.onBusyChanged = [this](bool isBusy) { sessionRecorder.setClockPaused(isBusy); };
 
-                // 加载并显示下一页预览
-                if (currentPageIndex + 1 < totalNumPages)
-                {
-                    PopplerPage* nextPdfPage = poppler_document_get_page(pdfDoc, currentPageIndex + 1);
-                    if (nextPdfPage)
-                    {
-                        renderPdfPageToComponent(nextPdfPage, nextPagePreview, currentPageIndex + 1);
-                        g_object_unref(nextPdfPage);
-                        nextPagePreview.setVisible(true);
-                    }
-                    else
-                    {
-                        nextPagePreview.setVisible(false);
-                    }
-                }
-                else
-                {
-                    nextPagePreview.setVisible(false);
-                }
+    // 后台预渲染完成的页面放进缓存
+    pagePrefetcher.onPageRendered = [this](int pageIndex, const juce::Image& image)
+    {
+        renderedPageCache.addRaster(pageIndex, image);
+        memoryAccountant.update();
+    };
 
-                // 更新 PDF 文件名标签，显示当前页码
-                pdfFileNameLabel.setText("PDF: " + pdfDocFileName + " (Page " + juce::String(currentPageIndex + 1) + "/" + juce::String(totalNumPages) + ")", juce::dontSendNotification);
+    // 频谱图块在后台算好时同样更新内存统计（空闲时定时器不运行）
+    spectrogramCache.onMemoryUsageChanged = [this] { memoryAccountant.update(); };
 
-                // 更新按钮的启用状态
-                beforeButton.setEnabled(currentPageIndex > 0);
-                nextButton.setEnabled(currentPageIndex + 1 < totalNumPages);
+    // 到了换页的时刻，按当前位置再检查一次
+    pageTurnCallback.callback = [this] { pageTurnDue(); };
+    pageTurnSync.onMasterStateChanged = [this] { followMasterState(); };
 
-                repaint();
-            }
-        };
+    // 窗口停止变化后，按新尺寸重新渲染缓存中不够大的页面
+    pageRerenderCallback.callback = [this]
+    {
+        pageRerenderCallback.stopTimer();
+        refreshDisplayedPages();
+    };
 
-    // 设置定时器，用于更新播放进度
-    startTimer(500);  // 每半秒更新一次进度条
+    // 进度条的定时器只在播放时运行，由播放状态的变化启停
+    audioPlayer.onTransportStateChanged = [this] { transportStateChanged(); };
     progressSlider.setRange(0.0, 1.0);  // 进度条的范围从 0 到 1
     // 设置 progressSlider 的 LookAndFeel
     progressSlider.setLookAndFeel(&grayLookAndFeel);
@@ -197,17 +156,24 @@ grayLookAndFeel()
     //更新call back
     waveformDisplay.onPositionChanged = [this](double newPosition)
         {
-            transportSource.setPosition(newPosition);//设置音频播放位置
+            SessionEvent event { SessionEvent::Type::seek };
+            event.seekPosition = newPosition;
+            recordSessionEvent(event);
+            audioPlayer.setPosition(newPosition);//设置音频播放位置
             waveformDisplay.setPosition(newPosition); // 设置波形显示位置
+            syncPageToPosition(newPosition);          // 跳到该位置对应的页面
         };
     // 设置 AudioTransportSource 的监听器
-    //transportSource.addChangeListener(this);
-    //确保在 progressSlider 的 onValueChange 回调中同步更新 transportSource 和 waveformDisplay 的位置。
+    //确保在 progressSlider 的 onValueChange 回调中同步更新 audioPlayer 和 waveformDisplay 的位置。
     progressSlider.onValueChange = [this]()
     {
         double newPosition = progressSlider.getValue();
-        transportSource.setPosition(newPosition);       // 设置音频播放位置
+        SessionEvent event { SessionEvent::Type::seek };
+        event.seekPosition = newPosition;
+        recordSessionEvent(event);
+        audioPlayer.setPosition(newPosition);       // 设置音频播放位置
         waveformDisplay.setPosition(newPosition);       // 设置波形显示位置
+        syncPageToPosition(newPosition);                // 跳到该位置对应的页面
     };
     //设置markerSlider 长度与audioLength一样
     double audioLength = audioThumbnail.getTotalLength();
@@ -224,16 +190,148 @@ grayLookAndFeel()
     markerSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0); // 无文本框
     markerSlider.setLookAndFeel(&grayLookAndFeel); // 使用自定义 LookAndFeel
 
+    // 拖动标记时吸附到附近的起音
+    markerSlider.snapMarkerPosition = [this](double position, double tolerance) { return onsetIndex.snap(position, tolerance); };
+
+    // 右键点标记：设置翻页动作和目标页
+    markerSlider.onMarkerMenuRequested = [this](int markerIndex) { showMarkerMenu(markerIndex); };
+
     // 设置标记改变后的回调
     markerSlider.onMarkersChanged = [this]()
     {
-        int lastDraggedIndex = markerSlider.getLastDraggedMarkerIndex();
-        if (lastDraggedIndex >= 0 && lastDraggedIndex < static_cast<int>(markerSlider.getMarkers().size()))
-        {
-            const Marker& draggedMarker = markerSlider.getMarkers()[lastDraggedIndex];
-            markerTriggeredFlags[&draggedMarker] = false;  // 重置被拖动标记的触发状态
-        }
+        SessionEvent event { SessionEvent::Type::markers };
+        event.markers = markerSlider.getMarkers();
+        recordSessionEvent(event);
+        rebuildMarkerTimeline();  // 标记被拖动后重新建立时间线
     };
+    // 曲目单：切换到下一首，以及显示当前是第几首
+    addChildComponent(nextPieceButton);
+    addChildComponent(setlistLabel);
+    setlistLabel.setColour(juce::Label::textColourId, juce::Colours::black);
+    nextPieceButton.onClick = [this] { advanceToNextPiece(); };
+
+    // 练习速度：只改变速度不改变音高，标记仍然按原始时间触发
+    addAndMakeVisible(tempoSlider);
+    addAndMakeVisible(tempoLabel);
+    tempoLabel.setText("Tempo", juce::dontSendNotification);
+    tempoLabel.setColour(juce::Label::textColourId, juce::Colours::black);
+    tempoLabel.setJustificationType(juce::Justification::centredRight);
+    tempoSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+    tempoSlider.setRange(TimeStretchAudioSource::minimumTempo, TimeStretchAudioSource::maximumTempo, 0.01);
+    tempoSlider.setValue(1.0, juce::dontSendNotification);
+    tempoSlider.setDoubleClickReturnValue(true, 1.0);
+    tempoSlider.setTextBoxStyle(juce::Slider::TextBoxRight, false, 45, 20);
+    tempoSlider.setColour(juce::Slider::textBoxTextColourId, juce::Colours::black);
+    tempoSlider.setLookAndFeel(&grayLookAndFeel);
+    tempoSlider.onValueChange = [this]
+    {
+        audioPlayer.setTempo(tempoSlider.getValue());
+        publishSyncState();
+    };
+
+    // A/B 循环：区间读进内存后交给音频线程，在回调里按样本精确回绕
+    addAndMakeVisible(loopButton);
+    loopButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    loopButton.onClick = [this] { toggleLoop(); };
+    loopRegionLoader.onLoaded = [this](std::unique_ptr<LoopRegion> region)
+    {
+        const double start = region->getStartSeconds();
+        const double end = region->getEndSeconds();
+        audioPlayer.setLoopRegion(std::move(region));
+        showLoopRange(start, end);
+
+        // 新的 B 点可能比已经排好的换页检查更早
+        if (audioPlayer.isPlaying() && pageTurnSync.getRole() != PageTurnSync::Role::follower)
+            schedulePageTurn(audioPlayer.getCurrentPosition(), audioPlayer.getTempo());
+    };
+
+    // 频谱图：切换后才开始在后台计算，播放位置附近的图块先出来
+    waveformDisplay.setSpectrogram(&spectrogramCache);
+    addAndMakeVisible(spectrogramButton);
+    spectrogramButton.setClickingTogglesState(true);
+    spectrogramButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    spectrogramButton.onClick = [this]
+    {
+        waveformDisplay.setDisplayMode(spectrogramButton.getToggleState() ? WaveformDisplay::DisplayMode::spectrogram
+                                                                          : WaveformDisplay::DisplayMode::waveform);
+    };
+
+    // 进度条盖在波形上面，按住 Shift 在进度条上拖动也交给波形显示来选择区间
+    progressSlider.addMouseListener(&waveformDisplay, false);
+    waveformDisplay.onSelectionChanged = [this](double start, double end)
+    {
+        // 循环已经打开时，新的选区直接成为新的循环区间
+        if (loopButton.getToggleState())
+            loadLoopRegion(start, end);
+    };
+
+    // 节拍器：打开时按速度图生成拍子；可以单独输出到第 3/4 声道
+    addAndMakeVisible(clickButton);
+    addAndMakeVisible(clickOutputButton);
+    clickButton.setClickingTogglesState(true);
+    clickOutputButton.setClickingTogglesState(true);
+    clickButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    clickOutputButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    clickButton.onClick = [this]
+    {
+        rebuildClickTrack();
+        audioPlayer.setClickEnabled(clickButton.getToggleState());
+    };
+    clickOutputButton.onClick = [this] { setClickSeparateOutput(clickOutputButton.getToggleState()); };
+
+    // 节拍检测：结果只用于吸附、小节线和节拍器，翻页仍然由标记决定
+    addAndMakeVisible(barsButton);
+    barsButton.onClick = [this] { detectBars(); };
+    beatTracker.onAnalysed = [this](const juce::File& file, const BeatAnalysis& analysis)
+    {
+        // 分析期间换了文件
+        if (file != audioPlayer.getCurrentFile())
+            return;
+
+        DBG("Detected " + juce::String(analysis.bpm, 1) + " BPM, " + juce::String(analysis.beatsPerBar) + " beats per bar, "
+            + juce::String(static_cast<int>(analysis.barTimes.size())) + " bars, "
+            + juce::String(static_cast<int>(analysis.onsetTimes.size())) + " onsets in " + juce::String(analysis.analysisSeconds, 2) + "s");
+
+        detectedAnalysis = analysis;
+        hasDetectedAnalysis = true;
+        onsetIndex.setOnsets(analysis.onsetTimes);
+
+        if (barsRequested)
+            applyDetectedBars();
+    };
+
+    // 一次拖入多个音频文件时作为多轨播放，显示混音面板
+    addChildComponent(stemMixer);
+
+    // 诊断面板盖在混音面板的位置上，默认隐藏
+    addChildComponent(diagnosticsPanel);
+    addAndMakeVisible(diagnosticsButton);
+    diagnosticsButton.setClickingTogglesState(true);
+    diagnosticsButton.setColour(juce::TextButton::buttonOnColourId, juce::Colours::green);
+    diagnosticsButton.onClick = [this]
+    {
+        diagnosticsButton.removeColour(juce::TextButton::buttonColourId);
+        diagnosticsPanel.setVisible(diagnosticsButton.getToggleState());
+        if (diagnosticsPanel.isVisible())
+            diagnosticsPanel.refresh();
+    };
+    pageTurnLatency.onSampleAdded = [this]
+    {
+        if (diagnosticsPanel.isVisible())
+            diagnosticsPanel.refresh();
+    };
+    pageInputLatency.onSampleAdded = [this]
+    {
+        if (diagnosticsPanel.isVisible())
+            diagnosticsPanel.refresh();
+    };
+    pdfImageComponent.onPainted = [this]
+    {
+        pageTurnLatency.endPaint();
+        pageInputLatency.endPaint();
+    };
+    registerMemorySubsystems();
+
     // 添加保存标记按钮
     addAndMakeVisible(saveMarkersButton);
     // 使用 juce::CharPointer_UTF8 包装 UTF-8 字符串
@@ -247,7 +345,7 @@ grayLookAndFeel()
         fileChooser = std::make_unique<juce::FileChooser>(
             juce::String(juce::CharPointer_UTF8("保存标记位置")),
             juce::File::getSpecialLocation(juce::File::userDesktopDirectory),
-            "*.markers");
+            "*.markers;*" + juce::String(ProjectFile::fileExtension));
 
         // 使用 SafePointer 捕获 this 指针
         juce::Component::SafePointer<MainComponent> safeThis(this);
@@ -261,8 +359,17 @@ grayLookAndFeel()
                 {
                     DBG("File selected: " + file.getFullPathName());
 
-                    strongThis->saveMarkerPositions(file);
-                    DBG("Marker positions saved to: " + file.getFullPathName());
+                    // 工程文件保存整个会话，否则只保存标记位置
+                    if (file.hasFileExtension(ProjectFile::fileExtension))
+                    {
+                        strongThis->saveProject(file);
+                        DBG("Project saved to: " + file.getFullPathName());
+                    }
+                    else
+                    {
+                        strongThis->saveMarkerPositions(file);
+                        DBG("Marker positions saved to: " + file.getFullPathName());
+                    }
                 }
                 else
                 {
@@ -276,278 +383,1039 @@ grayLookAndFeel()
     };
 
     // 设置组件大小
-    setSize(800,600);
+    setSize(minimumWidth, minimumHeight);
 
 }
 
 MainComponent::~MainComponent()
 {
+    pageRerenderCallback.stopTimer();
+    pageTurnCallback.stopTimer();
+    pageTurnSync.stop();
+    pageControlInput.closeInputs();
     markerSlider.setLookAndFeel(nullptr); // 解除 LookAndFeel 绑定
+    tempoSlider.setLookAndFeel(nullptr);
     progressSlider.setLookAndFeel(nullptr);  // 解除 LookAndFeel 的绑定
     // 停止播放并释放资源
-    transportSource.stop();
-    transportSource.setSource(nullptr);
+    audioPlayer.stop();
     shutdownAudio(); // 确保在基类析构之前调用
 }
 
-void MainComponent::timerCallback()
+void MainComponent::finishDeferredStartup(bool openAudioDevice)
 {
-    if (transportSource.isPlaying())
+    if (deferredStartupFinished)
+        return;
+
+    deferredStartupFinished = true;
+
+    // 注册音频格式管理器
+    formatManager.registerBasicFormats();
+    StartupProfile::mark("formatsRegistered");
+
+    // 只打开一次设备（AudioAppComponent 自己的 deviceManager），设置音频输入输出通道
+    if (openAudioDevice)
     {
-        // 获取当前播放位置和音频总时长
-        double position = transportSource.getCurrentPosition();
-        double length = transportSource.getLengthInSeconds();
+        setAudioChannels(0, 2);
+        StartupProfile::mark("audioDeviceOpen");
 
-        // 更新进度条的值为当前播放位置
-        progressSlider.setValue(position, juce::dontSendNotification);
+        // 回放时翻页来自会话文件，不接收外部输入
+        pageControlInput.openInputs();
+        StartupProfile::mark("midiInputsOpen");
 
-        // 更新当前播放时间标签
-        int currentMinutes = static_cast<int>(position) / 60;
-        int currentSeconds = static_cast<int>(position) % 60;
-        juce::String positionText = juce::String::formatted("%02d:%02d", currentMinutes, currentSeconds);
-        audioPositionLabel.setText(positionText, juce::dontSendNotification);
-        audioPositionLabel.setVisible(true);  // 音频播放时显示标签
-
-        // 更新音频总时长标签
-        int totalMinutes = static_cast<int>(length) / 60;
-        int totalSeconds = static_cast<int>(length) % 60;
-        juce::String lengthText = juce::String::formatted("%02d:%02d", totalMinutes, totalSeconds);
-        audioLengthLabel.setText(lengthText, juce::dontSendNotification);
-        audioLengthLabel.setVisible(true);
-
-        // 更新波形显示的位置
-        waveformDisplay.setPosition(position);
-        // 检查 markerSlider 上的标记是否被触发
-        for (const auto& marker : markerSlider.getMarkers())
-        {
-            // 计算标记对应的时间
-            double markerTime = marker.position; // marker.position 是以秒为单位
+        if (isShowing())
+            grabKeyboardFocus();
+    }
 
-            // 如果当前播放位置超过标记时间且标记尚未被触发
-            if (!markerTriggeredFlags[&marker] && position >= markerTime)
-            {
-                markerTriggeredFlags[&marker] = true; // 标记为已触发
-                nextButton.triggerClick(); // 触发下一页
-                DBG("Marker reached at position: " + juce::String(markerTime));
-            }
-        }
+    // 可以拖入文件并播放了
+    StartupProfile::mark("interactive");
+    reportStartupIfFinished();
+}
+
+void MainComponent::reportStartupIfFinished()
+{
+    if (!deferredStartupFinished || !pdfRendererWarmup.isFinished())
+        return;
+
+    DBG("Startup: " + StartupProfile::toString());
+
+    if (onStartupFinished)
+        onStartupFinished();
+}
+
+void MainComponent::timerCallback()
+{
+    PLAYER_TRACE_SCOPE("timerCallback", "ui");
+
+    ActivityMeter::noteTimerCallback();
+
+    if (audioPlayer.isPlaying())
+    {
+        refreshTransportDisplay();
     }
     else
     {
         // 音频未播放时显示当前位置
         audioPositionLabel.setVisible(true);
     }
+
+    checkAudioCallbackLoad();
+    memoryAccountant.update();
+
+    // 播放到结尾时 transport 会通知，这里只是兜底；回放时定时器本来就没有运行
+    if (!audioPlayer.isPlaying() && !sessionReplayer.isReplaying())
+        stopTimer();
+}
+
+void MainComponent::transportStateChanged()
+{
+    const bool playing = audioPlayer.isPlaying();
+    activityMeter.setPlaying(playing);
+    stemMixer.setTransportRunning(playing);
+    publishSyncState();
+
+    if (playing)
+    {
+        // 回放时界面由模拟时钟驱动
+        if (!isTimerRunning() && !sessionReplayer.isReplaying())
+            startTimer(refreshIntervalMs);
+        if (pageTurnSync.getRole() != PageTurnSync::Role::follower)
+            schedulePageTurn(audioPlayer.getCurrentPosition(), audioPlayer.getTempo());
+        return;
+    }
+
+    if (pageTurnSync.getRole() != PageTurnSync::Role::follower)
+        stopPageTurnTimer();
+
+    if (sessionReplayer.isReplaying())
+        return;
+
+    // 停下来后把最终位置显示一次，之后不再定时唤醒
+    stopTimer();
+    refreshTransportDisplay();
+    checkAudioCallbackLoad();
+    memoryAccountant.update();
+}
+
+void MainComponent::refreshTransportDisplay()
+{
+    // 获取当前播放位置和音频总时长
+    double position = audioPlayer.getCurrentPosition();
+    double length = audioPlayer.getLengthInSeconds();
+
+    // 更新进度条的值为当前播放位置；滑块没有移动一个像素时不重画
+    if (progressSlider.getPositionOfValue(position) != progressSlider.getPositionOfValue(progressSlider.getValue()))
+        progressSlider.setValue(position, juce::dontSendNotification);
+
+    // 更新当前播放时间标签
+    int currentMinutes = static_cast<int>(position) / 60;
+    int currentSeconds = static_cast<int>(position) % 60;
+    juce::String positionText = juce::String::formatted("%02d:%02d", currentMinutes, currentSeconds);
+    audioPositionLabel.setText(positionText, juce::dontSendNotification);
+    audioPositionLabel.setVisible(true);  // 音频播放时显示标签
+
+    // 更新音频总时长标签
+    int totalMinutes = static_cast<int>(length) / 60;
+    int totalSeconds = static_cast<int>(length) % 60;
+    juce::String lengthText = juce::String::formatted("%02d:%02d", totalMinutes, totalSeconds);
+    audioLengthLabel.setText(lengthText, juce::dontSendNotification);
+    audioLengthLabel.setVisible(true);
+
+    // 更新波形显示的位置
+    waveformDisplay.setPosition(position);
+    // 根据标记时间线找到当前位置应该显示的页面；跟随主机时页面由主机的位置决定
+    if (pageTurnSync.getRole() == PageTurnSync::Role::follower)
+        return;
+
+    syncPageToPosition(position);
+    if (audioPlayer.isPlaying())
+        schedulePageTurn(position, audioPlayer.getTempo());
+}
+
+bool MainComponent::startPageTurnSync(bool asMaster, const juce::String& groupAddress, int port)
+{
+    if (!pageTurnSync.start(asMaster ? PageTurnSync::Role::master : PageTurnSync::Role::follower, groupAddress, port))
+        return false;
+
+    publishSyncState();
+    return true;
+}
+
+void MainComponent::publishSyncState()
+{
+    if (pageTurnSync.getRole() != PageTurnSync::Role::master)
+        return;
+
+    pageTurnSync.publish(audioPlayer.getCurrentPosition(), audioPlayer.getTempo(), audioPlayer.isPlaying(),
+                         currentView.page, currentView.topPage);
+}
+
+void MainComponent::followMasterState()
+{
+    PLAYER_TRACE_SCOPE("followMaster", "sync");
+
+    if (pageTurnSync.getRole() != PageTurnSync::Role::follower || !pageTurnSync.hasMasterState())
+        return;
+
+    const auto state = pageTurnSync.getMasterState();
+
+    // 没有自己的标记（和主机用同一份谱）时直接显示主机的页
+    if (markerTimeline.isEmpty())
+    {
+        const PageView view { state.page, state.topPage };
+        if (view != currentView)
+            showPageView(view);
+        return;
+    }
+
+    // 自己的分谱按自己的标记翻页，位置来自主机
+    syncPageToPosition(state.position);
+
+    if (state.playing)
+        schedulePageTurn(state.position, state.tempo);
+    else
+        stopPageTurnTimer();
+}
+
+void MainComponent::schedulePageTurn(double position, double tempo)
+{
+    double nextChange = markerTimeline.getNextChangeTime(position);
+
+    // A/B 循环时 B 点也是换页点：回绕到 A 点时要马上翻回 A 点所在的页（从机的位置来自主机，不看本机的循环）
+    const auto* loop = audioPlayer.getLoopRegion();
+    if (loop != nullptr && pageTurnSync.getRole() != PageTurnSync::Role::follower)
+    {
+        const double loopEnd = loop->getEndSeconds();
+        if (position < loopEnd && (nextChange < 0.0 || loopEnd < nextChange))
+            nextChange = loopEnd;
+    }
+
+    if (nextChange < 0.0 || tempo <= 0.0)
+    {
+        stopPageTurnTimer();
+        return;
+    }
+
+    // 离下一个换页点还远时最多等一个刷新周期再重新算，中间的 seek 和速度变化都会被考虑进去
+    const double delayMs = std::min(static_cast<double>(refreshIntervalMs), (nextChange - position) / tempo * 1000.0);
+    startPageTurnTimer(std::max(1, static_cast<int>(std::ceil(delayMs))));
+}
+
+void MainComponent::startPageTurnTimer(int delayMs)
+{
+    if (sessionReplayer.isReplaying())
+        sessionReplayer.scheduleCallback(delayMs);
+    else
+        pageTurnCallback.startTimer(delayMs);
+}
+
+void MainComponent::stopPageTurnTimer()
+{
+    pageTurnCallback.stopTimer();
+    sessionReplayer.cancelScheduledCallback();
+}
+
+void MainComponent::pageTurnDue()
+{
+    stopPageTurnTimer();
+
+    if (pageTurnSync.getRole() == PageTurnSync::Role::follower)
+    {
+        followMasterState();
+        return;
+    }
+
+    if (!audioPlayer.isPlaying())
+        return;
+
+    // 播放位置按音频块前进，定时器可能早到一点，没越过时会按剩下的时间再定一次
+    const double position = audioPlayer.getCurrentPosition();
+    syncPageToPosition(position);
+    schedulePageTurn(position, audioPlayer.getTempo());
+}
+
+void MainComponent::recordSessionEvent(SessionEvent event)
+{
+    // 回放时的操作来自会话文件，不再录制
+    if (!sessionRecorder.isRecording() || sessionReplayer.isReplaying())
+        return;
+
+    event.audioPosition = audioPlayer.getCurrentPosition();
+    sessionRecorder.record(std::move(event));
+}
+
+void MainComponent::applySessionEvent(const SessionEvent& event)
+{
+    switch (event.type)
+    {
+        case SessionEvent::Type::filesDropped:
+            filesDropped(event.files, 0, 0);
+            break;
+        case SessionEvent::Type::play:
+            playButton.onClick();
+            break;
+        case SessionEvent::Type::pause:
+            pauseButton.onClick();
+            break;
+        case SessionEvent::Type::seek:
+            progressSlider.setValue(event.seekPosition, juce::sendNotificationSync);
+            break;
+        case SessionEvent::Type::markers:
+            applyMarkers(event.markers);
+            break;
+        case SessionEvent::Type::page:
+            showPage(event.page);
+            break;
+    }
+}
+
+bool MainComponent::startSessionReplay(const juce::File& file, double speed, std::function<void()> onFinished)
+{
+    std::vector<SessionEvent> events;
+    if (!SessionRecorder::readEvents(file, events))
+        return false;
+
+    // 回放不用音频设备，只需要音频格式
+    finishDeferredStartup(false);
+
+    // 音频由模拟时钟拉取，不经过设备；界面刷新也由回放驱动
+    const int uiInterval = refreshIntervalMs;
+    shutdownAudio();
+    stopTimer();
+    pageTurnCallback.stopTimer();
+    prepareToPlay(SessionReplayer::defaultBlockSize, SessionReplayer::defaultSampleRate);
+    audioPlayer.setWaitForReadAhead(true);
+
+    sessionReplayer.applyEvent = [this](const SessionEvent& event) { applySessionEvent(event); };
+    sessionReplayer.isBusy = [this] { return audioFileLoader.isBusy(); };
+    sessionReplayer.renderBlock = [this](const juce::AudioSourceChannelInfo& info) { getNextAudioBlock(info); };
+    sessionReplayer.onUiTick = [this] { timerCallback(); };
+    sessionReplayer.onScheduled = [this] { pageTurnDue(); };
+    sessionReplayer.getAudioPosition = [this] { return audioPlayer.getCurrentPosition(); };
+    sessionReplayer.onFinished = [this, onFinished](const SessionReplayer::Summary& summary)
+    {
+        // 一行 JSON，方便比较不同版本
+        auto* result = new juce::DynamicObject();
+        result->setProperty("events", summary.numEvents);
+        result->setProperty("simulatedSeconds", summary.simulatedSeconds);
+        result->setProperty("wallSeconds", summary.wallSeconds);
+        result->setProperty("speedup", summary.wallSeconds > 0.0 ? summary.simulatedSeconds / summary.wallSeconds : 0.0);
+        result->setProperty("maxDriftMs", summary.maxDriftMs);
+        result->setProperty("pageTurns", static_cast<int>(pageTurnLatency.getSamples().size()));
+        result->setProperty("pageTurnP50Ms", pageTurnLatency.getPercentile(0.50));
+        result->setProperty("pageTurnP95Ms", pageTurnLatency.getPercentile(0.95));
+        result->setProperty("pageTurnMaxMs", pageTurnLatency.getMaximum());
+        result->setProperty("audioWorstCallbackMs", audioCallbackMonitor.getWorstCallbackMs());
+        result->setProperty("audioOverruns", static_cast<int>(audioCallbackMonitor.getNumOverruns()));
+        if (auto* stems = audioPlayer.getCurrentStems())
+            result->setProperty("stemReadAheadMisses", stems->getNumReadAheadMisses());
+        result->setProperty("peakMemoryBytes", static_cast<juce::int64>(memoryAccountant.getPeakTotalBytes()));
+        std::cout << juce::JSON::toString(juce::var(result), true) << std::endl;
+
+        // 回到正常的设备和定时器
+        audioPlayer.stop();
+        audioPlayer.setWaitForReadAhead(false);
+        setAudioChannels(0, 2);
+        transportStateChanged();
+
+        if (onFinished)
+            onFinished();
+    };
+
+    sessionReplayer.start(std::move(events), SessionReplayer::defaultSampleRate, SessionReplayer::defaultBlockSize, uiInterval, speed);
+    return true;
+}
+
+void MainComponent::registerMemorySubsystems()
+{
+    // 页面栅格和频谱图可以收缩；其余的只统计
+    memoryAccountant.addSubsystem("pages", [this] { return renderedPageCache.getMemoryUsage(); },
+                                  [this](size_t bytesToFree) { return renderedPageCache.shrink(bytesToFree); });
+    memoryAccountant.addSubsystem("spectrogram", [this] { return spectrogramCache.getMemoryUsage(); },
+                                  [this](size_t bytesToFree) { return spectrogramCache.shrink(bytesToFree); },
+                                  [this] { spectrogramCache.restoreMemoryBudget(); });
+
+    // 每 512 个样本一对 8 位的最小/最大值；thumbnailCache 里其他文件的副本最多 10 份，没有计入
+    memoryAccountant.addSubsystem("waveform", [this]
+    {
+        return static_cast<size_t>(audioThumbnail.getNumSamplesFinished() / 512 + 1)
+             * static_cast<size_t>(audioThumbnail.getNumChannels()) * 2;
+    });
+    memoryAccountant.addSubsystem("audio", [this] { return audioPlayer.getMemoryUsage(); });
+    memoryAccountant.addSubsystem("next piece", [this] { return piecePreloader.getMemoryUsage(); });
+}
+
+void MainComponent::checkAudioCallbackLoad()
+{
+    if (auto* device = deviceManager.getCurrentAudioDevice())
+        audioCallbackMonitor.setDeviceXRunCount(device->getXRunCount());
+
+    if (!audioCallbackMonitor.checkForWarning())
+        return;
+
+    DBG("Audio callback overloaded: worst " + juce::String(audioCallbackMonitor.getWorstCallbackMs(), 2) + " ms of "
+        + juce::String(audioCallbackMonitor.getDeadlineMs(), 2) + " ms, " + juce::String(static_cast<int>(audioCallbackMonitor.getNumOverruns()))
+        + " overruns, " + juce::String(static_cast<int>(audioCallbackMonitor.getNumLateCallbacks())) + " late callbacks, "
+        + juce::String(audioCallbackMonitor.getNumDeviceXRuns()) + " device xruns");
+
+    // 面板关着时用按钮颜色提示，打开面板后恢复
+    if (!diagnosticsPanel.isVisible())
+        diagnosticsButton.setColour(juce::TextButton::buttonColourId, juce::Colours::orangered);
 }
 
 
 //process block
 void MainComponent::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
 {
-    transportSource.prepareToPlay(samplesPerBlockExpected, sampleRate);
+    audioCallbackMonitor.prepare(sampleRate);
+    audioPlayer.prepareToPlay(samplesPerBlockExpected, sampleRate);
 }
 
 
 void MainComponent::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
 {
-    if (readerSource.get() == nullptr)
+    PLAYER_TRACE_SCOPE("getNextAudioBlock", "audio");
+
+    const auto callbackStart = audioCallbackMonitor.beginCallback();
+
+    // 没有音频时 audioPlayer 会清空输出；换文件时在这里无锁交换并淡入淡出
+    audioPlayer.getNextAudioBlock(bufferToFill);
+
+    audioCallbackMonitor.endCallback(callbackStart, bufferToFill.numSamples);
+}
+
+void MainComponent::releaseResources()
+{
+    audioPlayer.releaseResources();
+}
+void MainComponent::saveMarkerPositions(const juce::File& file)
+{
+    // 每个标记占一行：位置，以及非默认的动作和目标页
+    writeMarkers(file, markerSlider.getMarkers());
+}
+
+
+//marker load
+void MainComponent::loadMarkerPositions(const juce::File& file)
+{
+    std::vector<Marker> markers;
+    if (readMarkers(file, markers))
+        applyMarkers(markers);
+}
+
+void MainComponent::applyMarkers(const std::vector<Marker>& markers)
+{
+    // 清除当前的标记
+    markerSlider.clearMarkers();
+
+    for (const auto& marker : markers)
+    {
+        if (marker.position >= markerSlider.getMinimum() && marker.position <= markerSlider.getMaximum())
+        {
+            markerSlider.addMarker(marker);
+        }
+        else
+        {
+            DBG("Marker position out of range: " + juce::String(marker.position));
+        }
+    }
+
+    rebuildMarkerTimeline();
+}
+
+void MainComponent::saveProject(const juce::File& file)
+{
+    if (!audioPlayer.hasSource())
+    {
+        DBG("Load audio file before saving a project");
+        return;
+    }
+
+    ProjectData data;
+    data.audio = ProjectFileReference::create(audioPlayer.getCurrentFile(), file);
+    data.pdf = pdfDoc != nullptr ? ProjectFileReference::create(pdfDocFile, file) : ProjectFileReference();
+    data.audioLengthSeconds = audioPlayer.getLengthInSeconds();
+    data.numPages = totalNumPages;
+    data.markers = markerSlider.getMarkers();
+    data.tempoSegments = tempoMap.getSegments();
+    data.tempoMapFromFile = tempoMapFromFile;
+    data.analysis = detectedAnalysis;
+    data.hasAnalysis = hasDetectedAnalysis;
+    data.barsShown = barsRequested && hasDetectedAnalysis;
+    data.annotations = projectAnnotations;
+    data.pageTurnLatencies = pageTurnLatency.getSamples();
+
+    if (!ProjectFile::save(file, data, &audioThumbnail))
+        DBG("Failed to save project: " + file.getFullPathName());
+}
+
+void MainComponent::openProject(const juce::File& file)
+{
+    auto project = std::make_unique<ProjectFile>();
+    if (!project->open(file))
+        return;
+
+    const auto& data = project->getData();
+    const auto audioFile = data.audio.resolve(file);
+    if (audioFile == juce::File{})
+    {
+        DBG("Audio referenced by the project was not found: " + data.audio.fullPath);
+        return;
+    }
+
+    // 乐谱可以没有；页数对不上时照样打开，只提示一下
+    const auto pdfFile = data.pdf.resolve(file);
+    if (pdfFile != juce::File{})
+    {
+        loadAndDisplayPDF(pdfFile);
+        pdfFileNameLabel.setColour(juce::Label::textColourId, juce::Colours::pink);
+
+        if (data.numPages != totalNumPages)
+            DBG("Project page count does not match " + pdfFile.getFileName());
+    }
+
+    // 保存的波形峰值放进 thumbnailCache，加载音频时 AudioThumbnail 直接从缓存读取
+    if (auto peaks = project->createPeaksStream())
+    {
+        juce::AudioThumbnail restoredThumbnail(512, formatManager, thumbnailCache);
+        if (restoredThumbnail.loadFrom(*peaks))
+            thumbnailCache.storeThumb(restoredThumbnail, juce::FileInputSource(audioFile).hashCode());
+    }
+
+    // 标记在音频装好、滑块范围确定之后再套用
+    pendingProject = std::move(project);
+    pendingProjectAudio = audioFile;
+    audioFileLoader.load(audioFile);
+}
+
+void MainComponent::applyPendingProject()
+{
+    const auto project = std::move(pendingProject);
+    const auto& data = project->getData();
+
+    if (std::abs(data.audioLengthSeconds - audioPlayer.getLengthInSeconds()) > 0.01)
+        DBG("Audio length differs from the project: " + juce::String(data.audioLengthSeconds) + "s");
+
+    projectAnnotations = data.annotations;
+    pageTurnLatency.setSamples(data.pageTurnLatencies);
+
+    if (data.tempoMapFromFile)
+    {
+        tempoMap.setSegments(data.tempoSegments);
+        tempoMapFromFile = true;
+    }
+
+    if (data.hasAnalysis)
     {
-        bufferToFill.clearActiveBufferRegion();
+        detectedAnalysis = data.analysis;
+        hasDetectedAnalysis = true;
+        onsetIndex.setOnsets(detectedAnalysis.onsetTimes);
+
+        if (data.barsShown)
+        {
+            barsRequested = true;
+            applyDetectedBars();
+        }
     }
     else
     {
-        transportSource.getNextAudioBlock(bufferToFill);
+        beatTracker.analyse(pendingProjectAudio);
     }
+
+    applyMarkers(data.markers);
+    rebuildClickTrack();
+    showPageView(markerTimeline.getViewForPosition(audioPlayer.getCurrentPosition()));
+    DBG("Project opened: " + project->getFile().getFullPathName());
 }
 
-void MainComponent::releaseResources()
+//拖拽文件，仅对音频以及pdf文件感兴趣
+bool MainComponent::isInterestedInFileDrag(const juce::StringArray& files)
 {
-    transportSource.releaseResources();
+    const juce::File file(files[0]);
+    return file.hasFileExtension(".wav") || file.hasFileExtension(".mp3") || file.hasFileExtension(".pdf") || file.hasFileExtension(".markers")
+        || file.hasFileExtension(".setlist") || file.hasFileExtension(".tempo") || file.hasFileExtension(ProjectFile::fileExtension);
 }
-void MainComponent::saveMarkerPositions(const juce::File& file)
+
+bool MainComponent::keyPressed(const juce::KeyPress& key)
+{
+    return pageControlInput.handleKeyPress(key);
+}
+
+void MainComponent::performPageAction(const PageControlInput::Action& action)
 {
-    if (file == juce::File{})
+    if (pdfDoc == nullptr || totalNumPages <= 0)
+        return;
+
+    int page = currentPageIndex;
+    switch (action.type)
+    {
+        case PageControlInput::ActionType::next:     page = currentPageIndex + 1; break;
+        case PageControlInput::ActionType::previous: page = currentPageIndex - 1; break;
+        case PageControlInput::ActionType::jump:     page = action.page; break;
+    }
+
+    page = juce::jlimit(0, totalNumPages - 1, page);
+    if (page == currentPageIndex && !currentView.isHalfTurn())
+        return;
+
+    SessionEvent event { SessionEvent::Type::page };
+    event.page = page;
+    recordSessionEvent(event);
+
+    // 输入到消息线程处理的时间记作 detection，渲染和绘制与自动翻页一样测量；
+    // 前后邻页已经由 prefetchAroundPage 预渲染，正常情况下 render 只是从缓存缩放
+    const double waitedMs = std::max(0.0, juce::Time::getMillisecondCounterHiRes() - action.inputMs);
+    pageInputLatency.beginTurn(audioPlayer.getCurrentPosition(), page, waitedMs);
+    showPage(page);
+    pageInputLatency.endRender();
+}
+
+void MainComponent::filesDropped(const juce::StringArray& files, int x, int y)
+{
+    finishDeferredStartup(!sessionReplayer.isReplaying());
+
+    auto file = juce::File(files[0]);
+    DBG("File dropped: " + file.getFileName());
+
+    SessionEvent event { SessionEvent::Type::filesDropped };
+    event.files = files;
+    recordSessionEvent(event);
+
+    // 同时拖入多个音频文件：作为分轨同步播放
+    juce::Array<juce::File> audioFiles;
+    for (const auto& path : files)
+    {
+        const juce::File droppedFile(path);
+        if (droppedFile.hasFileExtension(".wav") || droppedFile.hasFileExtension(".mp3"))
+            audioFiles.add(droppedFile);
+    }
+
+    if (audioFiles.size() > 1)
     {
-        DBG("Invalid file provided for saving marker positions.");
+        audioFileLoader.loadStems(audioFiles);
         return;
     }
 
-    juce::FileOutputStream outputStream(file);
+    if (file.hasFileExtension(".wav") || file.hasFileExtension(".mp3"))
+    {
+        // 处理音频文件：在后台打开，完成后在 onLoaded 中换上
+        audioFileLoader.load(file);
+    }
+    else if (file.hasFileExtension(".pdf"))
+    {
+        // 使用 Poppler 处理 PDF 文件
+        loadAndDisplayPDF(file);
+        pdfFileNameLabel.setText("PDF: " + file.getFileName(), juce::dontSendNotification);
+        pdfFileNameLabel.setVisible(true);
+
+        // 设置字体颜色为粉色
+        pdfFileNameLabel.setColour(juce::Label::textColourId, juce::Colours::pink);
+        
+    }
+    else if (file.hasFileExtension(".markers"))
+    {
+        // 检查是否已加载音频文件
+        if (!audioPlayer.hasSource())
+        {
+            DBG("Load audio file before load marker file");
+            // 可以在界面上显示提示
+            return;
+        }
+
+        // 处理标记文件
+        loadMarkerPositions(file);
+        DBG("Marker positions loaded from: " + file.getFullPathName());
+    }
+    else if (file.hasFileExtension(".tempo"))
+    {
+        if (!audioPlayer.hasSource())
+        {
+            DBG("Load audio file before load tempo map");
+            return;
+        }
+
+        // 手动写好的速度图，优先于从标记推算的
+        tempoMapFromFile = tempoMap.loadFromFile(file);
+        rebuildClickTrack();
+    }
+    else if (file.hasFileExtension(ProjectFile::fileExtension))
+    {
+        openProject(file);
+    }
+    else if (file.hasFileExtension(".setlist"))
+    {
+        // 读取曲目单，并加载第一首
+        if (setlist.loadFromFile(file))
+        {
+            DBG("Setlist loaded with " + juce::String(setlist.getNumEntries()) + " pieces");
+            advanceToNextPiece();
+        }
+    }
+
+}
+
+void MainComponent::installAudioDeck(std::unique_ptr<AudioDeck> deck, bool startPlayback)
+{
+    const juce::File file = deck->file;
+    const double audioLength = deck->getLengthInSeconds();
+    MultiStemAudioSource* stems = deck->stems;
+
+    // 频谱图按源文件的采样率计算（多轨时用第一个分轨）
+    spectrogramCache.setSource(file, deck->sourceSampleRate, deck->readerSource->getTotalLength());
+
+    // 循环区间和小节线属于上一个文件
+    clearLoop();
+    clearDetectedBars();
+
+    // 新文件开始播放，旧文件在音频线程里淡出
+    if (startPlayback)
+        deck->transport.start();  // 开始播放音频
+
+    audioPlayer.swapTo(std::move(deck));
+
+    // 旧 deck 的分轨马上就会被释放，面板先换到新的 deck 上
+    stemMixer.setSource(stems);
+    stemMixer.setVisible(stems != nullptr);
+
+    audioFileNameLabel.setText("Audio: " + file.getFileName(), juce::dontSendNotification);
+    audioFileNameLabel.setVisible(true);
+    // 加载音频文件到 AudioThumbnail（后台已经生成过的会直接从 thumbnailCache 读取）
+    audioThumbnail.clear();
+    audioThumbnail.setSource(new juce::FileInputSource(file));
+    // 检查音频长度是否有效
+    if (audioLength > 0.0)
+    {
+        progressSlider.setRange(0.0, audioLength, 0.1);  // 设置范围为 0 到音频总时长，步进为 0.1 秒
+        progressSlider.setValue(0.0, juce::dontSendNotification);  // 初始值设为 0
+
+        // 同步更新 markerSlider 的范围
+        markerSlider.setRange(0.0, audioLength, 0.1); // 设置 markerSlider 的范围与 progressSlider 一致
+    }
+    else
+    {
+        DBG("Audio length is invalid: " + juce::String(audioLength));
+        // 设置一个默认范围，避免断言失败
+        progressSlider.setRange(0.0, 1.0, 0.1);
+        markerSlider.setRange(0.0, 1.0, 0.1);
+    }
+    // 速度图属于上一个文件；重新添加标记时节拍器会按新的标记推算
+    tempoMapFromFile = false;
+
+    // 在设置新的滑块范围后，重新添加标记
+    recalculateAndAddMarkers();
+
+    // 打开工程时直接用保存的标记和分析结果；否则后台建立起音索引（多轨时分析第一个分轨）
+    if (pendingProject != nullptr && file == pendingProjectAudio)
+    {
+        applyPendingProject();
+    }
+    else
+    {
+        pendingProject.reset();
+        beatTracker.analyse(file);
+    }
+}
+
+void MainComponent::advanceToNextPiece()
+{
+    if (!setlist.hasNextEntry())
+        return;
+
+    setlist.setCurrentIndex(setlist.getCurrentIndex() + 1);
+    const auto& entry = setlist.getEntry(setlist.getCurrentIndex());
+
+    // 后台已经准备好就直接使用，否则同步准备一次
+    auto piece = piecePreloader.takePreparedPiece(entry);
+
+    if (piece == nullptr)
+    {
+        DBG("Next piece was not preloaded, loading synchronously: " + entry.getName());
+        piece = std::make_unique<PreparedPiece>();
+        piece->entry = entry;
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(entry.audioFile));
+        piece->deck = AudioDeck::create(std::move(reader), audioPlayer.getPreparedBlockSize(), audioPlayer.getPreparedSampleRate());
+        if (piece->deck != nullptr)
+            piece->deck->file = entry.audioFile;
+        piece->pdfDocument = entry.pdfFile.existsAsFile() ? openPdfDocument(entry.pdfFile) : nullptr;
+        piece->hasMarkers = entry.markersFile.existsAsFile() && readMarkers(entry.markersFile, piece->markers);
+    }
+
+    adoptPreparedPiece(*piece);
+    updateSetlistControls();
+
+    // 当前曲子开始后，立即在后台准备下一首
+    if (setlist.hasNextEntry())
+        piecePreloader.preload(setlist.getEntry(setlist.getCurrentIndex() + 1),
+                               pdfImageComponent.getWidth(), pdfImageComponent.getHeight());
+    else
+        piecePreloader.cancel();
+}
+
+void MainComponent::adoptPreparedPiece(PreparedPiece& piece)
+{
+    audioPlayer.stop();
+
+    // 先装 PDF（决定页数），再装音频（决定标记范围），最后覆盖为保存的标记
+    if (piece.pdfDocument != nullptr)
+    {
+        PopplerDocument* document = piece.pdfDocument;
+        piece.pdfDocument = nullptr;
+        installPdfDocument(document, piece.entry.pdfFile, piece.firstPages);
+    }
+
+    if (piece.deck != nullptr)
+        installAudioDeck(std::move(piece.deck), false);
+
+    if (piece.hasMarkers)
+        applyMarkers(piece.markers);
+
+    showPageView(markerTimeline.getViewForPosition(audioPlayer.getCurrentPosition()));
+}
+
+void MainComponent::updateSetlistControls()
+{
+    const bool hasSetlist = !setlist.isEmpty();
+    nextPieceButton.setVisible(hasSetlist);
+    setlistLabel.setVisible(hasSetlist);
+    nextPieceButton.setEnabled(setlist.hasNextEntry());
+
+    if (hasSetlist && setlist.getCurrentIndex() >= 0)
+    {
+        setlistLabel.setText("Piece " + juce::String(setlist.getCurrentIndex() + 1) + "/" + juce::String(setlist.getNumEntries())
+                                 + ": " + setlist.getEntry(setlist.getCurrentIndex()).getName(),
+                             juce::dontSendNotification);
+    }
+}
+
+void MainComponent::recalculateAndAddMarkers()
+{
+    // 清除现有标记
+    markerSlider.clearMarkers();
+
+    // 如果 totalNumPages 小于等于 1，则不添加标记
+    if (totalNumPages <= 1)
+    {
+        rebuildMarkerTimeline();
+        return;
+    }
+
+    double sliderMin = markerSlider.getMinimum();
+    double sliderMax = markerSlider.getMaximum();
+    double sliderRange = sliderMax - sliderMin;
+
+    // 使用音频长度计算标记位置
+    for (int i = 1; i < totalNumPages; ++i)
+    {
+        double markerPosition = sliderMin + (static_cast<double>(i) / totalNumPages) * sliderRange;
+        markerSlider.addMarker(markerPosition);
+    }
+
+    rebuildMarkerTimeline();
+}
+
+void MainComponent::rebuildMarkerTimeline()
+{
+    markerTimeline.rebuild(markerSlider.getMarkers(), totalNumPages);
+    lastTimelineView = markerTimeline.getViewForPosition(audioPlayer.getCurrentPosition());
+
+    // 节拍器从标记推算速度时，标记变了拍子也要跟着变
+    if (!tempoMapFromFile)
+        rebuildClickTrack();
+}
+
+void MainComponent::rebuildClickTrack()
+{
+    if (!clickButton.getToggleState() || !audioPlayer.hasSource())
+        return;
+
+    // 检测到小节时按小节推算，否则把标记之间分成若干小节（有检测到的速度时以它为准）
+    if (!tempoMapFromFile && markerTimeline.getNumBars() > 1)
+        tempoMap.buildFromBarTimes(markerTimeline.getBarTimes(), detectedBeatsPerBar);
+    else if (!tempoMapFromFile)
+        tempoMap.buildFromMarkers(markerSlider.getMarkers(), detectedBeatsPerBar,
+                                  detectedAnalysis.bpm > 0.0 ? detectedAnalysis.bpm : TempoMap::defaultBpm);
+
+    audioPlayer.setClickBeats(tempoMap.computeBeats(audioPlayer.getLengthInSeconds()));
+}
+
+void MainComponent::detectBars()
+{
+    if (!audioPlayer.hasSource())
+    {
+        DBG("No audio loaded, nothing to analyse");
+        return;
+    }
+
+    // 加载时已经开始分析，完成后显示
+    barsRequested = true;
+
+    if (hasDetectedAnalysis)
+    {
+        applyDetectedBars();
+        return;
+    }
+
+    barsButton.setEnabled(false);
+    barsButton.setButtonText("...");
+}
+
+void MainComponent::applyDetectedBars()
+{
+    barsButton.setEnabled(true);
+    barsButton.setButtonText("Bars");
+
+    if (detectedAnalysis.barTimes.empty())
+    {
+        DBG("No bars were detected");
+        return;
+    }
+
+    markerTimeline.setBars(detectedAnalysis.barTimes);
+    markerSlider.setBarPositions(detectedAnalysis.barTimes);
+    detectedBeatsPerBar = detectedAnalysis.beatsPerBar;
+
+    if (!tempoMapFromFile)
+        rebuildClickTrack();
+}
+
+void MainComponent::clearDetectedBars()
+{
+    beatTracker.cancel();
+    detectedAnalysis = BeatAnalysis();
+    hasDetectedAnalysis = false;
+    barsRequested = false;
+    onsetIndex.clear();
+    markerTimeline.setBars({});
+    markerSlider.setBarPositions({});
+    detectedBeatsPerBar = 4;
+    barsButton.setEnabled(true);
+    barsButton.setButtonText("Bars");
+}
+
+void MainComponent::setClickSeparateOutput(bool shouldUseSeparateOutput)
+{
+    // 单独输出需要打开 4 个输出声道；设备不支持时退回到混进主输出
+    setAudioChannels(0, shouldUseSeparateOutput ? 4 : 2);
+
+    auto* device = deviceManager.getCurrentAudioDevice();
+    const bool hasSeparateOutput = device != nullptr && device->getActiveOutputChannels().countNumberOfSetBits() >= 4;
+
+    if (shouldUseSeparateOutput && !hasSeparateOutput)
+    {
+        DBG("Audio device has no output channels 3/4, click stays on the main output");
+        setAudioChannels(0, 2);
+        clickOutputButton.setToggleState(false, juce::dontSendNotification);
+    }
+
+    audioPlayer.setClickSeparateOutput(shouldUseSeparateOutput && hasSeparateOutput);
+}
 
-    if (!outputStream.openedOk())
-    {
-        DBG("Failed to open file for writing: " + file.getFullPathName());
+void MainComponent::syncPageToPosition(double position)
+{
+    PLAYER_TRACE_SCOPE("markerDetection", "ui");
+
+    // seek 和进度刷新都经过这里，主机顺便把位置发给从机
+    publishSyncState();
+
+    // 只有时间线上的页码变化时才翻页（经过标记或 seek），手动翻页会保留到下一次变化
+    const PageView timelineView = markerTimeline.getViewForPosition(position);
+    if (timelineView == lastTimelineView)
         return;
-    }
 
-    // 获取所有标记
-    const auto& markers = markerSlider.getMarkers();
+    lastTimelineView = timelineView;
+    markerSlider.updateTriggeredMarkers(position);
 
-    // 将每个标记的位置写入文件，每个位置占一行
-    for (const auto& marker : markers)
+    if (timelineView != currentView)
     {
-        outputStream.writeText(juce::String(marker.position) + "\n", false, false, "\n");
-    }
+        DBG("Marker timeline moved to page " + juce::String(timelineView.getLeadingPage() + 1) + " at position: " + juce::String(position));
+
+        // 播放中越过标记才算一次自动翻页；越过后经过的音频时间按播放速度换算成实际时间。
+        // 超过两个定时器周期的是 seek，不记录
+        const double changeTime = markerTimeline.getChangeTimeForPosition(position);
+        const double crossedAgo = (position - changeTime) / std::max(0.01, audioPlayer.getTempo()) * 1000.0;
+        const bool measured = audioPlayer.isPlaying() && changeTime >= 0.0 && crossedAgo <= 2.0 * refreshIntervalMs;
+
+        if (measured)
+            pageTurnLatency.beginTurn(changeTime, timelineView.getLeadingPage(), crossedAgo);
+
+        showPageView(timelineView);
 
-    outputStream.flush();
+        if (measured)
+            pageTurnLatency.endRender();
+    }
 }
 
 
-//marker load
-void MainComponent::loadMarkerPositions(const juce::File& file)
+void MainComponent::toggleLoop()
 {
-    if (file == juce::File{} || !file.existsAsFile())
+    if (loopButton.getToggleState())
     {
-        DBG("Invalid or non-existent file provided for loading marker positions.");
+        clearLoop();
         return;
     }
 
-    juce::FileInputStream inputStream(file);
+    if (!audioPlayer.hasSource())
+        return;
 
-    if (!inputStream.openedOk())
+    // 有选区就用选区，否则用当前位置前后最近的两个标记（没有标记时到文件的开头/结尾）
+    if (waveformDisplay.hasSelection())
     {
-        DBG("Failed to open file for reading: " + file.getFullPathName());
+        loadLoopRegion(waveformDisplay.getSelectionStart(), waveformDisplay.getSelectionEnd());
         return;
     }
 
-    // 清除当前的标记
-    markerSlider.clearMarkers();
-    markerTriggeredFlags.clear();
-
-    // 读取文件中的每一行，解析标记位置
-    while (!inputStream.isExhausted())
-    {
-        juce::String line = inputStream.readNextLine();
-        double position = line.getDoubleValue();
-
-        if (position >= markerSlider.getMinimum() && position <= markerSlider.getMaximum())
-        {
-            markerSlider.addMarker(position);
-        }
-        else
-        {
-            DBG("Marker position out of range: " + line);
-        }
-    }
+    const double position = audioPlayer.getCurrentPosition();
+    double start = 0.0;
+    double end = audioPlayer.getLengthInSeconds();
 
-    // 初始化触发标志
     for (const auto& marker : markerSlider.getMarkers())
     {
-        markerTriggeredFlags[&marker] = false;
+        if (marker.position <= position)
+            start = std::max(start, marker.position);
+        else
+            end = std::min(end, marker.position);
     }
-}
-
 
-
-//拖拽文件，仅对音频以及pdf文件感兴趣
-bool MainComponent::isInterestedInFileDrag(const juce::StringArray& files)
-{
-    const juce::File file(files[0]);
-    return file.hasFileExtension(".wav") || file.hasFileExtension(".mp3") || file.hasFileExtension(".pdf") || file.hasFileExtension(".markers");
+    loadLoopRegion(start, end);
 }
 
-void MainComponent::filesDropped(const juce::StringArray& files, int x, int y)
+void MainComponent::loadLoopRegion(double startSeconds, double endSeconds)
 {
-    auto file = juce::File(files[0]);
-    DBG("File dropped: " + file.getFileName());
-
-    if (file.hasFileExtension(".wav") || file.hasFileExtension(".mp3"))
-    {
-        // 处理音频文件
-        auto* reader = formatManager.createReaderFor(file);
-        if (reader != nullptr)
-        {
-            std::unique_ptr<juce::AudioFormatReaderSource> newSource(new juce::AudioFormatReaderSource(reader, true));
-            transportSource.setSource(newSource.get(), 0, nullptr, reader->sampleRate);
-            readerSource.reset(newSource.release());
-            transportSource.start();  // 开始播放音频
-            audioFileNameLabel.setText("Audio: " + file.getFileName(), juce::dontSendNotification);
-            audioFileNameLabel.setVisible(true);
-            // 加载音频文件到 AudioThumbnail
-            audioThumbnail.clear();
-            audioThumbnail.setSource(new juce::FileInputSource(file));
-            // 设置 progressSlider 的范围为音频总时长
-            double audioLength = audioThumbnail.getTotalLength();
-            // 检查音频长度是否有效
-            if (audioLength > 0.0)
-            {
-                progressSlider.setRange(0.0, audioLength, 0.1);  // 设置范围为 0 到音频总时长，步进为 0.1 秒
-                progressSlider.setValue(0.0, juce::dontSendNotification);  // 初始值设为 0
+    if (!audioPlayer.hasSource())
+        return;
 
-                // 同步更新 markerSlider 的范围
-                markerSlider.setRange(0.0, audioLength, 0.1); // 设置 markerSlider 的范围与 progressSlider 一致
-            }
-            else
-            {
-                DBG("Audio length is invalid: " + juce::String(audioLength));
-                // 设置一个默认范围，避免断言失败
-                progressSlider.setRange(0.0, 1.0, 0.1);
-                markerSlider.setRange(0.0, 1.0, 0.1);
-            }
-            // 在设置新的滑块范围后，重新添加标记
-            recalculateAndAddMarkers();
-            // 重置 markerTriggeredFlags
-            for (auto& [marker, triggered] : markerTriggeredFlags)
-            {
-                triggered = false;
-            }
-        }
-    }
-    else if (file.hasFileExtension(".pdf"))
-    {
-        // 使用 Poppler 处理 PDF 文件
-        loadAndDisplayPDF(file);
-        pdfFileNameLabel.setText("PDF: " + file.getFileName(), juce::dontSendNotification);
-        pdfFileNameLabel.setVisible(true);
+    DBG("Loading loop region " + juce::String(startSeconds) + " - " + juce::String(endSeconds));
 
-        // 设置字体颜色为粉色
-        pdfFileNameLabel.setColour(juce::Label::textColourId, juce::Colours::pink);
-        
-    }
-    else if (file.hasFileExtension(".markers"))
+    // 多轨也把区间整段读进内存（每轨一份），回绕时不 seek 各轨的预读缓冲
+    if (auto* stems = audioPlayer.getCurrentStems())
     {
-        // 检查是否已加载音频文件
-        if (readerSource.get() == nullptr)
-        {
-            DBG("Load audio file before load marker file");
-            // 可以在界面上显示提示
-            return;
-        }
+        juce::Array<juce::File> stemFiles;
+        for (int i = 0; i < stems->getNumStems(); ++i)
+            stemFiles.add(stems->getStemFile(i));
 
-        // 处理标记文件
-        loadMarkerPositions(file);
-        DBG("Marker positions loaded from: " + file.getFullPathName());
+        loopRegionLoader.loadStems(audioPlayer.getCurrentFile(), stemFiles, startSeconds, endSeconds);
+        return;
     }
 
+    loopRegionLoader.load(audioPlayer.getCurrentFile(), startSeconds, endSeconds);
 }
 
-void MainComponent::recalculateAndAddMarkers()
+void MainComponent::showLoopRange(double startSeconds, double endSeconds)
 {
-    // 清除现有标记
-    markerSlider.clearMarkers();
-    markerTriggeredFlags.clear();
-
-    // 如果 totalNumPages 小于等于 1，则不添加标记
-    if (totalNumPages <= 1)
+    if (!audioPlayer.hasLoopRegion())
         return;
 
-    double sliderMin = markerSlider.getMinimum();
-    double sliderMax = markerSlider.getMaximum();
-    double sliderRange = sliderMax - sliderMin;
-
-    // 使用音频长度计算标记位置
-    for (int i = 1; i < totalNumPages; ++i)
-    {
-        double markerPosition = sliderMin + (static_cast<double>(i) / totalNumPages) * sliderRange;
-        markerSlider.addMarker(markerPosition);
-    }
-
-    // 初始化触发标志
-    for (const auto& marker : markerSlider.getMarkers())
-    {
-        markerTriggeredFlags[&marker] = false;
-    }
+    waveformDisplay.setLoopRange(startSeconds, endSeconds);
+    loopButton.setToggleState(true, juce::dontSendNotification);
 }
 
+void MainComponent::clearLoop()
+{
+    loopRegionLoader.cancel();
+    audioPlayer.clearLoopRegion();
+    waveformDisplay.setLoopRange(0.0, 0.0);
+    waveformDisplay.clearSelection();
+    loopButton.setToggleState(false, juce::dontSendNotification);
+}
 
 //需要手动指定删除器
 struct PopplerDocumentDeleter
@@ -568,13 +1436,15 @@ struct PopplerPageDeleter
 
 void MainComponent::loadAndDisplayPDF(const juce::File& pdfFile)
 {
-    // 使用 juce::URL::addEscapeChars 对文件路径进行编码
-    juce::String filePath = pdfFile.getFullPathName();
-    juce::String escapedFilePath = juce::URL::addEscapeChars(filePath, "");
+    // 使用 Poppler C API 加载 PDF 文档
+    PopplerDocument* document = openPdfDocument(pdfFile);
 
-    // 构建正确的文件 URI
-    juce::String fileURI = juce::URL(pdfFile).toString(true);
+    if (document != nullptr)
+        installPdfDocument(document, pdfFile, {});
+}
 
+void MainComponent::installPdfDocument(PopplerDocument* document, const juce::File& pdfFile, const std::vector<juce::Image>& preRenderedPages)
+{
     // 释放之前的 PDF 文档
     if (pdfDoc)
     {
@@ -582,216 +1452,323 @@ void MainComponent::loadAndDisplayPDF(const juce::File& pdfFile)
         pdfDoc = nullptr;
     }
 
-    // 使用 Poppler C API 加载 PDF 文档
-    GError* gerror = nullptr;
-    pdfDoc = poppler_document_new_from_file(fileURI.toRawUTF8(), nullptr, &gerror);
-
-    if (!pdfDoc)
-    {
-        juce::String errorMessage = "Failed to load PDF file.";
-        if (gerror != nullptr && gerror->message != nullptr)
-        {
-            errorMessage += " Error: " + juce::String(gerror->message);
-        }
-        else
-        {
-            errorMessage += " Unknown error.";
-        }
-
-        DBG(errorMessage);
-
-        if (gerror != nullptr)
-        {
-            g_error_free(gerror);
-        }
-
-        return;
-    }
-
+    pdfDoc = document;
 
     // 存储 PDF 文件名
     pdfDocFileName = pdfFile.getFileName();
+    pdfDocFile = pdfFile;
 
     // 初始化页码
     currentPageIndex = 0;
     totalNumPages = poppler_document_get_n_pages(pdfDoc);
 
-    // 加载并显示当前页
-    PopplerPage* pdfPage = poppler_document_get_page(pdfDoc, currentPageIndex);
-    if (pdfPage)
-    {
-        renderPdfPageToComponent(pdfPage, pdfImageComponent, currentPageIndex);
-        g_object_unref(pdfPage);
-    }
-    else
+    // 清空缓存，避免上一个文档的页面被当成新文档的页面显示
+    renderedPageCache.clear();
+
+    // 后台已经渲染好的页面直接放进缓存
+    for (size_t i = 0; i < preRenderedPages.size(); ++i)
+        renderedPageCache.addRaster(static_cast<int>(i), preRenderedPages[i]);
+
+    // 确认第一页可以加载
+    PopplerPage* firstPage = poppler_document_get_page(pdfDoc, currentPageIndex);
+    if (firstPage == nullptr)
     {
         DBG("Failed to load page " + juce::String(currentPageIndex));
         g_object_unref(pdfDoc);
         pdfDoc = nullptr;
         return;
     }
+    g_object_unref(firstPage);
+
+    // 后台预渲染线程使用自己的一份文档
+    pagePrefetcher.setDocument(juce::URL(pdfFile).toString(true));
+
+    // 调用 recalculateAndAddMarkers 来添加标记
+    recalculateAndAddMarkers();
+
+    // 加载并显示当前音频位置对应的页面和下一页预览
+    showPageView(markerTimeline.getViewForPosition(audioPlayer.getCurrentPosition()));
+    pdfFileNameLabel.setVisible(true);
+
+    // 确保 PDF 显示区域可见
+    pdfImageComponent.setVisible(true);
+    repaint();
+}
+
+void MainComponent::showPage(int pageIndex)
+{
+    if (pdfDoc == nullptr || totalNumPages <= 0)
+        return;
+
+    pageIndex = juce::jlimit(0, totalNumPages - 1, pageIndex);
+
+    // 加载并显示当前页
+    PopplerPage* pdfPage = poppler_document_get_page(pdfDoc, pageIndex);
+    if (pdfPage == nullptr)
+    {
+        DBG("Failed to load page " + juce::String(pageIndex));
+        return;
+    }
 
-    // 加载并显示下一页预览
-    if (currentPageIndex + 1 < totalNumPages)
+    currentPageIndex = pageIndex;
+    currentView = PageView { pageIndex, -1 };
+    publishSyncState();  // 先通知从机，它们和这里同时渲染
+    renderPdfPageToComponent(pdfPage, pdfImageComponent, currentPageIndex);
+    g_object_unref(pdfPage);
+
+    // 加载并显示下一页预览（按标记的演奏顺序，不一定是页码 + 1）
+    nextPageIndex = findPreviewPage();
+    PopplerPage* nextPdfPage = nextPageIndex >= 0 ? poppler_document_get_page(pdfDoc, nextPageIndex) : nullptr;
+    if (nextPdfPage)
     {
-        PopplerPage* nextPdfPage = poppler_document_get_page(pdfDoc, currentPageIndex + 1);
-        if (nextPdfPage)
-        {
-            renderPdfPageToComponent(nextPdfPage, nextPagePreview, currentPageIndex + 1);
-            g_object_unref(nextPdfPage);
-            nextPagePreview.setVisible(true);
-        }
+        renderPdfPageToComponent(nextPdfPage, nextPagePreview, nextPageIndex);
+        g_object_unref(nextPdfPage);
+        nextPagePreview.setVisible(true);
     }
     else
     {
         nextPagePreview.setVisible(false);
     }
 
-    // 更新 PDF 文件名标签
+    // 更新 PDF 文件名标签，显示当前页码
     pdfFileNameLabel.setText("PDF: " + pdfDocFileName + " (Page " + juce::String(currentPageIndex + 1) + "/" + juce::String(totalNumPages) + ")", juce::dontSendNotification);
-    pdfFileNameLabel.setVisible(true);
-
-    // 调用 recalculateAndAddMarkers 来添加标记
-    recalculateAndAddMarkers();
-    /*// 清除现有标记
-    markerSlider.clearMarkers();
-    markerTriggeredFlags.clear();
-    if (totalNumPages > 1)
-    {
-        // 获取滑块的最小值和最大值
-        double sliderMin = markerSlider.getMinimum();
-        double sliderMax = markerSlider.getMaximum();
-        double sliderRange = sliderMax - sliderMin;
-
-        for (int i = 1; i < totalNumPages; ++i)
-        {
-            // 计算标记的位置，基于滑块的范围（0 到 1）
-            double markerPosition = sliderMin + (static_cast<double>(i) / totalNumPages) * sliderRange;
-            markerSlider.addMarker(markerPosition);
-        }
-    
-
-        // 初始化触发标志
-        for (const auto& marker : markerSlider.getMarkers())
-        {
-            markerTriggeredFlags[&marker] = false;
-        }
-    }*/
 
-    // 根据总页数启用或禁用 Next 按钮
-    nextButton.setEnabled(currentPageIndex + 1 < totalNumPages);
+    // 更新按钮的启用状态
     beforeButton.setEnabled(currentPageIndex > 0);
-      
-    // 确保 PDF 显示区域可见
-    pdfImageComponent.setVisible(true);
+    nextButton.setEnabled(currentPageIndex + 1 < totalNumPages);
+
     repaint();
-    // 清空缓存
-    renderedPageCache.clear();
 
+    prefetchAroundPage(currentPageIndex);
 }
 
-void MainComponent::renderPdfPageToComponent(PopplerPage* pdfPage, juce::ImageComponent& component, int pageIndex)
+void MainComponent::showPageView(const PageView& view)
+{
+    if (view.isHalfTurn())
+        showHalfTurn(view);
+    else
+        showPage(view.page);
+}
+
+void MainComponent::showHalfTurn(const PageView& view)
 {
-    // 检查缓存中是否已有该页面的图像
-    auto it = renderedPageCache.find(pageIndex);
-    if (it != renderedPageCache.end())
+    if (pdfDoc == nullptr || totalNumPages <= 0)
+        return;
+
+    const int width = pdfImageComponent.getWidth();
+    const int height = pdfImageComponent.getHeight();
+    PopplerPage* lowerPage = poppler_document_get_page(pdfDoc, juce::jlimit(0, totalNumPages - 1, view.page));
+    PopplerPage* upperPage = poppler_document_get_page(pdfDoc, juce::jlimit(0, totalNumPages - 1, view.topPage));
+
+    if (lowerPage == nullptr || upperPage == nullptr || width <= 0 || height <= 0)
     {
-        // 使用缓存的图像
-        component.setImage(it->second);
+        DBG("Failed to load pages for half-page turn");
+        if (lowerPage != nullptr)
+            g_object_unref(lowerPage);
+        if (upperPage != nullptr)
+            g_object_unref(upperPage);
         return;
     }
 
-    // 获取组件的尺寸
-    const int targetWidth = component.getWidth();
-    const int targetHeight = component.getHeight();
-
-    // 获取 PDF 页面尺寸（以点为单位，1点=1/72英寸）
-    double pdfPageWidthPoints, pdfPageHeightPoints;
-    poppler_page_get_size(pdfPage, &pdfPageWidthPoints, &pdfPageHeightPoints);
+    // 两页都从缓存取（需要时渲染），下半部分是正在读的页，上半部分已经换成下一页
+    const auto lowerImage = getPageImage(lowerPage, view.page, width, height);
+    const auto upperImage = getPageImage(upperPage, view.topPage, width, height);
+    g_object_unref(lowerPage);
+    g_object_unref(upperPage);
 
-    // 计算 PDF 页面宽高比
-    double pdfAspectRatio = pdfPageWidthPoints / pdfPageHeightPoints;
-    double componentAspectRatio = static_cast<double>(targetWidth) / targetHeight;
+    juce::Image combined(juce::Image::ARGB, width, height, true);
+    {
+        juce::Graphics g(combined);
+        const auto area = combined.getBounds().toFloat();
+        const auto placement = pdfImageComponent.getImagePlacement();
+        g.drawImage(lowerImage, area, placement);
+
+        juce::Graphics::ScopedSaveState state(g);
+        g.reduceClipRegion(0, 0, width, height / 2);
+        g.fillAll(juce::Colours::white);
+        g.drawImage(upperImage, area, placement);
+    }
 
-    // 根据组件尺寸和 PDF 页面比例，计算渲染尺寸
-    int renderWidth, renderHeight;
-    if (pdfAspectRatio > componentAspectRatio)
     {
-        // PDF 更宽，以组件宽度为基准
-        renderWidth = targetWidth;
-        renderHeight = static_cast<int>(renderWidth / pdfAspectRatio);
+        // 中间画一条线，提醒上下两半来自不同的页
+        juce::Graphics g(combined);
+        g.setColour(juce::Colours::grey);
+        g.drawHorizontalLine(height / 2, 0.0f, static_cast<float>(width));
     }
-    else
+
+    currentPageIndex = view.page;
+    currentView = view;
+    publishSyncState();
+    pdfImageComponent.setImage(combined);
+
+    nextPageIndex = findPreviewPage();
+    PopplerPage* nextPdfPage = nextPageIndex >= 0 ? poppler_document_get_page(pdfDoc, nextPageIndex) : nullptr;
+    if (nextPdfPage)
     {
-        // PDF 更高，以组件高度为基准
-        renderHeight = targetHeight;
-        renderWidth = static_cast<int>(renderHeight * pdfAspectRatio);
+        renderPdfPageToComponent(nextPdfPage, nextPagePreview, nextPageIndex);
+        g_object_unref(nextPdfPage);
     }
+    nextPagePreview.setVisible(nextPdfPage != nullptr);
+
+    pdfFileNameLabel.setText("PDF: " + pdfDocFileName + " (Page " + juce::String(view.topPage + 1) + " top, " + juce::String(view.page + 1)
+                             + " bottom/" + juce::String(totalNumPages) + ")", juce::dontSendNotification);
+    beforeButton.setEnabled(currentPageIndex > 0);
+    nextButton.setEnabled(currentPageIndex + 1 < totalNumPages);
+
+    repaint();
+    prefetchAroundPage(view.topPage);
+}
+
+int MainComponent::findPreviewPage() const
+{
+    // 标记决定的下一页（跳过正在显示的页），没有时按页码
+    for (int page : markerTimeline.getUpcomingPages(audioPlayer.getCurrentPosition(), 3))
+        if (page != currentView.page && page != currentView.topPage)
+            return page;
+
+    const int next = currentView.getLeadingPage() + 1;
+    return next < totalNumPages ? next : -1;
+}
+
+void MainComponent::prefetchAroundPage(int pageIndex)
+{
+    // 先按演奏顺序预渲染接下来会翻到的页（反复、D.S. 跳回去的页也在里面），
+    // 再预渲染目标页的前后邻页，手动往哪个方向翻都能直接从缓存取
+    const int width = pdfImageComponent.getWidth();
+    const int height = pdfImageComponent.getHeight();
+    std::vector<int> pagesToPrefetch;
 
-    // 设置目标 DPI
-    double targetDPI = (renderWidth * 144.0) / pdfPageWidthPoints;
+    auto addPage = [&](int page)
+    {
+        if (page >= 0 && page < totalNumPages && page != nextPageIndex
+            && std::find(pagesToPrefetch.begin(), pagesToPrefetch.end(), page) == pagesToPrefetch.end()
+            && ! renderedPageCache.hasRasterCovering(page, width, height))
+            pagesToPrefetch.push_back(page);
+    };
 
-    // 创建 Cairo Surface
-    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, renderWidth, renderHeight);
-    cairo_t* cr = cairo_create(surface);
+    for (int page : markerTimeline.getUpcomingPages(audioPlayer.getCurrentPosition(), 4))
+        addPage(page);
 
-    // 设置抗锯齿
-    cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
+    for (int neighbour : { pageIndex + 1, pageIndex + 2, pageIndex - 1, pageIndex + 3, pageIndex - 2 })
+        addPage(neighbour);
 
-    // 设置缩放比例
-    double scale = targetDPI / 144.0;
-    cairo_scale(cr, scale, scale);
+    pagePrefetcher.requestPages(pagesToPrefetch, width, height);
+}
 
-    // 渲染 PDF 页面到 Cairo Surface
-    poppler_page_render(pdfPage, cr);
+void MainComponent::showMarkerMenu(int markerIndex)
+{
+    const auto& markers = markerSlider.getMarkers();
+    if (markerIndex < 0 || markerIndex >= static_cast<int>(markers.size()))
+        return;
 
-    // 读取 Cairo Surface 数据并将其转换为 JUCE 图像
-    unsigned char* data = cairo_image_surface_get_data(surface);
-    cairo_surface_flush(surface);  // 确保数据已刷新
+    const Marker& marker = markers[static_cast<size_t>(markerIndex)];
+    const bool sequential = marker.targetPage < 0;
 
-    juce::Image juceImage(juce::Image::ARGB, renderWidth, renderHeight, false);
+    juce::PopupMenu jumpMenu;
+    for (int page = 0; page < totalNumPages; ++page)
+        jumpMenu.addItem(100 + page, "Page " + juce::String(page + 1), true, marker.targetPage == page);
 
-    // 获取每行的字节数（步幅）
-    int stride = cairo_image_surface_get_stride(surface);
+    juce::PopupMenu menu;
+    menu.addItem(1, "Turn to next page", true, marker.action == MarkerAction::turn && sequential);
+    menu.addItem(2, "Half-page turn", true, marker.action == MarkerAction::halfTurn);
+    menu.addItem(3, "Hold page", true, marker.action == MarkerAction::hold);
+    menu.addSubMenu("Jump to page (repeat, D.S., coda)", jumpMenu, totalNumPages > 0, juce::Image(), marker.action == MarkerAction::turn && ! sequential);
 
-    // 复制像素数据，处理颜色通道和预乘 Alpha
-    for (int y = 0; y < renderHeight; ++y)
+    const double position = marker.position;
+    menu.showMenuAsync(juce::PopupMenu::Options(), [this, markerIndex, position](int result)
     {
-        for (int x = 0; x < renderWidth; ++x)
-        {
-            int offset = y * stride + x * 4;
+        // 菜单打开期间标记可能已经变了
+        const auto& current = markerSlider.getMarkers();
+        if (result == 0 || markerIndex >= static_cast<int>(current.size()) || current[static_cast<size_t>(markerIndex)].position != position)
+            return;
 
-            // 读取 32 位像素值
-            uint32_t pixel = *reinterpret_cast<uint32_t*>(data + offset);
+        const int keepTarget = current[static_cast<size_t>(markerIndex)].targetPage;
 
-            // 提取颜色通道，假设系统是小端字节序（常见于 x86 架构）
-            juce::uint8 alpha = (pixel >> 24) & 0xFF;
-            juce::uint8 red   = (pixel >> 16) & 0xFF;
-            juce::uint8 green = (pixel >> 8)  & 0xFF;
-            juce::uint8 blue  = pixel & 0xFF;
+        if (result == 1)
+            markerSlider.setMarkerAction(markerIndex, MarkerAction::turn, -1);
+        else if (result == 2)
+            markerSlider.setMarkerAction(markerIndex, MarkerAction::halfTurn, keepTarget);
+        else if (result == 3)
+            markerSlider.setMarkerAction(markerIndex, MarkerAction::hold, -1);
+        else if (result >= 100)
+            markerSlider.setMarkerAction(markerIndex, MarkerAction::turn, result - 100);
 
-            // 处理预乘 Alpha（将颜色值除以 Alpha 值）
-            if (alpha != 0)
-            {
-                red   = static_cast<juce::uint8>(std::min((red * 255) / alpha, 255));
-                green = static_cast<juce::uint8>(std::min((green * 255) / alpha, 255));
-                blue  = static_cast<juce::uint8>(std::min((blue * 255) / alpha, 255));
-            }
+        rebuildMarkerTimeline();
+        syncPageToPosition(audioPlayer.getCurrentPosition());
+    });
+}
 
-            // 设置像素到 JUCE 图像
-            juceImage.setPixelAt(x, y, juce::Colour::fromRGBA(red, green, blue, alpha));
-        }
+void MainComponent::renderPdfPageToComponent(PopplerPage* pdfPage, juce::ImageComponent& component, int pageIndex)
+{
+    // 获取组件的尺寸
+    const int targetWidth = component.getWidth();
+    const int targetHeight = component.getHeight();
+
+    if (targetWidth <= 0 || targetHeight <= 0)
+        return;
+
+    PLAYER_TRACE_SCOPE("renderPdfPageToComponent", "page");
+    const auto image = getPageImage(pdfPage, pageIndex, targetWidth, targetHeight);
+
+    // 在组件中显示图像
+    PLAYER_TRACE_SCOPE("setImage", "page");
+    component.setImage(image);
+}
+
+juce::Image MainComponent::getPageImage(PopplerPage* pdfPage, int pageIndex, int targetWidth, int targetHeight)
+{
+    PLAYER_TRACE_SCOPE("pageCacheLookup", "page");
+
+    // 优先从缓存中不小于目标尺寸的栅格缩小得到
+    auto lookup = renderedPageCache.getImageFor(pageIndex, targetWidth, targetHeight);
+
+    // 窗口还在拖动时不调用 Poppler，先显示近似图，等窗口稳定后再渲染
+    const bool isResizing = pageRerenderCallback.isTimerRunning();
+
+    if (lookup.needsRender && pdfPage != nullptr && (! isResizing || ! lookup.image.isValid()))
+    {
+        // 按主显示区域的尺寸渲染，这样预览和之后的翻页都可以从同一张栅格缩小得到
+        const int rasterWidth = std::max(targetWidth, pdfImageComponent.getWidth());
+        const int rasterHeight = std::max(targetHeight, pdfImageComponent.getHeight());
+
+        // 磁盘缓存只在后台预渲染时读取，这里不扫目录、不解码 PNG
+        auto raster = renderPdfPageToImage(pdfPage, rasterWidth, rasterHeight);
+
+        renderedPageCache.addRaster(pageIndex, raster);
+        lookup = renderedPageCache.getImageFor(pageIndex, targetWidth, targetHeight);
     }
 
-    // 在组件中显示图像，不进行缩放
-    component.setImage(juceImage);
+    return lookup.image;
+}
+
+void MainComponent::refreshDisplayedPages()
+{
+    if (pdfDoc == nullptr)
+        return;
+
+    // 半页翻的画面需要重新拼
+    if (currentView.isHalfTurn())
+    {
+        showHalfTurn(currentView);
+        return;
+    }
 
-    // 将图像存入缓存
-    renderedPageCache[pageIndex] = juceImage;
+    PopplerPage* pdfPage = poppler_document_get_page(pdfDoc, currentPageIndex);
+    if (pdfPage)
+    {
+        renderPdfPageToComponent(pdfPage, pdfImageComponent, currentPageIndex);
+        g_object_unref(pdfPage);
+    }
 
-    // 清理 Cairo 资源
-    cairo_destroy(cr);
-    cairo_surface_destroy(surface);
+    if (nextPageIndex >= 0 && nextPageIndex < totalNumPages)
+    {
+        PopplerPage* nextPdfPage = poppler_document_get_page(pdfDoc, nextPageIndex);
+        if (nextPdfPage)
+        {
+            renderPdfPageToComponent(nextPdfPage, nextPagePreview, nextPageIndex);
+            g_object_unref(nextPdfPage);
+        }
+    }
 }
 
 //==============================================================================
@@ -799,6 +1776,18 @@ void MainComponent::renderPdfPageToComponent(PopplerPage* pdfPage, juce::ImageCo
 
 void MainComponent::paint(juce::Graphics& g)
 {
+    // 第一次画出窗口后再做剩下的初始化
+    if (!deferredStartupScheduled)
+    {
+        deferredStartupScheduled = true;
+        StartupProfile::mark("firstPaint");
+        juce::MessageManager::callAsync([safeThis = juce::Component::SafePointer<MainComponent>(this)]
+        {
+            if (safeThis != nullptr)
+                safeThis->finishDeferredStartup(true);
+        });
+    }
+
     // 设置白色背景
     g.fillAll(juce::Colours::white);
 
@@ -862,6 +1851,7 @@ void MainComponent::resized()
     int pdfX = margin;
     int pdfY = margin * 3;
 
+    const bool pdfAreaChanged = pdfImageComponent.getWidth() != pdfWidth || pdfImageComponent.getHeight() != pdfHeight;
     pdfImageComponent.setBounds(pdfX, pdfY, pdfWidth, pdfHeight);
 
     // 调整 PDF 文件名标签的大小
@@ -900,6 +1890,10 @@ void MainComponent::resized()
 
     nextPagePreview.setBounds(previewX, previewY, previewWidth, previewHeight);
 
+    // 多轨混音面板放在预览上方的空白处
+    stemMixer.setBounds(previewX, pdfY, previewWidth, std::max(0, previewY - spacing - pdfY));
+    diagnosticsPanel.setBounds(stemMixer.getBounds());
+
     // 设置进度条和波形显示的位置（保持对称）
     int audioLabelWidth = 100;  // 音频标签的宽度（左右相同）
     int sliderY = getHeight() - margin - buttonHeight - spacing - sliderHeight - spacing - labelHeight;
@@ -922,6 +1916,14 @@ void MainComponent::resized()
     int buttonX = markerSlider.getRight() + spacing; // 在 markerSlider 右侧
     int buttonY = markerSlider.getY() + (markerSlider.getHeight() - buttonHeight) / 2; // 垂直居中
     saveMarkersButton.setBounds(buttonX, buttonY, buttonWidth + 10, buttonHeight);
+    // 频谱图和节拍器的开关放在预览下方、和翻页按钮同一行：这里右边总有预览那么宽的空位，
+    // 不会像放在 markerSlider 左侧那样在窄窗口里移出屏幕或压住位置标签
+    auto toggleRow = juce::Rectangle<int>(nextPagePreview.getX(), controlsY, nextPagePreview.getWidth(), labelButtonHeight);
+    spectrogramButton.setBounds(toggleRow.removeFromLeft(45));
+    toggleRow.removeFromLeft(5);
+    clickButton.setBounds(toggleRow.removeFromLeft(45));
+    toggleRow.removeFromLeft(5);
+    clickOutputButton.setBounds(toggleRow.removeFromLeft(55));
     // 计算左侧剩余空间，并将 audioPositionLabel 居中
     int leftSpace = progressSliderX - margin;
     int audioPositionLabelX = margin + (leftSpace - audioLabelWidth) / 2;
@@ -946,5 +1948,22 @@ void MainComponent::resized()
     int buttonsY = audioFileNameLabel.getY();
     playButton.setBounds(audioFileNameLabel.getRight() + spacing, buttonsY, buttonWidth, buttonHeight);
     pauseButton.setBounds(playButton.getRight() + spacing, buttonsY, buttonWidth, buttonHeight);
-    
+    nextPieceButton.setBounds(pauseButton.getRight() + spacing, buttonsY, buttonWidth + 20, buttonHeight);
+
+    // 速度滑块放在这一行的最右侧
+    int tempoSliderWidth = 160;
+    tempoSlider.setBounds(getWidth() - margin - tempoSliderWidth, buttonsY, tempoSliderWidth, buttonHeight);
+    tempoLabel.setBounds(tempoSlider.getX() - 50, buttonsY, 50, buttonHeight);
+    loopButton.setBounds(tempoLabel.getX() - spacing - (buttonWidth + 20), buttonsY, buttonWidth + 20, buttonHeight);
+    barsButton.setBounds(loopButton.getX() - spacing - buttonWidth, buttonsY, buttonWidth, buttonHeight);
+    diagnosticsButton.setBounds(barsButton.getX() - spacing - buttonWidth, buttonsY, buttonWidth, buttonHeight);
+    setlistLabel.setBounds(nextPieceButton.getRight() + spacing, buttonsY,
+                           juce::jlimit(0, 220, diagnosticsButton.getX() - spacing - nextPieceButton.getRight() - spacing), buttonHeight);
+
+    // PDF 区域尺寸变化时先用缓存栅格缩放显示，窗口稳定后再重新渲染
+    if (pdfAreaChanged && pdfDoc != nullptr)
+    {
+        pageRerenderCallback.startTimer(300);
+        refreshDisplayedPages();
+    }
 }
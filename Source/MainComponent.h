@@ -9,6 +9,29 @@
 #include "WaveformDisplay.h"
 #include "MarkerSlider.h"
 #include "Marker.h"
+#include "PageImageCache.h"
+#include "PagePrefetcher.h"
+#include "MarkerTimeline.h"
+#include "Setlist.h"
+#include "PiecePreloader.h"
+#include "AudioDeckPlayer.h"
+#include "AudioFileLoader.h"
+#include "LoopRegionLoader.h"
+#include "StemMixerComponent.h"
+#include "TempoMap.h"
+#include "BeatTracker.h"
+#include "OnsetIndex.h"
+#include "ProjectFile.h"
+#include "PageTurnLatency.h"
+#include "AudioCallbackMonitor.h"
+#include "MemoryAccountant.h"
+#include "DiagnosticsPanel.h"
+#include "SessionRecording.h"
+#include "ActivityMeter.h"
+#include "StartupProfile.h"
+#include "PdfRendererWarmup.h"
+#include "PageTurnSync.h"
+#include "PageControlInput.h"
 
 
 //==============================================================================
@@ -55,13 +78,21 @@ public:
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
+
+    // 窗口再小时底部一行的按钮放不下（Main.cpp 里设成窗口的最小尺寸）
+    static constexpr int minimumWidth = 800;
+    static constexpr int minimumHeight = 600;
     
     // 文件拖拽处理
     bool isInterestedInFileDrag(const juce::StringArray& files) override;
     void filesDropped(const juce::StringArray& files, int x, int y) override;
 
-    // 定时器，用于更新播放进度条
+    // 翻页踏板模拟的 PageDown / PageUp 和左右方向键
+    bool keyPressed(const juce::KeyPress& key) override;
+
+    // 定时器，用于更新播放进度条；只在播放时运行，停下后不再定时唤醒
     void timerCallback() override;
+    static constexpr int refreshIntervalMs = 500;
     
     void setCurrentPosition(double newPosition)
         {
@@ -73,17 +104,37 @@ public:
     //marker file sace/load
     void saveMarkerPositions(const juce::File& file);
     void loadMarkerPositions(const juce::File& file);
+    void applyMarkers(const std::vector<Marker>& markers);
+    //project file save/open：标记、速度图、分析结果和波形峰值一起保存，打开时不重新计算
+    void saveProject(const juce::File& file);
+    void openProject(const juce::File& file);
+
+    // 所有缓存加起来的内存上限（--memory-budget）
+    void setMemoryBudget(size_t numBytes) { memoryAccountant.setBudget(numBytes); }
+
+    // 会话录制/回放（--record-session / --replay-session）：回放时关掉音频设备，用模拟时钟驱动，
+    // 结束后把统计打印到标准输出，再调用 onFinished
+    bool startSessionRecording(const juce::File& file) { return sessionRecorder.start(file); }
+    bool startSessionReplay(const juce::File& file, double speed, std::function<void()> onFinished);
+
+    // 局域网翻页同步（--sync-master / --sync-follow）：主机广播播放位置和当前页，
+    // 从机按自己的标记翻页（各自的分谱），没有标记时直接显示主机的页
+    bool startPageTurnSync(bool asMaster, const juce::String& groupAddress, int port);
+
+    // 窗口第一次画出来以后才打开音频设备、注册音频格式；这些和后台的 PDF 预热都完成时调用（--startup-time）
+    std::function<void()> onStartupFinished;
 
 private:
     //==============================================================================
     // Audio components
-    juce::AudioDeviceManager deviceManager;
     juce::AudioFormatManager formatManager;
-    juce::AudioTransportSource transportSource;
-    std::unique_ptr<juce::AudioFormatReaderSource> readerSource;
+    AudioDeckPlayer audioPlayer;                   // 当前播放的音频，换文件时无锁交换并淡入淡出
     juce::AudioThumbnailCache thumbnailCache;      // 声明 thumbnailCache
     juce::AudioThumbnail audioThumbnail;           // 声明 audioThumbnail
+    PiecePreloader piecePreloader;                 // 曲目单中下一首的后台预加载
+    SpectrogramCache spectrogramCache;             // 频谱图图块（必须比 waveformDisplay 活得久）
     WaveformDisplay waveformDisplay;               // 声明 waveformDisplay
+    juce::TextButton spectrogramButton{ "Spec" };  // 波形和频谱图之间切换
 
     // GUI components
     juce::Slider progressSlider;
@@ -93,20 +144,134 @@ private:
     juce::TextButton pauseButton{ "Pause" };
     juce::TextButton nextButton{ "Next" };  // 新增的“Next”按钮
     juce::TextButton beforeButton{ "Before" };  // 新增的“Before”按钮
-    juce::ImageComponent pdfImageComponent;
+    PageImageComponent pdfImageComponent;  // 画完时通知，用于测量翻页延迟
     juce::ImageComponent nextPagePreview;
 
+    // Audio handling
+    void installAudioDeck(std::unique_ptr<AudioDeck> deck, bool startPlayback);
+
+    // Setlist handling
+    void advanceToNextPiece();
+    void adoptPreparedPiece(PreparedPiece& piece);
+    void updateSetlistControls();
+    Setlist setlist;
+    juce::TextButton nextPieceButton{ "Next Piece" };
+    juce::Label setlistLabel;
+
+    // 练习速度（变速不变调）
+    juce::Slider tempoSlider;
+    juce::Label tempoLabel;
+
+    // A/B 循环：用波形上的选区，或者当前位置前后的两个标记
+    void toggleLoop();
+    void loadLoopRegion(double startSeconds, double endSeconds);
+    void clearLoop();
+    void showLoopRange(double startSeconds, double endSeconds);
+    juce::TextButton loopButton{ "Loop A/B" };
+
+    // 多轨播放时的混音面板
+    StemMixerComponent stemMixer;
+
+    // 节拍器：速度图来自 .tempo 文件，没有时从标记推算（每两个标记之间一小节）
+    void rebuildClickTrack();
+    void setClickSeparateOutput(bool shouldUseSeparateOutput);
+    TempoMap tempoMap;
+    bool tempoMapFromFile = false;
+    juce::TextButton clickButton{ "Click" };
+    juce::TextButton clickOutputButton{ "Out 3/4" };
+
+    // 节拍检测：加载音频后在后台分析，得到起音索引（拖动标记时吸附）和每小节的起点；
+    // 按 Bars 后显示小节线，没有 .tempo 文件时节拍器也用它
+    void detectBars();
+    void applyDetectedBars();
+    void clearDetectedBars();
+    BeatAnalysis detectedAnalysis;
+    bool hasDetectedAnalysis = false;
+    bool barsRequested = false;
+    int detectedBeatsPerBar = 4;
+    OnsetIndex onsetIndex;
+    juce::TextButton barsButton{ "Bars" };
+
+    // 翻页延迟：从音频越过标记到新页面画到屏幕上，按 Diag 显示分布，随工程一起保存；
+    // 音频回调负载和 xrun 也在同一个面板里，打开负载警告后出问题时 Diag 按钮变红
+    void checkAudioCallbackLoad();
+    PageTurnLatencyMonitor pageTurnLatency;
+    PageTurnLatencyMonitor pageInputLatency;  // 按钮、踏板、MIDI 和键盘翻页：从输入到新页面画出来
+    AudioCallbackMonitor audioCallbackMonitor;
+
+    // 内存账本：页面栅格、频谱图、波形、音频缓冲和预加载的下一首都登记在这里，超出预算时收缩缓存
+    void registerMemorySubsystems();
+    MemoryAccountant memoryAccountant;
+
+    // 播放/暂停/停止时由 audioPlayer 通知：启停界面定时器，空闲时只刷新一次显示
+    void transportStateChanged();
+    void refreshTransportDisplay();
+    ActivityMeter activityMeter;
+    DiagnosticsPanel diagnosticsPanel{ pageTurnLatency, audioCallbackMonitor, memoryAccountant, activityMeter, pageInputLatency };
+    juce::TextButton diagnosticsButton{ "Diag" };
+
+    // 录制时每个用户操作都记一条；回放时由 sessionReplayer 调用 applySessionEvent
+    void recordSessionEvent(SessionEvent event);
+    void applySessionEvent(const SessionEvent& event);
+    SessionRecorder sessionRecorder;
+    SessionReplayer sessionReplayer;
+
+    // 手动翻页（按钮、踏板、MIDI、键盘）都经过这里：页面从预渲染的缓存取，并测量输入到画面的延迟
+    void performPageAction(const PageControlInput::Action& action);
+    PageControlInput pageControlInput;
+
+    // 翻页同步：主机在播放状态、位置或页面变化时发布，从机收到后跟随
+    void publishSyncState();
+    void followMasterState();
+    PageTurnSync pageTurnSync;
+
+    // 播放中（或跟随主机播放时）按到下一个换页点的剩余时间定时，到点马上翻页，不等下一次进度刷新。
+    // 会话回放时定时挂在模拟时钟上，翻页的时机和实际播放时一样
+    void schedulePageTurn(double position, double tempo);
+    void pageTurnDue();
+    void startPageTurnTimer(int delayMs);
+    void stopPageTurnTimer();
+    juce::TimedCallback pageTurnCallback;
+
+    // 冷启动：构造时只搭界面，其余的在第一次 paint 之后做；拖入文件或回放会话时如果还没做完就立即做
+    void finishDeferredStartup(bool openAudioDevice);
+    void reportStartupIfFinished();
+    bool deferredStartupScheduled = false;
+    bool deferredStartupFinished = false;
+    PdfRendererWarmup pdfRendererWarmup;
+
+    // 正在打开的工程：音频在后台加载完成后再套用其中的标记和分析结果
+    void applyPendingProject();
+    std::unique_ptr<ProjectFile> pendingProject;
+    juce::File pendingProjectAudio;
+    std::vector<ProjectAnnotation> projectAnnotations;  // 界面还不显示注释，保存工程时原样写回
+
     // PDF handling
     void loadAndDisplayPDF(const juce::File& pdfFile);
+    void installPdfDocument(PopplerDocument* document, const juce::File& pdfFile, const std::vector<juce::Image>& preRenderedPages);
     void renderPdfPageToComponent(PopplerPage* pdfPage, juce::ImageComponent& component, int pageIndex);
+    juce::Image getPageImage(PopplerPage* pdfPage, int pageIndex, int targetWidth, int targetHeight);
+    void refreshDisplayedPages();  // 用缓存重新填充当前页和预览（窗口尺寸变化后调用）
+
+    // 页面导航：直接跳到任意页，并在后台预渲染它的邻页
+    void showPage(int pageIndex);
+    void showPageView(const PageView& view);  // 整页，或者半页翻时上下两半来自两页
+    void showHalfTurn(const PageView& view);
+    int findPreviewPage() const;  // 按演奏顺序接下来的一页，没有标记时是下一页
+    void prefetchAroundPage(int pageIndex);
+    void showMarkerMenu(int markerIndex);
+    void rebuildMarkerTimeline();
+    void syncPageToPosition(double position);  // 根据音频位置跳到对应页面
 
 
     // Poppler document
     PopplerDocument* pdfDoc = nullptr;
     int currentPageIndex = 0;
-    int nextPageIndex = currentPageIndex + 1;
+    int nextPageIndex = currentPageIndex + 1;  // 预览里显示的页
+    PageView currentView;                       // 当前显示的页面（可能是半页翻）
     int totalNumPages = 0;
     juce::String pdfDocFileName;  // 存储 PDF 文件名
+    juce::File pdfDocFile;
     juce::Label audioPositionLabel;  // 新增，用于显示音频播放秒数的标签
     juce::Label audioLengthLabel; //显示音频长度的标签
 
@@ -114,16 +279,24 @@ private:
     void changeListenerCallback(juce::ChangeBroadcaster* source);
     double currentPosition = 0.0; // 以秒为单位
     GrayLookAndFeel grayLookAndFeel;
+    AudioFileLoader audioFileLoader;  // 后台打开音频文件
+    LoopRegionLoader loopRegionLoader;  // 后台把循环区间读进内存
+    BeatTracker beatTracker;  // 后台节拍检测
     
     // 新增的 MarkerSlider
     MarkerSlider markerSlider; // 新的滑块用于显示标记
 
-    // 映射用于跟踪标记是否已触发
-    std::map<const Marker*, bool> markerTriggeredFlags;
+    // 标记时间线，把音频位置映射到页码
+    MarkerTimeline markerTimeline;
+    PageView lastTimelineView;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
     // markerSave button
     juce::TextButton saveMarkersButton;
     std::unique_ptr<juce::FileChooser> fileChooser; // 添加这一行
-    // 使用 std::map 或 std::unordered_map 作为缓存
-    std::unordered_map<int, juce::Image> renderedPageCache;
+    // 页面栅格缓存，缩放显示从缓存的高分辨率栅格得到
+    PageImageCache renderedPageCache;
+    // 窗口停止拖动一段时间后才重新用 Poppler 渲染
+    juce::TimedCallback pageRerenderCallback;
+    // 后台预渲染邻页
+    PagePrefetcher pagePrefetcher;
 };
@@ -9,12 +9,22 @@
 */
 // Marker.h
 #pragma once
+// 经过标记时对页面做什么
+enum class MarkerAction
+{
+    turn,      // 翻到目标页（默认是下一页）
+    halfTurn,  // 半页翻：上半部分换成目标页，下半部分还是当前页
+    hold       // 保持当前页面不动
+};
+
 //结构体marker，用来表示一个marker
 struct Marker
 {
     double position;     // 标记的位置，以秒为单位
     bool isDragging;     // 标记是否正在被拖动
     bool isTriggered;    // 标记是否已经被触发
+    MarkerAction action = MarkerAction::turn;
+    int targetPage = -1; // 目标页（从 0 开始）；-1 表示按顺序的下一页，其它值用于反复、D.S.、Coda 等跳转
 
     Marker(double pos)
         : position(pos), isDragging(false), isTriggered(false) {}
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    MarkerFile.h
+    Created: 19 Oct 2026 4:05:31pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+// MarkerFile.h
+
+#include <JuceHeader.h>
+#include "Marker.h"
+#include <vector>
+
+// .markers 文件每行一个标记："秒 [动作 [目标页]]"。
+// 动作是 turn / half / hold，目标页从 1 开始；只有位置的旧文件按顺序翻页。
+inline Marker parseMarkerLine(const juce::String& line)
+{
+    const auto tokens = juce::StringArray::fromTokens(line.trim(), " \t", "");
+    Marker marker(tokens[0].getDoubleValue());
+
+    if (tokens[1] == "half")
+        marker.action = MarkerAction::halfTurn;
+    else if (tokens[1] == "hold")
+        marker.action = MarkerAction::hold;
+
+    if (tokens.size() > 2)
+        marker.targetPage = tokens[2].getIntValue() - 1;
+
+    return marker;
+}
+
+inline juce::String formatMarkerLine(const Marker& marker)
+{
+    juce::String line(marker.position);
+
+    // 默认的顺序翻页只写位置，和旧文件一样
+    if (marker.action == MarkerAction::turn && marker.targetPage < 0)
+        return line;
+
+    line << (marker.action == MarkerAction::halfTurn ? " half" : marker.action == MarkerAction::hold ? " hold" : " turn");
+
+    if (marker.targetPage >= 0)
+        line << " " << (marker.targetPage + 1);
+
+    return line;
+}
+
+// 读取 .markers 文件。
+// 不做范围检查，范围由调用者根据音频长度决定，这样后台线程也可以提前读取。
+inline bool readMarkers(const juce::File& file, std::vector<Marker>& markers)
+{
+    markers.clear();
+
+    if (file == juce::File{} || !file.existsAsFile())
+    {
+        DBG("Invalid or non-existent file provided for loading marker positions.");
+        return false;
+    }
+
+    juce::FileInputStream inputStream(file);
+
+    if (!inputStream.openedOk())
+    {
+        DBG("Failed to open file for reading: " + file.getFullPathName());
+        return false;
+    }
+
+    // 读取文件中的每一行，解析标记位置
+    while (!inputStream.isExhausted())
+    {
+        juce::String line = inputStream.readNextLine();
+
+        if (line.trim().isNotEmpty())
+            markers.push_back(parseMarkerLine(line));
+    }
+
+    return true;
+}
+
+// 写入 .markers 文件，每个标记占一行
+inline bool writeMarkers(const juce::File& file, const std::vector<Marker>& markers)
+{
+    if (file == juce::File{})
+    {
+        DBG("Invalid file provided for saving marker positions.");
+        return false;
+    }
+
+    juce::FileOutputStream outputStream(file);
+
+    if (!outputStream.openedOk())
+    {
+        DBG("Failed to open file for writing: " + file.getFullPathName());
+        return false;
+    }
+
+    // 覆盖原来的内容
+    outputStream.setPosition(0);
+    outputStream.truncate();
+
+    for (const auto& marker : markers)
+        outputStream.writeText(formatMarkerLine(marker) + "\n", false, false, "\n");
+
+    outputStream.flush();
+    return outputStream.getStatus().wasOk();
+}
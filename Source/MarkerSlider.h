@@ -14,7 +14,10 @@
 #include <JuceHeader.h>
 #include "Marker.h"
 
+#include <algorithm>
 #include <functional>  // 确保引入 functional 头文件以使用 std::function
+#include <limits>
+#include <vector>
 
 class MarkerSlider : public juce::Slider
 {
@@ -24,88 +27,280 @@ public:
         setInterceptsMouseClicks(true, true);
     }
 
-    // 添加一个标记
-    void addMarker(double position)
+    // 添加一个标记（按时间顺序插入）
+    void addMarker(double position) { addMarker(Marker(position)); }
+
+    // 添加一个带翻页动作和目标页的标记
+    void addMarker(const Marker& marker)
+    {
+        const auto insertAt = std::upper_bound(markers.begin(), markers.end(), marker.position,
+                                               [](double value, const Marker& existing) { return value < existing.position; });
+        markers.insert(insertAt, marker);
+        invalidateMarkerLayer();  // 添加标记后重绘
+    }
+
+    // 修改标记的翻页动作和目标页（-1 表示按顺序的下一页）
+    void setMarkerAction(int index, MarkerAction action, int targetPage)
     {
-        markers.emplace_back(position);
-        repaint();  // 添加标记后重绘
+        if (index < 0 || index >= static_cast<int>(markers.size()))
+            return;
+
+        auto& marker = markers[static_cast<size_t>(index)];
+        marker.action = action;
+        marker.targetPage = targetPage;
+        invalidateMarkerLayer();
+
+        if (onMarkersChanged)
+            onMarkersChanged();
     }
 
     // 清除所有标记
     void clearMarkers()
     {
         markers.clear();
-        repaint();  // 清除标记后重绘
+        invalidateMarkerLayer();  // 清除标记后重绘
     }
 
-    // 获取所有标记
+    // 获取所有标记（按时间排好序）
     const std::vector<Marker>& getMarkers() const { return markers; }
 
+    // 播放位置之前的标记显示为已触发；循环回到 A 点后，区间里的标记重新变为未触发
+    void updateTriggeredMarkers(double position)
+    {
+        bool changed = false;
+
+        for (auto& marker : markers)
+        {
+            const bool triggered = marker.position <= position;
+            changed = changed || marker.isTriggered != triggered;
+            marker.isTriggered = triggered;
+        }
+
+        if (changed)
+            invalidateMarkerLayer();
+    }
+
+    // 节拍检测得到的小节线，只用来显示
+    void setBarPositions(std::vector<double> positions)
+    {
+        barPositions = std::move(positions);
+        invalidateMarkerLayer();
+    }
+
     // 标记拖动后的回调
     std::function<void()> onMarkersChanged;  // 声明 onMarkersChanged 回调
+
+    // 拖动标记时的吸附：传入鼠标对应的时间和容差（秒），返回吸附后的时间。按住 Alt 拖动时不吸附
+    std::function<double(double position, double tolerance)> snapMarkerPosition;
+    // 右键点中标记时的回调，参数是标记索引
+    std::function<void(int markerIndex)> onMarkerMenuRequested;
     // 获取最近被拖动的标记索引
     int getLastDraggedMarkerIndex() const { return lastDraggedMarkerIndex; }
 
 protected:
-    std::vector<Marker> markers;      // 存储所有标记
+    std::vector<Marker> markers;      // 存储所有标记，始终按时间排序
     int draggingMarkerIndex = -1;     // 当前正在拖动的标记索引
     int lastDraggedMarkerIndex = -1;  // 记录最近被拖动的标记索引
+    std::vector<double> barPositions; // 小节线（秒）
 
+    // 除正在拖动的标记以外的所有标记和小节线画在一张缓存图像上；
+    // 拖动时只重绘被拖动的标记前后所在的一小条
+    juce::Image markerLayer;
+    bool markerLayerValid = false;
+    double markerLayerMinimum = 0.0, markerLayerMaximum = 0.0;
+
+    static constexpr float snapTolerancePixels = 8.0f;  // 鼠标附近多少像素内的起音会被吸附
+    static constexpr double maximumSnapSeconds = 0.5;   // 长文件缩得很小时也不要吸附得太远
+    static constexpr float hitTolerancePixels = 5.0f;   // 点击离标记多远以内算点中
+    static constexpr float lineThickness = 2.0f;        // 线条粗细，可以根据需要调整
+
+    void invalidateMarkerLayer()
+    {
+        markerLayerValid = false;
+        repaint();
+    }
+
+    float getXForPosition(double position) const
+    {
+        double sliderProportion = (position - getMinimum()) / (getMaximum() - getMinimum());
+        sliderProportion = juce::jlimit(0.0, 1.0, sliderProportion);
+        return static_cast<float>(sliderProportion * getWidth());
+    }
+
+    double getPositionForX(float x) const
+    {
+        const double proportion = juce::jlimit(0.0, 1.0, static_cast<double>(x) / std::max(1, getWidth()));
+        return proportion * (getMaximum() - getMinimum()) + getMinimum();
+    }
+
+    // 按时间排好序的数组里 [startTime, endTime] 之间的位置，落在同一个像素上的只回调第一个
+    template <typename Iterator, typename PositionOf, typename Callback>
+    void forEachVisiblePixel(Iterator first, Iterator last, double startTime, double endTime,
+                             PositionOf positionOf, Callback callback) const
+    {
+        auto it = std::lower_bound(first, last, startTime,
+                                   [&](const auto& item, double time) { return positionOf(item) < time; });
+        int previousX = std::numeric_limits<int>::min();
+
+        while (it != last && positionOf(*it) <= endTime)
+        {
+            const int x = static_cast<int>(getXForPosition(positionOf(*it)));
+
+            if (x == previousX)
+            {
+                // 和上一个标记在同一个像素：直接跳到下一个像素对应的时间
+                const auto next = std::lower_bound(it, last, getPositionForX(static_cast<float>(x + 1)),
+                                                   [&](const auto& item, double time) { return positionOf(item) < time; });
+                it = next == it ? it + 1 : next;
+                continue;
+            }
+
+            callback(*it, x);
+            previousX = x;
+            ++it;
+        }
+    }
+
+    static juce::Colour getMarkerColour(const Marker& marker)
+    {
+        // 根据标记状态设置颜色
+        if (marker.isTriggered)
+            return juce::Colours::green;
+        if (marker.isDragging)
+            return juce::Colours::orange;
+        // 跳页、半页翻和保持用不同的颜色区分
+        if (marker.action == MarkerAction::hold)
+            return juce::Colours::grey;
+        if (marker.action == MarkerAction::halfTurn)
+            return juce::Colours::mediumpurple;
+        if (marker.targetPage >= 0)
+            return juce::Colours::deepskyblue;
+        return juce::Colours::red;
+    }
+
+    void rebuildMarkerLayer()
+    {
+        markerLayerValid = true;
+        markerLayerMinimum = getMinimum();
+        markerLayerMaximum = getMaximum();
+
+        if (getWidth() <= 0 || getHeight() <= 0 || getMaximum() <= getMinimum())
+        {
+            markerLayer = juce::Image();
+            return;
+        }
+
+        markerLayer = juce::Image(juce::Image::ARGB, getWidth(), getHeight(), true);
+        juce::Graphics g(markerLayer);
+
+        // 小节线画在标记下面：浅灰色的短线
+        g.setColour(juce::Colours::lightgrey.withAlpha(0.6f));
+        const float barTop = getHeight() * 0.65f;
+        forEachVisiblePixel(barPositions.begin(), barPositions.end(), getMinimum(), getMaximum(),
+                            [](double position) { return position; },
+                            [&](double, int x) { g.drawVerticalLine(x, barTop, static_cast<float>(getHeight())); });
+
+        // 正在拖动的标记单独画在最上面
+        forEachVisiblePixel(markers.begin(), markers.end(), getMinimum(), getMaximum(),
+                            [](const Marker& marker) { return marker.position; },
+                            [&](const Marker& marker, int x)
+                            {
+                                if (marker.isDragging)
+                                    return;
+
+                                g.setColour(getMarkerColour(marker));
+                                g.drawLine(static_cast<float>(x), 0.0f, static_cast<float>(x), static_cast<float>(getHeight()), lineThickness);
+                            });
+    }
+
+    // 重绘某个标记所在的一小条
+    void repaintMarkerStrip(float x)
+    {
+        const int margin = static_cast<int>(std::ceil(lineThickness)) + 1;
+        repaint(static_cast<int>(x) - margin, 0, margin * 2 + 1, getHeight());
+    }
+
+    void resized() override
+    {
+        juce::Slider::resized();
+        markerLayerValid = false;
+    }
 
-    // 绘制标记
     // 绘制标记
     void paint(juce::Graphics& g) override
     {
         juce::Slider::paint(g);  // 先绘制滑块本身
 
-        for (const auto& marker : markers)
+        // 尺寸或范围变了才重新生成缓存图像
+        if (!markerLayerValid || markerLayerMinimum != getMinimum() || markerLayerMaximum != getMaximum()
+            || (markerLayer.isValid() && (markerLayer.getWidth() != getWidth() || markerLayer.getHeight() != getHeight())))
+            rebuildMarkerLayer();
+
+        if (markerLayer.isValid())
+            g.drawImageAt(markerLayer, 0, 0);
+
+        if (draggingMarkerIndex >= 0 && draggingMarkerIndex < static_cast<int>(markers.size()))
         {
-            double sliderRangeStart = getMinimum();
-            double sliderRangeEnd = getMaximum();
-            double sliderProportion = (marker.position - sliderRangeStart) / (sliderRangeEnd - sliderRangeStart);
-            sliderProportion = juce::jlimit(0.0, 1.0, sliderProportion);
-            int x = static_cast<int>(sliderProportion * getWidth());
-            
-            // 定义线条的起始和结束位置
-            int lineYStart = 0;  // 线条的起点（顶部）
-            int lineYEnd = getHeight();  // 线条的终点（底部）
-            
-            // 根据标记状态设置颜色
-            if (marker.isTriggered)
-                g.setColour(juce::Colours::green);
-            else if (marker.isDragging)
-                g.setColour(juce::Colours::orange);
-            else
-                g.setColour(juce::Colours::red);
-
-            // 绘制线条
-            float lineThickness = 2.0f; // 线条粗细，可以根据需要调整
-            g.drawLine((float)x, (float)lineYStart, (float)x, (float)lineYEnd, lineThickness);
+            const Marker& marker = markers[static_cast<size_t>(draggingMarkerIndex)];
+            const float x = static_cast<float>(static_cast<int>(getXForPosition(marker.position)));
+            g.setColour(getMarkerColour(marker));
+            g.drawLine(x, 0.0f, x, static_cast<float>(getHeight()), lineThickness);
         }
     }
 
+    // 离 x 最近的标记（二分查找），超出容差时返回 -1
+    int findMarkerNear(float x) const
+    {
+        if (markers.empty() || getMaximum() <= getMinimum())
+            return -1;
+
+        const double time = getPositionForX(x);
+        const auto after = std::lower_bound(markers.begin(), markers.end(), time,
+                                            [](const Marker& marker, double value) { return marker.position < value; });
+        int nearest = -1;
+        float nearestDistance = hitTolerancePixels;
+
+        // 最近的标记只可能是 time 两边相邻的两个
+        if (after != markers.end())
+        {
+            const float distance = std::abs(getXForPosition(after->position) - x);
+            if (distance <= nearestDistance)
+            {
+                nearest = static_cast<int>(after - markers.begin());
+                nearestDistance = distance;
+            }
+        }
+
+        if (after != markers.begin())
+        {
+            const float distance = std::abs(getXForPosition((after - 1)->position) - x);
+            if (distance < nearestDistance || (nearest < 0 && distance <= nearestDistance))
+                nearest = static_cast<int>(after - markers.begin()) - 1;
+        }
+
+        return nearest;
+    }
 
     // 处理鼠标点击
     void mouseDown(const juce::MouseEvent& event) override
     {
-        for (size_t i = 0; i < markers.size(); ++i)
+        const float y = static_cast<float>(getHeight() / 2.0);
+        const int index = event.position.y >= y - 10.0f && event.position.y <= y + 5.0f ? findMarkerNear(event.position.x) : -1;
+
+        if (index >= 0 && event.mods.isPopupMenu())
         {
-            const Marker& marker = markers[i];
-            double sliderRangeStart = getMinimum();
-            double sliderRangeEnd = getMaximum();
-            double sliderProportion = (marker.position - sliderRangeStart) / (sliderRangeEnd - sliderRangeStart);
-            sliderProportion = juce::jlimit(0.0, 1.0, sliderProportion);
-            float x = static_cast<float>(sliderProportion * getWidth());
-            float y = static_cast<float>(getHeight() / 2.0);
-
-            juce::Rectangle<float> markerArea(x - 5.0f, y - 10.0f, 10.0f, 15.0f);
-            if (markerArea.contains(event.position))
-            {
-                draggingMarkerIndex = static_cast<int>(i);
-                lastDraggedMarkerIndex = draggingMarkerIndex;  // 记录被拖动的标记索引
-                markers[i].isDragging = true;
-                return;
-                }
+            if (onMarkerMenuRequested)
+                onMarkerMenuRequested(index);
+            return;
+        }
+
+        if (index >= 0)
+        {
+            draggingMarkerIndex = index;
+            lastDraggedMarkerIndex = draggingMarkerIndex;  // 记录被拖动的标记索引
+            markers[static_cast<size_t>(index)].isDragging = true;
+            invalidateMarkerLayer();  // 被拖动的标记从缓存图像里拿出来
+            return;
         }
         juce::Slider::mouseDown(event);
     }
@@ -115,12 +310,24 @@ protected:
     {
         if (draggingMarkerIndex >= 0 && draggingMarkerIndex < static_cast<int>(markers.size()))
         {
-            double proportion = static_cast<double>(event.position.x) / getWidth();
-            proportion = juce::jlimit(0.0, 1.0, proportion);
-            double newMarkerTime = proportion * (getMaximum() - getMinimum()) + getMinimum();
+            double newMarkerTime = getPositionForX(event.position.x);
+
+            // 吸附到附近的起音，让标记落在音符开始的地方
+            if (snapMarkerPosition && !event.mods.isAltDown() && getWidth() > 0)
+            {
+                const double secondsPerPixel = (getMaximum() - getMinimum()) / getWidth();
+                const double tolerance = std::min(maximumSnapSeconds, snapTolerancePixels * secondsPerPixel);
+                newMarkerTime = snapMarkerPosition(newMarkerTime, tolerance);
+            }
+
+            // 位置没变（例如一直吸附在同一个起音上）时不需要重建时间线
+            if (newMarkerTime == markers[static_cast<size_t>(draggingMarkerIndex)].position)
+                return;
 
-            markers[draggingMarkerIndex].position = newMarkerTime;
-            repaint();
+            const float oldX = getXForPosition(markers[static_cast<size_t>(draggingMarkerIndex)].position);
+            moveDraggedMarker(newMarkerTime);
+            repaintMarkerStrip(oldX);
+            repaintMarkerStrip(getXForPosition(newMarkerTime));
 
             // 如果设置了 onMarkersChanged 回调，调用它
             if (onMarkersChanged)
@@ -132,13 +339,35 @@ protected:
         }
     }
 
+    // 保持按时间排序：拖过相邻的标记时和它交换位置
+    void moveDraggedMarker(double newPosition)
+    {
+        size_t index = static_cast<size_t>(draggingMarkerIndex);
+        markers[index].position = newPosition;
+
+        while (index > 0 && markers[index - 1].position > newPosition)
+        {
+            std::swap(markers[index - 1], markers[index]);
+            --index;
+        }
+
+        while (index + 1 < markers.size() && markers[index + 1].position < newPosition)
+        {
+            std::swap(markers[index + 1], markers[index]);
+            ++index;
+        }
+
+        draggingMarkerIndex = lastDraggedMarkerIndex = static_cast<int>(index);
+    }
+
     // 处理鼠标松开
     void mouseUp(const juce::MouseEvent& event) override
     {
         if (draggingMarkerIndex >= 0 && draggingMarkerIndex < static_cast<int>(markers.size()))
         {
-            markers[draggingMarkerIndex].isDragging = false;
+            markers[static_cast<size_t>(draggingMarkerIndex)].isDragging = false;
             draggingMarkerIndex = -1;
+            invalidateMarkerLayer();  // 标记放回缓存图像
         }
         juce::Slider::mouseUp(event);
     }
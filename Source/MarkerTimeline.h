@@ -0,0 +1,172 @@
+/*
+  ==============================================================================
+
+    MarkerTimeline.h
+    Created: 19 Oct 2026 3:02:44pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+// MarkerTimeline.h
+
+#include <JuceHeader.h>
+#include "Marker.h"
+
+#include <algorithm>
+#include <vector>
+
+// 某一时刻屏幕上应该显示的内容：一整页，或者半页翻时上下两半分别来自两页
+struct PageView
+{
+    int page = 0;      // 整页显示的页（半页翻时显示在下半部分）
+    int topPage = -1;  // 半页翻时上半部分已经换成的页，-1 表示整页
+
+    bool isHalfTurn() const { return topPage >= 0; }
+    int getLeadingPage() const { return isHalfTurn() ? topPage : page; }  // 正在往前读的那一页
+    bool operator==(const PageView& other) const { return page == other.page && topPage == other.topPage; }
+    bool operator!=(const PageView& other) const { return !(*this == other); }
+};
+
+// 标记时间线：把任意音频位置映射到应该显示的页面。
+// 每个标记带一个动作（翻页、半页翻、保持）和可选的目标页，重建时按时间顺序把它们解析成
+// “从这个时间开始显示什么”的表，之后任何位置（包括 seek 之后）都用二分查找 O(log n) 得到页面。
+class MarkerTimeline
+{
+public:
+    // 根据标记重新建立时间线（标记可以是任意顺序）
+    void rebuild(const std::vector<Marker>& markers, int numPages)
+    {
+        entries.clear();
+        entries.reserve(markers.size());
+        totalNumPages = numPages;
+
+        if (totalNumPages <= 0)
+            return;
+
+        std::vector<const Marker*> sorted;
+        sorted.reserve(markers.size());
+        for (const auto& marker : markers)
+            sorted.push_back(&marker);
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Marker* a, const Marker* b) { return a->position < b->position; });
+
+        PageView view;
+        for (const auto* marker : sorted)
+        {
+            view = resolve(view, *marker);
+            entries.push_back({ marker->position, view });
+        }
+    }
+
+    // 获取某个音频位置（秒）应该显示的页面
+    PageView getViewForPosition(double position) const
+    {
+        const auto after = std::upper_bound(entries.begin(), entries.end(), position,
+                                            [](double time, const Entry& entry) { return time < entry.time; });
+        return after == entries.begin() ? PageView() : (after - 1)->view;
+    }
+
+    // 当前视图从哪个时间（秒）开始生效；还没到第一个换页点时返回负数
+    double getChangeTimeForPosition(double position) const
+    {
+        const auto after = std::upper_bound(entries.begin(), entries.end(), position,
+                                            [](double time, const Entry& entry) { return time < entry.time; });
+        return after == entries.begin() ? -1.0 : (after - 1)->time;
+    }
+
+    // 这个位置之后下一次换页的时间（秒）；后面没有换页点时返回负数
+    double getNextChangeTime(double position) const
+    {
+        const auto after = std::upper_bound(entries.begin(), entries.end(), position,
+                                            [](double time, const Entry& entry) { return time < entry.time; });
+        return after == entries.end() ? -1.0 : after->time;
+    }
+
+    // 获取某个音频位置（秒）对应的页码（半页翻时是正在往前读的那一页）
+    int getPageForPosition(double position) const
+    {
+        if (totalNumPages <= 0)
+            return 0;
+
+        return getViewForPosition(position).getLeadingPage();
+    }
+
+    // 从某个位置往后，按演奏顺序接下来会出现的页（不含这个位置已经显示的页），最多 maxPages 个。
+    // 预渲染和下一页预览用它，而不是简单的页码 + 1
+    std::vector<int> getUpcomingPages(double position, int maxPages) const
+    {
+        std::vector<int> pages;
+        const auto current = getViewForPosition(position);
+        auto isKnown = [&](int page)
+        {
+            return page == current.page || page == current.topPage || std::find(pages.begin(), pages.end(), page) != pages.end();
+        };
+
+        auto it = std::upper_bound(entries.begin(), entries.end(), position,
+                                   [](double time, const Entry& entry) { return time < entry.time; });
+
+        for (; it != entries.end() && static_cast<int>(pages.size()) < maxPages; ++it)
+            for (int page : { it->view.topPage, it->view.page })
+                if (page >= 0 && !isKnown(page) && static_cast<int>(pages.size()) < maxPages)
+                    pages.push_back(page);
+
+        return pages;
+    }
+
+    bool isEmpty() const { return entries.empty(); }
+
+    // 每小节的起点（秒），由节拍检测得到；和翻页用的标记分开保存
+    void setBars(std::vector<double> newBarTimes)
+    {
+        barTimes = std::move(newBarTimes);
+        std::sort(barTimes.begin(), barTimes.end());
+    }
+
+    const std::vector<double>& getBarTimes() const { return barTimes; }
+    int getNumBars() const { return static_cast<int>(barTimes.size()); }
+    double getBarTime(int bar) const { return barTimes[static_cast<size_t>(bar)]; }
+
+    // 某个位置所在的小节（从 0 开始），在第一小节之前返回 -1
+    int getBarForPosition(double position) const
+    {
+        return static_cast<int>(std::upper_bound(barTimes.begin(), barTimes.end(), position) - barTimes.begin()) - 1;
+    }
+
+private:
+    struct Entry
+    {
+        double time;
+        PageView view;
+    };
+
+    // 经过一个标记之后显示什么
+    PageView resolve(const PageView& view, const Marker& marker) const
+    {
+        auto targetOr = [&](int sequentialPage) { return juce::jlimit(0, totalNumPages - 1, marker.targetPage >= 0 ? marker.targetPage : sequentialPage); };
+
+        switch (marker.action)
+        {
+            case MarkerAction::hold:
+                return view;
+
+            case MarkerAction::halfTurn:
+            {
+                // 下半部分换成正在读的那一页，上半部分换成它的下一页
+                const int lower = view.getLeadingPage();
+                const int upper = targetOr(lower + 1);
+                return upper == lower ? PageView { lower, -1 } : PageView { lower, upper };
+            }
+
+            case MarkerAction::turn:
+            default:
+                // 半页翻之后的整页翻页只是把上半部分那一页翻完整
+                return PageView { targetOr(view.isHalfTurn() ? view.topPage : view.page + 1), -1 };
+        }
+    }
+
+    std::vector<Entry> entries;  // 按时间排好序：从 time 开始显示 view
+    std::vector<double> barTimes;     // 排好序的小节起点（秒）
+    int totalNumPages = 0;
+};
@@ -0,0 +1,149 @@
+/*
+  ==============================================================================
+
+    MemoryAccountant.cpp
+    Created: 23 Oct 2026 4:47:18pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "MemoryAccountant.h"
+
+#include <algorithm>
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+#endif
+
+int MemoryAccountant::addSubsystem(const juce::String& name, UsageFunction getUsage, ShrinkFunction shrink, RestoreFunction restore)
+{
+    Subsystem subsystem;
+    subsystem.id = nextId++;
+    subsystem.name = name;
+    subsystem.getUsage = std::move(getUsage);
+    subsystem.shrink = std::move(shrink);
+    subsystem.restore = std::move(restore);
+    subsystem.lastGrowthTime = juce::Time::getMillisecondCounterHiRes();
+    subsystems.push_back(std::move(subsystem));
+    return subsystems.back().id;
+}
+
+void MemoryAccountant::removeSubsystem(int id)
+{
+    subsystems.erase(std::remove_if(subsystems.begin(), subsystems.end(),
+                                    [id](const Subsystem& subsystem) { return subsystem.id == id; }),
+                     subsystems.end());
+}
+
+void MemoryAccountant::update()
+{
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    totalBytes = 0;
+
+    for (auto& subsystem : subsystems)
+    {
+        const size_t bytes = subsystem.getUsage();
+        if (bytes > subsystem.currentBytes)
+            subsystem.lastGrowthTime = now;
+
+        subsystem.currentBytes = bytes;
+        subsystem.peakBytes = std::max(subsystem.peakBytes, bytes);
+        totalBytes += bytes;
+    }
+
+    peakTotalBytes = std::max(peakTotalBytes, totalBytes);
+
+    if (totalBytes > budget)
+    {
+        enforceBudget(now);
+    }
+    else if (static_cast<double>(totalBytes) < static_cast<double>(budget) * restoreFraction)
+    {
+        for (auto& subsystem : subsystems)
+        {
+            if (subsystem.shrunk && subsystem.restore)
+                subsystem.restore();
+
+            subsystem.shrunk = false;
+        }
+    }
+}
+
+void MemoryAccountant::enforceBudget(double now)
+{
+    // 大小乘上冷的程度：同样大小先收缩久没增长的，同样冷先收缩大的
+    auto getScore = [now](const Subsystem& subsystem)
+    {
+        return static_cast<double>(subsystem.currentBytes) * (1.0 + (now - subsystem.lastGrowthTime) / 1000.0 / coldSeconds);
+    };
+
+    std::vector<Subsystem*> order;
+    for (auto& subsystem : subsystems)
+        if (subsystem.shrink && subsystem.currentBytes > 0)
+            order.push_back(&subsystem);
+
+    std::sort(order.begin(), order.end(), [&getScore](const Subsystem* a, const Subsystem* b) { return getScore(*a) > getScore(*b); });
+
+    for (auto* subsystem : order)
+    {
+        if (totalBytes <= budget)
+            break;
+
+        const size_t requested = totalBytes - budget;
+        const size_t freed = std::min(subsystem->shrink(requested), subsystem->currentBytes);
+        subsystem->shrunk = true;
+
+        DBG("Memory over budget by " + juce::String(static_cast<juce::int64>(requested / 1024)) + " KB, "
+            + subsystem->name + " freed " + juce::String(static_cast<juce::int64>(freed / 1024)) + " KB");
+
+        subsystem->currentBytes -= freed;
+        totalBytes -= freed;
+    }
+
+    if (totalBytes > budget)
+        DBG("Memory still over budget after shrinking: " + juce::String(static_cast<juce::int64>(totalBytes / (1024 * 1024))) + " MB");
+}
+
+std::vector<MemoryAccountant::SubsystemReport> MemoryAccountant::getReport() const
+{
+    std::vector<SubsystemReport> report;
+    report.reserve(subsystems.size());
+
+    for (const auto& subsystem : subsystems)
+        report.push_back({ subsystem.name, subsystem.currentBytes, subsystem.peakBytes, static_cast<bool>(subsystem.shrink) });
+
+    return report;
+}
+
+size_t MemoryAccountant::getResidentBytes()
+{
+   #if JUCE_LINUX
+    // 第二个字段是驻留的页数
+    const auto fields = juce::StringArray::fromTokens(juce::File("/proc/self/statm").loadFileAsString(), false);
+    if (fields.size() < 2)
+        return 0;
+
+    return static_cast<size_t>(fields[1].getLargeIntValue()) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+   #elif JUCE_MAC
+    mach_task_basic_info_data_t info {};
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS)
+        return 0;
+
+    return static_cast<size_t>(info.resident_size);
+   #elif JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters {};
+    if (!K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return 0;
+
+    return static_cast<size_t>(counters.WorkingSetSize);
+   #else
+    return 0;
+   #endif
+}
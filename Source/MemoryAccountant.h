@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    MemoryAccountant.h
+    Created: 23 Oct 2026 4:47:18pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <functional>
+#include <vector>
+
+// 内存账本：每个缓存或缓冲登记一个查询用量的函数（可选再给一个收缩函数），
+// 定期 update() 时记录每个子系统的当前和峰值字节数。所有子系统的总量超过全局预算时，
+// 按“大而且久没增长”的顺序请能收缩的子系统释放内存，直到回到预算以内；
+// 总量回落到预算的 restoreFraction 以下时，再让收缩过的子系统恢复原来的上限。
+// Poppler、字体等没法单独统计的部分只能从进程驻留内存里减出来看。所有方法都在消息线程调用。
+class MemoryAccountant
+{
+public:
+    using UsageFunction = std::function<size_t()>;
+    using ShrinkFunction = std::function<size_t(size_t bytesToFree)>;  // 返回实际释放的字节数
+    using RestoreFunction = std::function<void()>;
+
+    // 返回的 id 用于注销；shrink 为空表示只统计、不能收缩；
+    // restore 为空表示收缩只是丢掉当前内容，之后不需要恢复什么
+    int addSubsystem(const juce::String& name, UsageFunction getUsage, ShrinkFunction shrink = {}, RestoreFunction restore = {});
+    void removeSubsystem(int id);
+
+    void setBudget(size_t numBytes) { budget = numBytes; }
+    size_t getBudget() const { return budget; }
+
+    // 刷新用量和峰值，超出预算时收缩
+    void update();
+
+    struct SubsystemReport
+    {
+        juce::String name;
+        size_t currentBytes = 0, peakBytes = 0;
+        bool canShrink = false;
+    };
+
+    std::vector<SubsystemReport> getReport() const;
+    size_t getTotalBytes() const { return totalBytes; }
+    size_t getPeakTotalBytes() const { return peakTotalBytes; }
+
+    // 整个进程的驻留内存，平台不支持时返回 0
+    static size_t getResidentBytes();
+
+    static constexpr size_t defaultBudget = static_cast<size_t>(768) * 1024 * 1024;
+
+private:
+    struct Subsystem
+    {
+        int id = 0;
+        juce::String name;
+        UsageFunction getUsage;
+        ShrinkFunction shrink;
+        RestoreFunction restore;
+        bool shrunk = false;  // 收缩过、还没恢复
+        size_t currentBytes = 0, peakBytes = 0;
+        double lastGrowthTime = 0.0;  // 用量上一次增长的时间（毫秒），越早越“冷”
+    };
+
+    void enforceBudget(double now);
+
+    std::vector<Subsystem> subsystems;
+    int nextId = 1;
+    size_t budget = defaultBudget;
+    size_t totalBytes = 0, peakTotalBytes = 0;
+
+    // 冷了这么久（秒）的子系统，收缩优先级相当于大一倍
+    static constexpr double coldSeconds = 30.0;
+
+    // 留一段余量再恢复，避免恢复后马上又超出预算
+    static constexpr double restoreFraction = 0.75;
+};
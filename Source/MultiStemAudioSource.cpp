@@ -0,0 +1,193 @@
+/*
+  ==============================================================================
+
+    MultiStemAudioSource.cpp
+    Created: 20 Oct 2026 6:18:46pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "MultiStemAudioSource.h"
+
+MultiStemAudioSource::MultiStemAudioSource(std::vector<std::unique_ptr<juce::AudioFormatReader>> readers,
+                                           const juce::Array<juce::File>& stemFiles,
+                                           juce::TimeSliceThread& readAheadThread)
+{
+    for (size_t i = 0; i < readers.size() && stems.size() < static_cast<size_t>(maxStems); ++i)
+    {
+        auto& reader = readers[i];
+        if (reader == nullptr)
+            continue;
+
+        // 以第一轨的采样率为准
+        if (sourceSampleRate == 0.0)
+            sourceSampleRate = reader->sampleRate;
+
+        if (reader->sampleRate != sourceSampleRate)
+        {
+            DBG("Stem sample rate does not match, skipping: " + stemFiles[static_cast<int>(i)].getFileName());
+            continue;
+        }
+
+        totalLength = std::max(totalLength, reader->lengthInSamples);
+
+        const int bufferSize = juce::roundToInt(readAheadSeconds * reader->sampleRate);
+        auto stem = std::make_unique<Stem>();
+        stem->file = stemFiles[static_cast<int>(i)];
+        stem->name = stem->file.getFileNameWithoutExtension();
+        stem->bufferedSource = std::make_unique<juce::BufferingAudioSource>(new juce::AudioFormatReaderSource(reader.release(), true),
+                                                                            readAheadThread, true, bufferSize, numChannels);
+        stems.push_back(std::move(stem));
+    }
+
+    stemTicks.resize(stems.size());
+}
+
+MultiStemAudioSource::~MultiStemAudioSource()
+{
+    releaseResources();
+}
+
+size_t MultiStemAudioSource::getBufferBytes() const
+{
+    const auto readAheadSamples = static_cast<size_t>(juce::roundToInt(readAheadSeconds * sourceSampleRate));
+    return stems.size() * readAheadSamples * numChannels * sizeof(float)
+         + static_cast<size_t>(stemBuffer.getNumChannels()) * static_cast<size_t>(stemBuffer.getNumSamples()) * sizeof(float);
+}
+
+void MultiStemAudioSource::setStemGain(int index, float newGain)
+{
+    if (juce::isPositiveAndBelow(index, getNumStems()))
+        stems[static_cast<size_t>(index)]->gain = std::max(0.0f, newGain);
+}
+
+void MultiStemAudioSource::setStemMuted(int index, bool shouldBeMuted)
+{
+    if (juce::isPositiveAndBelow(index, getNumStems()))
+        stems[static_cast<size_t>(index)]->muted = shouldBeMuted;
+}
+
+void MultiStemAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    // 上游（变速）一次可能要比设备块更多的样本，混音按这个大小分段进行
+    stemBuffer.setSize(numChannels, std::max(samplesPerBlockExpected, 4096));
+
+    for (auto& stem : stems)
+    {
+        stem->bufferedSource->setNextReadPosition(position.load());
+        stem->bufferedSource->prepareToPlay(samplesPerBlockExpected, sampleRate);
+    }
+}
+
+void MultiStemAudioSource::releaseResources()
+{
+    for (auto& stem : stems)
+        stem->bufferedSource->releaseResources();
+}
+
+void MultiStemAudioSource::setNextReadPosition(juce::int64 newPosition)
+{
+    position = newPosition;
+
+    for (auto& stem : stems)
+        stem->bufferedSource->setNextReadPosition(newPosition);
+}
+
+void MultiStemAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    bufferToFill.clearActiveBufferRegion();
+
+    if (stems.empty() || stemBuffer.getNumSamples() == 0)
+        return;
+
+    std::fill(stemTicks.begin(), stemTicks.end(), 0);
+
+    for (int offset = 0; offset < bufferToFill.numSamples; offset += stemBuffer.getNumSamples())
+        mixChunk(bufferToFill, offset, std::min(stemBuffer.getNumSamples(), bufferToFill.numSamples - offset), stemTicks);
+
+    position += bufferToFill.numSamples;
+
+    // 把每轨的耗时换算成占这段音频时长的比例
+    const double blockTicks = static_cast<double>(bufferToFill.numSamples) / sourceSampleRate
+                              * static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+    float sum = 0.0f;
+
+    for (size_t i = 0; i < stems.size(); ++i)
+    {
+        const float blockLoad = static_cast<float>(static_cast<double>(stemTicks[i]) / blockTicks);
+        const float smoothed = stems[i]->load.load() + loadSmoothing * (blockLoad - stems[i]->load.load());
+        stems[i]->load = smoothed;
+        sum += smoothed;
+    }
+
+    totalLoad = sum;
+}
+
+void MultiStemAudioSource::mixChunk(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, std::vector<juce::int64>& ticks)
+{
+    juce::AudioBuffer<float> stemView(stemBuffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+    for (size_t i = 0; i < stems.size(); ++i)
+    {
+        auto& stem = *stems[i];
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        // 静音的轨也要读，保持预读缓冲和其他轨同步
+        const juce::AudioSourceChannelInfo stemInfo(&stemView, 0, numSamples);
+        if (waitForReadAhead.load() && !stem.bufferedSource->waitForNextAudioBlockReady(stemInfo, readAheadTimeoutMs))
+            readAheadMisses.fetch_add(1, std::memory_order_relaxed);
+
+        stem.bufferedSource->getNextAudioBlock(stemInfo);
+        addStem(stem, stemView, 0, *bufferToFill.buffer, bufferToFill.startSample + offset, numSamples);
+
+        ticks[i] += juce::Time::getHighResolutionTicks() - startTicks;
+    }
+}
+
+bool MultiStemAudioSource::waitUntilReadAheadReady(int numSamples, juce::uint32 timeoutMs)
+{
+    // 只用到 numSamples，不需要真正的缓冲
+    juce::AudioSourceChannelInfo info;
+    info.numSamples = numSamples;
+
+    bool ready = true;
+    for (auto& stem : stems)
+        ready = stem->bufferedSource->waitForNextAudioBlockReady(info, timeoutMs) && ready;
+
+    return ready;
+}
+
+void MultiStemAudioSource::mixFromMemory(const std::vector<juce::AudioBuffer<float>>& stemAudio, int sourceOffset,
+                                         const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    bufferToFill.clearActiveBufferRegion();
+
+    for (size_t i = 0; i < stems.size() && i < stemAudio.size(); ++i)
+        addStem(*stems[i], stemAudio[i], sourceOffset, *bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void MultiStemAudioSource::addStem(Stem& stem, const juce::AudioBuffer<float>& source, int sourceStart,
+                                   juce::AudioBuffer<float>& destination, int destStart, int numSamples)
+{
+    const int numOutputChannels = std::min(destination.getNumChannels(), numChannels);
+    const int numSourceChannels = source.getNumChannels();
+    const float targetGain = stem.muted.load() ? 0.0f : stem.gain.load();
+
+    if (numSourceChannels == 0)
+        return;
+
+    for (int channel = 0; channel < numOutputChannels; ++channel)
+    {
+        // 单声道的分轨同时送到左右声道
+        const float* sourceData = source.getReadPointer(std::min(channel, numSourceChannels - 1), sourceStart);
+
+        // 增益变化时在这一段里线性过渡，避免咔嗒声
+        if (targetGain != stem.appliedGain)
+            destination.addFromWithRamp(channel, destStart, sourceData, numSamples, stem.appliedGain, targetGain);
+        else if (targetGain > 0.0f)
+            juce::FloatVectorOperations::addWithMultiply(destination.getWritePointer(channel, destStart), sourceData, targetGain, numSamples);
+    }
+
+    stem.appliedGain = targetGain;
+}
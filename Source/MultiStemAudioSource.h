@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    MultiStemAudioSource.h
+    Created: 20 Oct 2026 6:18:46pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 多轨播放：伴奏、节拍器、导唱等分成几个文件同步播放，每轨可以单独调音量和静音。
+// 每一轨都有自己的预读缓冲（BufferingAudioSource，由共享的后台线程填充），
+// 音频线程从预读缓冲取数据，再用 FloatVectorOperations 的乘加内核混到输出里，不分配内存。
+// 注意 BufferingAudioSource 取数据和 seek 时会短暂加锁，seek 还会丢掉已经预读的数据，
+// 所以 A/B 循环区间另外整段读进内存（mixFromMemory），回绕时不 seek 各轨。
+// 每轨读取+混音的耗时会被测量，换算成占一个回调时长的比例。
+class MultiStemAudioSource : public juce::PositionableAudioSource
+{
+public:
+    // 所有分轨的采样率必须相同（不同的会被忽略），总长度取最长的一轨
+    // readers 和 stemFiles 一一对应，轨名取文件名
+    MultiStemAudioSource(std::vector<std::unique_ptr<juce::AudioFormatReader>> readers,
+                         const juce::Array<juce::File>& stemFiles,
+                         juce::TimeSliceThread& readAheadThread);
+    ~MultiStemAudioSource() override;
+
+    int getNumStems() const { return static_cast<int>(stems.size()); }
+    juce::String getStemName(int index) const { return stems[static_cast<size_t>(index)]->name; }
+    juce::File getStemFile(int index) const { return stems[static_cast<size_t>(index)]->file; }
+    double getSampleRate() const { return sourceSampleRate; }
+
+    // 各轨预读缓冲和混音缓冲占用的字节数（近似）
+    size_t getBufferBytes() const;
+
+    // 以下可以在任意线程调用
+    void setStemGain(int index, float newGain);
+    float getStemGain(int index) const { return stems[static_cast<size_t>(index)]->gain.load(); }
+    void setStemMuted(int index, bool shouldBeMuted);
+    bool isStemMuted(int index) const { return stems[static_cast<size_t>(index)]->muted.load(); }
+
+    // 该轨读取+混音耗时占回调时长的比例（平滑后），以及所有分轨的总和
+    float getStemLoad(int index) const { return stems[static_cast<size_t>(index)]->load.load(); }
+    float getTotalLoad() const { return totalLoad.load(); }
+
+    // 离线渲染（会话回放）时打开：取数据前先等预读缓冲准备好，不会因为拉得比实时快而读到静音
+    void setWaitForReadAhead(bool shouldWait) { waitForReadAhead = shouldWait; }
+
+    // 等了 readAheadTimeoutMs 预读缓冲还没准备好的次数（每轨每段算一次）；音频线程只计数，由界面或回放结果报告
+    int getNumReadAheadMisses() const { return readAheadMisses.load(std::memory_order_relaxed); }
+
+    // 非音频线程：等到每轨从当前位置起的 numSamples 个样本都已预读好；超时返回 false（基准测试用它把预读排除在计时之外）
+    bool waitUntilReadAheadReady(int numSamples, juce::uint32 timeoutMs);
+
+    // 音频线程：用读进内存的各轨（和 getStemFile 的顺序一致）代替预读缓冲混音，
+    // 增益和静音照常生效；sourceOffset 是 stemAudio 里的起点
+    void mixFromMemory(const std::vector<juce::AudioBuffer<float>>& stemAudio, int sourceOffset,
+                       const juce::AudioSourceChannelInfo& bufferToFill);
+
+    static constexpr int maxStems = 16;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override { return position.load(); }
+    juce::int64 getTotalLength() const override { return totalLength; }
+    bool isLooping() const override { return false; }
+
+private:
+    struct Stem
+    {
+        juce::String name;
+        juce::File file;
+        std::unique_ptr<juce::BufferingAudioSource> bufferedSource;
+        std::atomic<float> gain { 1.0f };
+        std::atomic<bool> muted { false };
+        std::atomic<float> load { 0.0f };
+        float appliedGain = 1.0f;  // 只在音频线程访问，用来做增益平滑
+    };
+
+    void mixChunk(const juce::AudioSourceChannelInfo& bufferToFill, int offset, int numSamples, std::vector<juce::int64>& stemTicks);
+    static void addStem(Stem& stem, const juce::AudioBuffer<float>& source, int sourceStart,
+                        juce::AudioBuffer<float>& destination, int destStart, int numSamples);
+
+    std::vector<std::unique_ptr<Stem>> stems;
+    double sourceSampleRate = 0.0;
+    juce::int64 totalLength = 0;
+    std::atomic<juce::int64> position { 0 };
+    std::atomic<float> totalLoad { 0.0f };
+    std::atomic<bool> waitForReadAhead { false };
+    std::atomic<int> readAheadMisses { 0 };
+
+    // 只在音频线程访问
+    juce::AudioBuffer<float> stemBuffer;
+    std::vector<juce::int64> stemTicks;
+
+    static constexpr int numChannels = 2;
+    static constexpr double readAheadSeconds = 1.0;
+    static constexpr juce::uint32 readAheadTimeoutMs = 2000;
+    static constexpr float loadSmoothing = 0.1f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MultiStemAudioSource)
+};
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    OnsetIndex.h
+    Created: 21 Oct 2026 2:48:17pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <algorithm>
+#include <vector>
+
+// 起音（音符开始、打击）的索引：排好序的时间数组，二分查找最近的起音，
+// 几个小时的文件也只要 O(log n)，拖动标记时每个鼠标事件都可以查询。
+class OnsetIndex
+{
+public:
+    void setOnsets(std::vector<double> newOnsetTimes)
+    {
+        onsetTimes = std::move(newOnsetTimes);
+        std::sort(onsetTimes.begin(), onsetTimes.end());
+    }
+
+    void clear() { onsetTimes.clear(); }
+    bool isEmpty() const { return onsetTimes.empty(); }
+    int getNumOnsets() const { return static_cast<int>(onsetTimes.size()); }
+
+    // 离 position 最近、距离不超过 tolerance 的起音序号，没有时返回 -1
+    int findNearest(double position, double tolerance) const
+    {
+        const auto after = std::lower_bound(onsetTimes.begin(), onsetTimes.end(), position);
+        int nearest = -1;
+        double nearestDistance = tolerance;
+
+        if (after != onsetTimes.end() && *after - position <= nearestDistance)
+        {
+            nearest = static_cast<int>(after - onsetTimes.begin());
+            nearestDistance = *after - position;
+        }
+
+        if (after != onsetTimes.begin() && position - *(after - 1) < nearestDistance)
+            nearest = static_cast<int>(after - onsetTimes.begin()) - 1;
+
+        return nearest;
+    }
+
+    // 吸附到最近的起音；范围内没有起音时保持原位置
+    double snap(double position, double tolerance) const
+    {
+        const int nearest = findNearest(position, tolerance);
+        return nearest >= 0 ? onsetTimes[static_cast<size_t>(nearest)] : position;
+    }
+
+private:
+    std::vector<double> onsetTimes;  // 排好序的起音时间（秒）
+};
@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+
+    PageControlInput.cpp
+    Created: 24 Oct 2026 7:52:19pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PageControlInput.h"
+
+#include <algorithm>
+
+PageControlInput::~PageControlInput()
+{
+    closeInputs();
+}
+
+void PageControlInput::setMapping(const Mapping& newMapping)
+{
+    // 输入打开以后 MIDI 线程会读，不能再改
+    jassert(queues.empty());
+    mapping = newMapping;
+}
+
+int PageControlInput::openInputs(bool createVirtualPort)
+{
+    closeInputs();
+
+    auto addQueue = [this](std::unique_ptr<juce::MidiInput> input)
+    {
+        auto queue = std::make_unique<InputQueue>();
+        queue->input = std::move(input);
+        queues.push_back(std::move(queue));
+    };
+
+    for (const auto& device : juce::MidiInput::getAvailableDevices())
+    {
+        if (auto input = juce::MidiInput::openDevice(device.identifier, this))
+            addQueue(std::move(input));
+        else
+            DBG("Failed to open MIDI input " + device.name);
+    }
+
+    // Windows 不支持虚拟端口，返回 nullptr
+    if (createVirtualPort)
+    {
+        if (auto input = juce::MidiInput::createNewDevice(virtualPortName, this))
+            addQueue(std::move(input));
+    }
+
+    // 队列列表定下来以后才开始收消息
+    for (auto& queue : queues)
+        queue->input->start();
+
+    if (!queues.empty())
+        startTimer(pollIntervalMs);
+
+    DBG("Page control MIDI inputs: " + getOpenInputNames().joinIntoString(", "));
+    return static_cast<int>(queues.size());
+}
+
+void PageControlInput::closeInputs()
+{
+    stopTimer();
+
+    for (auto& queue : queues)
+        queue->input->stop();
+
+    queues.clear();
+}
+
+juce::StringArray PageControlInput::getOpenInputNames() const
+{
+    juce::StringArray names;
+    for (const auto& queue : queues)
+        names.add(queue->input->getName());
+
+    return names;
+}
+
+bool PageControlInput::handleKeyPress(const juce::KeyPress& key)
+{
+    Action action;
+    action.inputMs = juce::Time::getMillisecondCounterHiRes();
+
+    if (key == juce::KeyPress::pageDownKey || key == juce::KeyPress::rightKey)
+        action.type = ActionType::next;
+    else if (key == juce::KeyPress::pageUpKey || key == juce::KeyPress::leftKey)
+        action.type = ActionType::previous;
+    else
+        return false;
+
+    if (onAction)
+        onAction(action);
+
+    return true;
+}
+
+void PageControlInput::handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message)
+{
+    if (mapping.channel > 0 && !message.isForChannel(mapping.channel))
+        return;
+
+    const auto queue = std::find_if(queues.begin(), queues.end(),
+                                    [source](const std::unique_ptr<InputQueue>& candidate) { return candidate->input.get() == source; });
+    if (queue == queues.end())
+        return;
+
+    // 时间戳是驱动收到消息的时间（秒，和 getMillisecondCounterHiRes 同一个时钟）；没有时用现在
+    const double now = juce::Time::getMillisecondCounterHiRes();
+    const double stamped = message.getTimeStamp() * 1000.0;
+
+    Action action;
+    action.inputMs = stamped > 0.0 && stamped <= now ? stamped : now;
+
+    if (message.isController())
+    {
+        const int controller = message.getControllerNumber();
+        if (controller != mapping.nextController && controller != mapping.previousController)
+            return;
+
+        const bool down = message.getControllerValue() >= 64;
+        if (controllerDown[static_cast<size_t>(controller)].exchange(down) || !down)
+            return;
+
+        action.type = controller == mapping.nextController ? ActionType::next : ActionType::previous;
+    }
+    else if (message.isNoteOn())
+    {
+        if (message.getNoteNumber() == mapping.nextNote)
+            action.type = ActionType::next;
+        else if (message.getNoteNumber() == mapping.previousNote)
+            action.type = ActionType::previous;
+        else
+            return;
+    }
+    else if (message.isProgramChange() && mapping.programChangeJumps)
+    {
+        action.type = ActionType::jump;
+        action.page = message.getProgramChangeNumber();
+    }
+    else
+    {
+        return;
+    }
+
+    push(**queue, action);
+}
+
+void PageControlInput::push(InputQueue& queue, const Action& action)
+{
+    const auto scope = queue.fifo.write(1);
+    if (scope.blockSize1 > 0)
+        queue.actions[static_cast<size_t>(scope.startIndex1)] = action;
+    // 否则消息线程太久没有取，丢掉这次输入
+}
+
+void PageControlInput::timerCallback()
+{
+    std::vector<Action> ready;
+
+    for (auto& queue : queues)
+    {
+        const auto scope = queue->fifo.read(queue->fifo.getNumReady());
+        for (int i = 0; i < scope.blockSize1; ++i)
+            ready.push_back(queue->actions[static_cast<size_t>(scope.startIndex1 + i)]);
+        for (int i = 0; i < scope.blockSize2; ++i)
+            ready.push_back(queue->actions[static_cast<size_t>(scope.startIndex2 + i)]);
+    }
+
+    // 几个设备几乎同时有输入时按收到的先后执行
+    std::stable_sort(ready.begin(), ready.end(), [](const Action& a, const Action& b) { return a.inputMs < b.inputMs; });
+
+    for (const auto& action : ready)
+        if (onAction)
+            onAction(action);
+}
@@ -0,0 +1,94 @@
+/*
+  ==============================================================================
+
+    PageControlInput.h
+    Created: 24 Oct 2026 7:52:19pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 翻页踏板、MIDI 控制器和键盘翻页。
+// MIDI 回调在 MIDI 线程上只做映射和写无锁队列：每个输入一个单写单读的 AbstractFifo，不加锁、不分配内存、
+// 也不往消息队列投消息；消息线程上的 Timer 每 pollIntervalMs 取一次再执行。
+// 每个动作带着收到输入时的时间戳（毫秒，Time::getMillisecondCounterHiRes），用来测量输入到页面画出来的延迟。
+// 除了打开所有现有的 MIDI 输入，还建一个虚拟输入端口（Linux 的 ALSA 和 macOS），可以用 aconnect / amidi 测试。
+// 蓝牙翻页踏板多数模拟键盘，所以 PageDown / PageUp 和左右方向键也走同样的路径。
+class PageControlInput : public juce::MidiInputCallback,
+                         private juce::Timer
+{
+public:
+    enum class ActionType { next, previous, jump };
+
+    struct Action
+    {
+        ActionType type = ActionType::next;
+        int page = 0;          // jump 的目标页（从 0 开始）
+        double inputMs = 0.0;  // 收到输入的时间
+    };
+
+    // 打开输入之前设置，之后 MIDI 线程只读
+    struct Mapping
+    {
+        int channel = 0;                 // 0 表示任意通道
+        int nextController = 64;         // 延音踏板
+        int previousController = 67;     // 弱音踏板
+        int nextNote = 62;               // D4
+        int previousNote = 60;           // C4
+        bool programChangeJumps = true;  // 程序变更 n 跳到第 n + 1 页
+    };
+
+    PageControlInput() = default;
+    ~PageControlInput() override;
+
+    void setMapping(const Mapping& newMapping);
+    const Mapping& getMapping() const { return mapping; }
+
+    // 打开所有现有的 MIDI 输入和虚拟端口，返回打开的个数
+    int openInputs(bool createVirtualPort = true);
+    void closeInputs();
+    juce::StringArray getOpenInputNames() const;
+
+    // 键盘（消息线程）：认识的键马上执行并返回 true
+    bool handleKeyPress(const juce::KeyPress& key);
+
+    // 在消息线程调用
+    std::function<void(const Action&)> onAction;
+
+    static constexpr const char* virtualPortName = "Player Page Control";
+    static constexpr int fifoSize = 64;
+    static constexpr int pollIntervalMs = 10;  // 输入到翻页多出的延迟最多这么多
+
+private:
+    // MIDI 线程 -> 消息线程。Windows 上每个设备可能有自己的回调线程，所以每个输入一个队列，
+    // 每个队列只有这个设备的回调线程写、消息线程读
+    struct InputQueue
+    {
+        std::unique_ptr<juce::MidiInput> input;
+        juce::AbstractFifo fifo { fifoSize };
+        std::array<Action, fifoSize> actions {};
+    };
+
+    void handleIncomingMidiMessage(juce::MidiInput* source, const juce::MidiMessage& message) override;
+    void timerCallback() override;
+    static void push(InputQueue& queue, const Action& action);
+
+    Mapping mapping;
+
+    // 所有输入都放进来以后才 start，之后直到 closeInputs 都不再改动，MIDI 线程可以直接查找
+    std::vector<std::unique_ptr<InputQueue>> queues;
+
+    // 踏板按下的那一下才算（控制器值越过 64），松开和中间值不算
+    std::array<std::atomic<bool>, 128> controllerDown {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PageControlInput)
+};
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    PageImageCache.cpp
+    Created: 19 Oct 2026 2:31:05pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PageImageCache.h"
+#include "ImageDownsampler.h"
+#include "PdfPageRenderer.h"
+
+bool PageImageCache::covers(const juce::Image& raster, int width, int height)
+{
+    const auto fitted = getFittedPageSize(raster.getWidth(), raster.getHeight(), width, height);
+    return raster.getWidth() >= fitted.getWidth() && raster.getHeight() >= fitted.getHeight();
+}
+
+PageImageCache::Lookup PageImageCache::getImageFor(int pageIndex, int width, int height)
+{
+    auto it = pages.find(pageIndex);
+    if (it == pages.end() || it->second.rasters.empty() || width <= 0 || height <= 0)
+        return {};
+
+    auto& entry = it->second;
+    entry.lastUsed = ++useCounter;
+
+    // 找到能覆盖目标尺寸的最小栅格
+    const juce::Image* best = nullptr;
+    for (const auto& raster : entry.rasters)
+    {
+        if (covers(raster, width, height))
+        {
+            best = &raster;
+            break;
+        }
+    }
+
+    if (best == nullptr)
+    {
+        // 只有更小的栅格：先临时放大显示，由调用者安排重新渲染
+        const auto& largest = entry.rasters.back();
+        const auto fitted = getFittedPageSize(largest.getWidth(), largest.getHeight(), width, height);
+        return { largest.rescaled(fitted.getWidth(), fitted.getHeight(), juce::Graphics::lowResamplingQuality), true };
+    }
+
+    const auto fitted = getFittedPageSize(best->getWidth(), best->getHeight(), width, height);
+    if (best->getWidth() == fitted.getWidth() && best->getHeight() == fitted.getHeight())
+        return { *best, false };
+
+    for (const auto& image : entry.scaled)
+        if (image.getWidth() == fitted.getWidth() && image.getHeight() == fitted.getHeight())
+            return { image, false };
+
+    auto image = downsampleImage(*best, fitted.getWidth(), fitted.getHeight());
+
+    if (entry.scaled.size() >= maxScaledImagesPerPage)
+        entry.scaled.erase(entry.scaled.begin());
+
+    entry.scaled.push_back(image);
+    return { image, false };
+}
+
+bool PageImageCache::hasRasterCovering(int pageIndex, int width, int height) const
+{
+    auto it = pages.find(pageIndex);
+    if (it == pages.end())
+        return false;
+
+    for (const auto& raster : it->second.rasters)
+        if (covers(raster, width, height))
+            return true;
+
+    return false;
+}
+
+void PageImageCache::addRaster(int pageIndex, const juce::Image& raster)
+{
+    if (! raster.isValid())
+        return;
+
+    auto& entry = pages[pageIndex];
+    entry.lastUsed = ++useCounter;
+
+    entry.rasters.erase(std::remove_if(entry.rasters.begin(), entry.rasters.end(),
+                                       [&raster](const juce::Image& existing) { return existing.getWidth() <= raster.getWidth(); }),
+                        entry.rasters.end());
+
+    entry.rasters.insert(entry.rasters.begin(), raster);
+    entry.scaled.clear();
+}
+
+void PageImageCache::clear()
+{
+    pages.clear();
+}
+
+size_t PageImageCache::getEntryBytes(const PageEntry& entry)
+{
+    size_t bytes = 0;
+    for (const auto* images : { &entry.rasters, &entry.scaled })
+        for (const auto& image : *images)
+            bytes += static_cast<size_t>(image.getWidth()) * static_cast<size_t>(image.getHeight()) * 4;
+    return bytes;
+}
+
+size_t PageImageCache::getMemoryUsage() const
+{
+    size_t bytes = 0;
+    for (const auto& [pageIndex, entry] : pages)
+        bytes += getEntryBytes(entry);
+    return bytes;
+}
+
+size_t PageImageCache::shrink(size_t bytesToFree)
+{
+    std::vector<std::pair<juce::uint64, int>> byAge;
+    for (const auto& [pageIndex, entry] : pages)
+        byAge.emplace_back(entry.lastUsed, pageIndex);
+
+    if (byAge.size() <= numProtectedPages)
+        return 0;
+
+    std::sort(byAge.begin(), byAge.end());
+    byAge.resize(byAge.size() - numProtectedPages);
+
+    size_t freed = 0;
+    for (const auto& [lastUsed, pageIndex] : byAge)
+    {
+        if (freed >= bytesToFree)
+            break;
+
+        freed += getEntryBytes(pages[pageIndex]);
+        pages.erase(pageIndex);
+    }
+
+    return freed;
+}
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    PageImageCache.h
+    Created: 19 Oct 2026 2:31:05pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <unordered_map>
+#include <vector>
+
+// PDF 页面图像缓存。
+// 每页保存 Poppler 渲染出的高分辨率栅格，任何更小的显示尺寸（窗口缩小、下一页预览）
+// 都从“最接近且不小于目标”的栅格缩小得到，而不是重新调用 Poppler。
+class PageImageCache
+{
+public:
+    struct Lookup
+    {
+        juce::Image image;        // 可以直接显示的图像（可能是临时放大的近似图）
+        bool needsRender = true;  // 没有足够大的栅格，需要 Poppler 重新渲染
+    };
+
+    // 获取按比例放入 width x height 的页面图像
+    Lookup getImageFor(int pageIndex, int width, int height);
+
+    // 是否已有能覆盖该尺寸的栅格
+    bool hasRasterCovering(int pageIndex, int width, int height) const;
+
+    // 存入 Poppler 渲染的栅格；比它小的旧栅格会被丢弃，因为可以从新栅格缩小得到
+    void addRaster(int pageIndex, const juce::Image& raster);
+
+    void clear();
+
+    // 所有栅格和缩放结果占用的字节数
+    size_t getMemoryUsage() const;
+
+    // 从最久没用过的页开始整页丢弃，直到释放了 bytesToFree；最近用过的 numProtectedPages 页保留。
+    // 返回实际释放的字节数
+    size_t shrink(size_t bytesToFree);
+
+private:
+    struct PageEntry
+    {
+        std::vector<juce::Image> rasters;  // Poppler 渲染结果，按宽度从小到大排列
+        std::vector<juce::Image> scaled;   // 最近缩放出来的结果（主显示和预览各一张）
+        juce::uint64 lastUsed = 0;
+    };
+
+    static bool covers(const juce::Image& raster, int width, int height);
+    static size_t getEntryBytes(const PageEntry& entry);
+
+    static constexpr size_t maxScaledImagesPerPage = 2;
+    static constexpr size_t numProtectedPages = 2;  // 当前页和预览
+    std::unordered_map<int, PageEntry> pages;
+    juce::uint64 useCounter = 0;
+};
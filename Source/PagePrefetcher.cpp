@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    PagePrefetcher.cpp
+    Created: 19 Oct 2026 3:15:27pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PagePrefetcher.h"
+#include "PdfPageRenderer.h"
+#include <glib.h>                   // GLib 头文件，用于 GError 等类型
+
+PagePrefetcher::PagePrefetcher()
+{
+    worker.process = [this](const Request& request, int generation) { process(request, generation); };
+    worker.onResult = [this](RenderedPage page)
+    {
+        if (onPageRendered)
+            onPageRendered(page.pageIndex, page.image);
+    };
+    worker.start();
+}
+
+PagePrefetcher::~PagePrefetcher()
+{
+    worker.stop();
+    closeWorkerDocument();
+}
+
+void PagePrefetcher::setDocument(const juce::String& fileURI)
+{
+    // 没有页面的请求：工作线程只换文档，旧文档的结果全部作废
+    documentURI = fileURI;
+    worker.request({ documentURI, {}, 0, 0 });
+}
+
+void PagePrefetcher::requestPages(const std::vector<int>& pageIndices, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    worker.request({ documentURI, pageIndices, width, height });
+}
+
+void PagePrefetcher::closeWorkerDocument()
+{
+    if (workerDocument != nullptr)
+    {
+        g_object_unref(workerDocument);
+        workerDocument = nullptr;
+    }
+}
+
+void PagePrefetcher::process(const Request& request, int generation)
+{
+    // 文档变了，重新打开自己的那一份
+    if (request.documentURI != workerURI)
+    {
+        closeWorkerDocument();
+        workerURI = request.documentURI;
+
+        // 磁盘缓存的哈希也在这里算，不占用消息线程
+        workerDiskCache.setDocument(workerURI.isNotEmpty() ? juce::URL(workerURI).getLocalFile() : juce::File());
+
+        if (workerURI.isNotEmpty())
+        {
+            GError* gerror = nullptr;
+            workerDocument = poppler_document_new_from_file(workerURI.toRawUTF8(), nullptr, &gerror);
+
+            if (workerDocument == nullptr)
+            {
+                DBG("Prefetch failed to open PDF: " + juce::String(gerror != nullptr ? gerror->message : "unknown error"));
+                if (gerror != nullptr)
+                    g_error_free(gerror);
+            }
+        }
+    }
+
+    if (workerDocument == nullptr)
+        return;
+
+    const int numPages = poppler_document_get_n_pages(workerDocument);
+
+    // 每页之间检查一次，有新的请求就放弃剩下的页
+    for (int pageIndex : request.pages)
+    {
+        if (worker.isStale(generation))
+            return;
+
+        if (pageIndex < 0 || pageIndex >= numPages)
+            continue;
+
+        // 批处理提前渲染好的栅格够大时直接解码，不调用 Poppler
+        auto image = workerDiskCache.loadPage(pageIndex, request.width, request.height);
+
+        if (!image.isValid())
+        {
+            PopplerPage* pdfPage = poppler_document_get_page(workerDocument, pageIndex);
+            if (pdfPage == nullptr)
+                continue;
+
+            image = renderPdfPageToImage(pdfPage, request.width, request.height);
+            g_object_unref(pdfPage);
+        }
+
+        worker.emit(generation, { pageIndex, image });
+    }
+}
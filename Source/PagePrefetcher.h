@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    PagePrefetcher.h
+    Created: 19 Oct 2026 3:15:27pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <poppler/glib/poppler.h>  // Poppler C API
+#include "LatestRequestWorker.h"
+#include "PageRasterDiskCache.h"
+
+#include <functional>
+#include <vector>
+
+// 后台预渲染 PDF 页面。
+// 工作线程打开自己的一份 PopplerDocument（Poppler 不允许多个线程同时使用同一个文档），
+// 磁盘栅格缓存里有的页直接解码，没有的再渲染；图像回到消息线程，再交给 onPageRendered 放进缓存。
+class PagePrefetcher
+{
+public:
+    PagePrefetcher();
+    ~PagePrefetcher();
+
+    // 切换到新的 PDF 文档（传入空字符串表示关闭），之前未完成的请求全部作废
+    void setDocument(const juce::String& fileURI);
+
+    // 请求按 width x height 预渲染这些页面，替换掉尚未开始的旧请求
+    void requestPages(const std::vector<int>& pageIndices, int width, int height);
+
+    // 渲染完成后在消息线程上调用
+    std::function<void(int pageIndex, const juce::Image& image)> onPageRendered;
+
+private:
+    struct Request
+    {
+        juce::String documentURI;
+        std::vector<int> pages;
+        int width = 0, height = 0;
+    };
+
+    struct RenderedPage
+    {
+        int pageIndex;
+        juce::Image image;
+    };
+
+    void process(const Request& request, int generation);
+    void closeWorkerDocument();
+
+    juce::String documentURI;  // 只在消息线程访问
+
+    // 只在工作线程里访问
+    PopplerDocument* workerDocument = nullptr;
+    juce::String workerURI;
+    PageRasterDiskCache workerDiskCache;
+
+    LatestRequestWorker<Request, RenderedPage> worker { "PDF page prefetch", juce::Thread::Priority::low, 4000 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PagePrefetcher)
+};
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    PageRasterDiskCache.cpp
+    Created: 22 Oct 2026 2:05:31pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PageRasterDiskCache.h"
+#include "PdfPageRenderer.h"
+#include "ProjectFile.h"
+
+#include <algorithm>
+#include <vector>
+
+juce::File PageRasterDiskCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile(ProjectInfo::projectName)
+        .getChildFile("PageCache");
+}
+
+void PageRasterDiskCache::setDocument(const juce::File& pdfFile)
+{
+    documentDirectory = juce::File();
+
+    if (!pdfFile.existsAsFile())
+        return;
+
+    const auto hash = ProjectFileReference::computeContentHash(pdfFile);
+    documentDirectory = rootDirectory.getChildFile(juce::String::toHexString(static_cast<juce::int64>(hash)));
+
+    // 目录的修改时间记录最近一次使用，trimToSize 按它决定先删谁
+    if (documentDirectory.isDirectory())
+        documentDirectory.setLastModificationTime(juce::Time::getCurrentTime());
+}
+
+juce::Array<juce::File> PageRasterDiskCache::findPageFiles(int pageIndex) const
+{
+    if (!hasDocument() || !documentDirectory.isDirectory())
+        return {};
+
+    return documentDirectory.findChildFiles(juce::File::findFiles, false, "page-" + juce::String(pageIndex) + "-*.png");
+}
+
+juce::Point<int> PageRasterDiskCache::getRasterSize(const juce::File& pageFile)
+{
+    // page-<页码>-<宽>x<高>.png
+    const auto size = pageFile.getFileNameWithoutExtension().fromLastOccurrenceOf("-", false, false);
+    return { size.upToFirstOccurrenceOf("x", false, false).getIntValue(), size.fromFirstOccurrenceOf("x", false, false).getIntValue() };
+}
+
+juce::Image PageRasterDiskCache::loadPage(int pageIndex, int width, int height) const
+{
+    if (width <= 0 || height <= 0)
+        return {};
+
+    juce::File best;
+    int bestWidth = 0;
+
+    for (const auto& pageFile : findPageFiles(pageIndex))
+    {
+        const auto size = getRasterSize(pageFile);
+        const auto fitted = getFittedPageSize(size.x, size.y, width, height);
+
+        if (size.x >= fitted.getWidth() && size.y >= fitted.getHeight() && (bestWidth == 0 || size.x < bestWidth))
+        {
+            best = pageFile;
+            bestWidth = size.x;
+        }
+    }
+
+    if (best == juce::File{})
+        return {};
+
+    auto image = juce::ImageFileFormat::loadFrom(best);
+    if (!image.isValid())
+    {
+        DBG("Failed to read cached page: " + best.getFullPathName());
+        return {};
+    }
+
+    return image.convertedToFormat(juce::Image::ARGB);
+}
+
+bool PageRasterDiskCache::storePage(int pageIndex, const juce::Image& raster) const
+{
+    if (!hasDocument() || !raster.isValid())
+        return false;
+
+    if (!documentDirectory.createDirectory())
+    {
+        DBG("Failed to create page cache directory: " + documentDirectory.getFullPathName());
+        return false;
+    }
+
+    const auto pageFile = documentDirectory.getChildFile("page-" + juce::String(pageIndex) + "-"
+                                                         + juce::String(raster.getWidth()) + "x" + juce::String(raster.getHeight()) + ".png");
+
+    // 写到临时文件再替换，另一个进程同时读时不会读到一半的文件
+    juce::TemporaryFile temporaryFile(pageFile);
+    {
+        juce::FileOutputStream out(temporaryFile.getFile());
+        juce::PNGImageFormat png;
+        if (!out.openedOk() || !png.writeImageToStream(raster, out))
+        {
+            DBG("Failed to write cached page: " + pageFile.getFullPathName());
+            return false;
+        }
+    }
+
+    if (!temporaryFile.overwriteTargetFileWithTemporary())
+        return false;
+
+    documentDirectory.setLastModificationTime(juce::Time::getCurrentTime());
+
+    // 更小的旧栅格可以从新栅格缩小得到
+    for (const auto& oldFile : findPageFiles(pageIndex))
+        if (oldFile != pageFile && getRasterSize(oldFile).x < raster.getWidth())
+            oldFile.deleteFile();
+
+    return true;
+}
+
+void PageRasterDiskCache::trimToSize(juce::int64 maxBytes) const
+{
+    if (!rootDirectory.isDirectory())
+        return;
+
+    struct DocumentEntry
+    {
+        juce::File directory;
+        juce::int64 bytes = 0;
+        juce::Time lastUsed;
+    };
+
+    std::vector<DocumentEntry> entries;
+    juce::int64 totalBytes = 0;
+
+    for (const auto& directory : rootDirectory.findChildFiles(juce::File::findDirectories, false))
+    {
+        DocumentEntry entry { directory, 0, directory.getLastModificationTime() };
+        for (const auto& pageFile : directory.findChildFiles(juce::File::findFiles, false))
+            entry.bytes += pageFile.getSize();
+
+        totalBytes += entry.bytes;
+        entries.push_back(entry);
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const DocumentEntry& a, const DocumentEntry& b) { return a.lastUsed < b.lastUsed; });
+
+    for (const auto& entry : entries)
+    {
+        if (totalBytes <= maxBytes)
+            break;
+
+        // 当前文档刚写好或正在使用，不删
+        if (entry.directory == documentDirectory)
+            continue;
+
+        if (entry.directory.deleteRecursively())
+            totalBytes -= entry.bytes;
+        else
+            DBG("Failed to evict page cache: " + entry.directory.getFullPathName());
+    }
+}
@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    PageRasterDiskCache.h
+    Created: 22 Oct 2026 2:05:31pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+// 磁盘上的页面栅格缓存：每份 PDF（按内容哈希区分，移动或改名后仍然有效）一个目录，
+// 每页一张 PNG，文件名里带着图像尺寸，不用解码就能知道够不够大。
+// 批处理模式提前写好；后台预渲染（PagePrefetcher、PiecePreloader）先从这里读，读不到再用 Poppler 渲染。
+// setDocument 要读文件算哈希，loadPage 要扫目录、解码 PNG，都只在后台线程调用；同一个对象不要同时 setDocument。
+// 整个缓存目录有大小上限，超出时先删最久没有打开过的文档的目录。
+class PageRasterDiskCache
+{
+public:
+    PageRasterDiskCache() = default;
+    explicit PageRasterDiskCache(const juce::File& rootDirectoryToUse) : rootDirectory(rootDirectoryToUse) {}
+
+    static juce::File getDefaultDirectory();
+
+    // 换成另一份 PDF（空文件表示没有）；会读文件的几小段计算哈希，并把这份文档记为最近使用
+    void setDocument(const juce::File& pdfFile);
+    bool hasDocument() const { return documentDirectory != juce::File{}; }
+
+    // 读取能覆盖 width x height 的栅格（取最小的那张），没有时返回无效图像
+    juce::Image loadPage(int pageIndex, int width, int height) const;
+
+    // 写入一页的栅格，同一页更小的旧文件会被删掉
+    bool storePage(int pageIndex, const juce::Image& raster) const;
+
+    // 整个缓存目录超过 maxBytes 时，按最近使用时间从旧到新删除其他文档的目录
+    void trimToSize(juce::int64 maxBytes) const;
+
+    static constexpr juce::int64 defaultSizeLimitBytes = 512 * 1024 * 1024;
+
+private:
+    juce::Array<juce::File> findPageFiles(int pageIndex) const;
+    static juce::Point<int> getRasterSize(const juce::File& pageFile);
+
+    juce::File rootDirectory = getDefaultDirectory();
+    juce::File documentDirectory;
+};
@@ -0,0 +1,131 @@
+/*
+  ==============================================================================
+
+    PageTurnLatency.cpp
+    Created: 23 Oct 2026 11:52:07am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PageTurnLatency.h"
+
+#include <algorithm>
+#include <cmath>
+
+void PageTurnLatencyMonitor::beginTurn(double markerTime, int page, double crossedMillisecondsAgo)
+{
+    // 上一次翻页还没画出来就又翻页了：丢掉上一次
+    detectedAt = juce::Time::getMillisecondCounterHiRes();
+    crossedAt = detectedAt - std::max(0.0, crossedMillisecondsAgo);
+
+    current = PageTurnSample();
+    current.markerTime = markerTime;
+    current.page = page;
+    current.detectionMs = detectedAt - crossedAt;
+    stage = Stage::rendering;
+}
+
+void PageTurnLatencyMonitor::endRender()
+{
+    if (stage != Stage::rendering)
+        return;
+
+    renderedAt = juce::Time::getMillisecondCounterHiRes();
+    current.renderMs = renderedAt - detectedAt;
+    stage = Stage::painting;
+}
+
+void PageTurnLatencyMonitor::endPaint()
+{
+    if (stage != Stage::painting)
+        return;
+
+    current.paintMs = juce::Time::getMillisecondCounterHiRes() - renderedAt;
+    stage = Stage::idle;
+
+    if (samples.size() >= maxSamples)
+        samples.erase(samples.begin());
+
+    samples.push_back(current);
+
+    if (onSampleAdded)
+        onSampleAdded();
+}
+
+void PageTurnLatencyMonitor::setSamples(std::vector<PageTurnSample> newSamples)
+{
+    samples = std::move(newSamples);
+    stage = Stage::idle;
+
+    if (onSampleAdded)
+        onSampleAdded();
+}
+
+void PageTurnLatencyMonitor::clear()
+{
+    setSamples({});
+}
+
+double PageTurnLatencyMonitor::getPercentile(double fraction) const
+{
+    if (samples.empty())
+        return 0.0;
+
+    std::vector<double> totals;
+    totals.reserve(samples.size());
+    for (const auto& sample : samples)
+        totals.push_back(sample.getTotalMs());
+
+    // 最近秩法
+    const auto rank = static_cast<size_t>(std::ceil(juce::jlimit(0.0, 1.0, fraction) * totals.size()));
+    const auto index = std::min(totals.size() - 1, rank > 0 ? rank - 1 : 0);
+    std::nth_element(totals.begin(), totals.begin() + static_cast<std::ptrdiff_t>(index), totals.end());
+    return totals[index];
+}
+
+double PageTurnLatencyMonitor::getMaximum() const
+{
+    double maximum = 0.0;
+    for (const auto& sample : samples)
+        maximum = std::max(maximum, sample.getTotalMs());
+    return maximum;
+}
+
+std::array<int, PageTurnLatencyMonitor::numHistogramBins> PageTurnLatencyMonitor::getHistogram() const
+{
+    std::array<int, numHistogramBins> bins {};
+
+    for (const auto& sample : samples)
+        ++bins[static_cast<size_t>(juce::jlimit(0, numHistogramBins - 1, static_cast<int>(sample.getTotalMs() / histogramBinMs)))];
+
+    return bins;
+}
+
+juce::String PageTurnLatencyMonitor::toJson() const
+{
+    auto* root = new juce::DynamicObject();
+    root->setProperty("cpu", juce::SystemStats::getCpuModel());
+    root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+    root->setProperty("time", juce::Time::getCurrentTime().toISO8601(true));
+    root->setProperty("count", static_cast<int>(samples.size()));
+    root->setProperty("p50Ms", getPercentile(0.50));
+    root->setProperty("p95Ms", getPercentile(0.95));
+    root->setProperty("maxMs", getMaximum());
+
+    juce::Array<juce::var> turns;
+    for (const auto& sample : samples)
+    {
+        auto* turn = new juce::DynamicObject();
+        turn->setProperty("markerTime", sample.markerTime);
+        turn->setProperty("page", sample.page + 1);
+        turn->setProperty("detectionMs", sample.detectionMs);
+        turn->setProperty("renderMs", sample.renderMs);
+        turn->setProperty("paintMs", sample.paintMs);
+        turn->setProperty("totalMs", sample.getTotalMs());
+        turns.add(juce::var(turn));
+    }
+    root->setProperty("turns", turns);
+
+    return juce::JSON::toString(juce::var(root));
+}
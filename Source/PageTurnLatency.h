@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    PageTurnLatency.h
+    Created: 23 Oct 2026 11:52:07am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "ActivityMeter.h"
+
+#include <array>
+#include <functional>
+#include <vector>
+
+// 一次自动翻页的耗时（毫秒）：
+// detection —— 音频越过标记到消息线程发现（定时器间隔决定），
+// render —— 查缓存 / Poppler 渲染并设置图像，paint —— 设置图像到新页面第一次画完。
+struct PageTurnSample
+{
+    double markerTime = 0.0;  // 标记的位置（秒）
+    int page = 0;
+    double detectionMs = 0.0, renderMs = 0.0, paintMs = 0.0;
+
+    double getTotalMs() const { return detectionMs + renderMs + paintMs; }
+};
+
+// 在消息线程上记录每次翻页从音频越过标记到新页面画到屏幕上的时间，并给出分布。
+class PageTurnLatencyMonitor
+{
+public:
+    // 发现时间线换页；crossedMillisecondsAgo 是音频越过标记到现在经过的时间
+    void beginTurn(double markerTime, int page, double crossedMillisecondsAgo);
+    // 新页面的图像已经设置好
+    void endRender();
+    // 页面组件画完；只有在 endRender 之后的第一次才结束这次翻页
+    void endPaint();
+
+    const std::vector<PageTurnSample>& getSamples() const { return samples; }
+    void setSamples(std::vector<PageTurnSample> newSamples);
+    void clear();
+
+    // 总延迟的分布
+    double getPercentile(double fraction) const;
+    double getMaximum() const;
+
+    static constexpr int numHistogramBins = 25;
+    static constexpr double histogramBinMs = 20.0;  // 最后一格包括所有更慢的翻页
+    std::array<int, numHistogramBins> getHistogram() const;
+
+    // 所有样本和统计，连同机器信息，写成 JSON
+    juce::String toJson() const;
+
+    // 每完成一次翻页调用（消息线程）
+    std::function<void()> onSampleAdded;
+
+    static constexpr size_t maxSamples = 4096;
+
+private:
+    enum class Stage { idle, rendering, painting };
+
+    Stage stage = Stage::idle;
+    PageTurnSample current;
+    double crossedAt = 0.0, detectedAt = 0.0, renderedAt = 0.0;
+    std::vector<PageTurnSample> samples;
+};
+
+// 画完时通知的 ImageComponent，用来测量新页面真正画出来的时间
+class PageImageComponent : public juce::ImageComponent
+{
+public:
+    void paint(juce::Graphics& g) override
+    {
+        ActivityMeter::notePaint(g.getClipBounds());
+        juce::ImageComponent::paint(g);
+
+        if (onPainted)
+            onPainted();
+    }
+
+    std::function<void()> onPainted;
+};
@@ -0,0 +1,327 @@
+/*
+  ==============================================================================
+
+    PageTurnSync.cpp
+    Created: 24 Oct 2026 3:27:40pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PageTurnSync.h"
+
+#include <algorithm>
+
+PageTurnSync::PageTurnSync()
+    : juce::Thread("Page turn sync"),
+      instanceId(juce::Uuid().toString().substring(0, 12))
+{
+}
+
+PageTurnSync::~PageTurnSync()
+{
+    stop();
+}
+
+bool PageTurnSync::start(Role newRole, const juce::String& groupAddress, int port)
+{
+    stop();
+
+    if (newRole == Role::off)
+        return true;
+
+    // 端口复用要在绑定之前打开，同一台机器上的其它实例才能绑定同一个端口
+    auto newSocket = std::make_unique<juce::DatagramSocket>();
+    newSocket->setEnablePortReuse(true);
+
+    if (!newSocket->bindToPort(port))
+    {
+        DBG("Page turn sync: failed to bind UDP port " + juce::String(port));
+        return false;
+    }
+
+    if (!newSocket->joinMulticast(groupAddress))
+    {
+        DBG("Page turn sync: failed to join multicast group " + groupAddress);
+        return false;
+    }
+
+    newSocket->setMulticastLoopbackEnabled(true);
+
+    socket = std::move(newSocket);
+    group = groupAddress;
+    groupPort = port;
+    role = newRole;
+
+    {
+        const juce::ScopedLock sl(lock);
+        masterId.clear();
+        masterSequence = -1;
+        clockSamples.clear();
+        clockOffsetMs = 0.0;
+        roundTripMs = -1.0;
+    }
+
+    DBG("Page turn sync: " + juce::String(role == Role::master ? "master" : "follower") + " " + instanceId
+        + " on " + group + ":" + juce::String(groupPort));
+
+    startThread(juce::Thread::Priority::high);
+    return true;
+}
+
+void PageTurnSync::stop()
+{
+    cancelPendingUpdate();
+    signalThreadShouldExit();
+
+    // 关掉 socket 让 waitUntilReady 马上返回
+    if (socket != nullptr)
+        socket->shutdown();
+
+    stopThread(2000);
+    socket.reset();
+    role = Role::off;
+}
+
+void PageTurnSync::publish(double position, double tempo, bool playing, int page, int topPage)
+{
+    if (role != Role::master)
+        return;
+
+    {
+        const juce::ScopedLock sl(lock);
+        localState = { getClockMs(), position, tempo, playing, page, topPage };
+        ++localSequence;
+        hasLocalState = true;
+    }
+
+    sendState();
+}
+
+bool PageTurnSync::hasMasterState() const
+{
+    const juce::ScopedLock sl(lock);
+
+    // 还没测到时钟偏差时，主机的时间戳没法换算成本机时间，不能外推
+    return masterSequence >= 0 && roundTripMs >= 0.0;
+}
+
+PageTurnSync::State PageTurnSync::getMasterState() const
+{
+    const juce::ScopedLock sl(lock);
+
+    // 主机时间 = 本机时间 + 偏差
+    State state = masterState;
+    state.masterTimeMs = masterState.masterTimeMs - clockOffsetMs;
+
+    // 主机太久没有消息（掉线或退出）时不再往前外推，停在超时的那一刻
+    const double silenceEndMs = lastMasterMessageMs + masterTimeoutMs;
+    const double nowMs = getClockMs();
+
+    if (state.playing)
+        state.position += (std::min(nowMs, silenceEndMs) - state.masterTimeMs) / 1000.0 * state.tempo;
+
+    if (nowMs > silenceEndMs)
+        state.playing = false;
+
+    return state;
+}
+
+double PageTurnSync::getClockOffsetMs() const
+{
+    const juce::ScopedLock sl(lock);
+    return clockOffsetMs;
+}
+
+double PageTurnSync::getRoundTripMs() const
+{
+    const juce::ScopedLock sl(lock);
+    return roundTripMs;
+}
+
+void PageTurnSync::send(juce::DynamicObject* message)
+{
+    message->setProperty("from", instanceId);
+    const juce::String text = juce::JSON::toString(juce::var(message), true);
+
+    // 消息线程和网络线程都会发
+    const juce::ScopedLock sl(sendLock);
+    if (socket != nullptr && socket->write(group, groupPort, text.toRawUTF8(), static_cast<int>(text.getNumBytesAsUTF8())) < 0)
+        DBG("Page turn sync: failed to send to " + group);
+}
+
+void PageTurnSync::sendState()
+{
+    State state;
+    int sequence;
+    {
+        const juce::ScopedLock sl(lock);
+        if (!hasLocalState)
+            return;
+
+        state = localState;
+        sequence = localSequence;
+    }
+
+    auto* message = new juce::DynamicObject();
+    message->setProperty("type", "state");
+    message->setProperty("seq", sequence);
+    message->setProperty("t", state.masterTimeMs);
+    message->setProperty("pos", state.position);
+    message->setProperty("tempo", state.tempo);
+    message->setProperty("playing", state.playing);
+    message->setProperty("page", state.page);
+    message->setProperty("topPage", state.topPage);
+    send(message);
+}
+
+void PageTurnSync::sendPing()
+{
+    auto* message = new juce::DynamicObject();
+    message->setProperty("type", "ping");
+    message->setProperty("id", nextPingId++);
+    message->setProperty("t0", getClockMs());
+    send(message);
+}
+
+void PageTurnSync::run()
+{
+    char buffer[2048];
+    double lastHeartbeatMs = 0.0, lastPingMs = 0.0;
+
+    while (!threadShouldExit())
+    {
+        const int ready = socket->waitUntilReady(true, 20);
+        if (ready < 0)
+            break;
+
+        if (ready > 0)
+        {
+            juce::String senderAddress;
+            int senderPort = 0;
+            const int numBytes = socket->read(buffer, static_cast<int>(sizeof(buffer)), false, senderAddress, senderPort);
+            const double receivedMs = getClockMs();
+
+            if (numBytes > 0)
+            {
+                const auto message = juce::JSON::parse(juce::String::fromUTF8(buffer, numBytes));
+                if (message.isObject() && message["from"].toString() != instanceId)
+                    handleMessage(message, receivedMs);
+            }
+        }
+
+        const double now = getClockMs();
+        if (role == Role::master && now - lastHeartbeatMs >= heartbeatIntervalMs)
+        {
+            lastHeartbeatMs = now;
+            sendState();
+        }
+        else if (role == Role::follower && now - lastPingMs >= pingIntervalMs)
+        {
+            lastPingMs = now;
+            sendPing();
+        }
+    }
+}
+
+void PageTurnSync::handleMessage(const juce::var& message, double receivedMs)
+{
+    const juce::String type = message["type"].toString();
+    const juce::String sender = message["from"].toString();
+
+    if (role == Role::master)
+    {
+        // 收到后马上回复，t1 和 t2 之间只有这几行
+        if (type == "ping")
+        {
+            auto* pong = new juce::DynamicObject();
+            pong->setProperty("type", "pong");
+            pong->setProperty("to", sender);
+            pong->setProperty("id", message["id"]);
+            pong->setProperty("t0", message["t0"]);
+            pong->setProperty("t1", receivedMs);
+            pong->setProperty("t2", getClockMs());
+            send(pong);
+        }
+        else if (type == "state")
+        {
+            DBG("Page turn sync: another master " + sender + " is on the same group");
+        }
+
+        return;
+    }
+
+    if (type == "state")
+    {
+        const int sequence = static_cast<int>(message["seq"]);
+        bool changed = false;
+        {
+            const juce::ScopedLock sl(lock);
+
+            // 原来的主机不说话了才换成新的主机
+            if (sender != masterId)
+            {
+                if (masterId.isNotEmpty() && receivedMs - lastMasterMessageMs < masterTimeoutMs)
+                    return;
+
+                DBG("Page turn sync: following master " + sender);
+                masterId = sender;
+                masterSequence = -1;
+                clockSamples.clear();
+                clockOffsetMs = 0.0;
+                roundTripMs = -1.0;
+            }
+
+            lastMasterMessageMs = receivedMs;
+
+            // UDP 可能乱序，旧的状态不要
+            if (sequence < masterSequence)
+                return;
+
+            changed = sequence != masterSequence;
+            masterSequence = sequence;
+            masterState.masterTimeMs = static_cast<double>(message["t"]);
+            masterState.position = static_cast<double>(message["pos"]);
+            masterState.tempo = static_cast<double>(message["tempo"]);
+            masterState.playing = static_cast<bool>(message["playing"]);
+            masterState.page = static_cast<int>(message["page"]);
+            masterState.topPage = static_cast<int>(message["topPage"]);
+        }
+
+        if (changed)
+            triggerAsyncUpdate();
+    }
+    else if (type == "pong" && message["to"].toString() == instanceId)
+    {
+        const double t0 = message["t0"], t1 = message["t1"], t2 = message["t2"];
+        const ClockSample sample { ((t1 - t0) + (t2 - receivedMs)) / 2.0, (receivedMs - t0) - (t2 - t1) };
+
+        bool firstSample = false;
+        {
+            const juce::ScopedLock sl(lock);
+            if (sender != masterId)
+                return;
+
+            firstSample = roundTripMs < 0.0 && masterSequence >= 0;
+            clockSamples.push_back(sample);
+            while (static_cast<int>(clockSamples.size()) > numClockSamples)
+                clockSamples.pop_front();
+
+            // 往返时间最短的一次受排队延迟的影响最小
+            const auto best = std::min_element(clockSamples.begin(), clockSamples.end(),
+                                               [](const ClockSample& a, const ClockSample& b) { return a.roundTripMs < b.roundTripMs; });
+            clockOffsetMs = best->offsetMs;
+            roundTripMs = best->roundTripMs;
+        }
+
+        // 第一次测到时钟偏差后 hasMasterState 才成立，让从机马上跟上已经收到的状态
+        if (firstSample)
+            triggerAsyncUpdate();
+    }
+}
+
+void PageTurnSync::handleAsyncUpdate()
+{
+    if (onMasterStateChanged)
+        onMasterStateChanged();
+}
@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    PageTurnSync.h
+    Created: 24 Oct 2026 3:27:40pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+// 局域网翻页同步：一台作为主机，用 UDP 组播广播播放位置、速度和当前页；其它实例作为从机跟随。
+// 所有实例绑定同一个组播端口（端口复用、打开组播回环），所以同一台机器上可以开多个实例测试。
+// 每个报文是一行 JSON，带发送者的随机 id，收到自己发的直接丢掉。
+// 时钟偏差按 NTP 的方法估计：从机每 pingIntervalMs 发一个 ping（t0），主机在网络线程里马上回 pong
+// （t1 收到、t2 发出），从机收到时记 t3；偏差 = ((t1 - t0) + (t2 - t3)) / 2，取最近几次里往返时间最短的一次。
+// 主机的状态带着主机时钟的时间戳，从机换算到自己的时钟后外推出现在的位置。
+class PageTurnSync : private juce::Thread,
+                     private juce::AsyncUpdater
+{
+public:
+    enum class Role { off, master, follower };
+
+    struct State
+    {
+        double masterTimeMs = 0.0;  // 主机时钟上的时间戳
+        double position = 0.0;      // 秒
+        double tempo = 1.0;
+        bool playing = false;
+        int page = 0;
+        int topPage = -1;
+    };
+
+    PageTurnSync();
+    ~PageTurnSync() override;
+
+    // 打开组播端口并开始收发；失败时返回 false 并输出原因
+    bool start(Role newRole, const juce::String& groupAddress = defaultGroup, int port = defaultPort);
+    void stop();
+    Role getRole() const { return role.load(); }
+
+    // 主机：播放状态、位置或页面变化时调用（消息线程），马上发出；网络线程每 heartbeatIntervalMs 重发最新状态
+    void publish(double position, double tempo, bool playing, int page, int topPage);
+
+    // 从机：收到过主机的状态并测到时钟偏差后才有意义；位置外推到现在，时间戳换算成本机时钟，
+    // 主机超过 masterTimeoutMs 没有消息时停止外推并当作已停止播放
+    bool hasMasterState() const;
+    State getMasterState() const;
+    double getClockOffsetMs() const;
+    double getRoundTripMs() const;  // 还没有测到时为负数
+
+    // 从机收到新的主机状态（不是重发的心跳）时在消息线程调用
+    std::function<void()> onMasterStateChanged;
+
+    static double getClockMs() { return juce::Time::getMillisecondCounterHiRes(); }
+
+    static constexpr const char* defaultGroup = "239.255.42.99";
+    static constexpr int defaultPort = 49731;
+    static constexpr int heartbeatIntervalMs = 100;
+    static constexpr int pingIntervalMs = 500;
+    static constexpr int numClockSamples = 8;
+    static constexpr int masterTimeoutMs = 2000;  // 这么久没有消息就换成新出现的主机
+
+private:
+    struct ClockSample
+    {
+        double offsetMs;
+        double roundTripMs;
+    };
+
+    void run() override;
+    void handleAsyncUpdate() override;
+    void handleMessage(const juce::var& message, double receivedMs);
+    void sendState();
+    void sendPing();
+    void send(juce::DynamicObject* message);
+
+    std::unique_ptr<juce::DatagramSocket> socket;
+    juce::String group;
+    int groupPort = defaultPort;
+    std::atomic<Role> role { Role::off };
+    const juce::String instanceId;
+
+    mutable juce::CriticalSection lock;
+    juce::CriticalSection sendLock;
+
+    // 主机：最近一次发布的状态
+    State localState;
+    int localSequence = 0;
+    bool hasLocalState = false;
+
+    // 从机：跟随的主机和它最近的状态
+    juce::String masterId;
+    State masterState;
+    int masterSequence = -1;
+    double lastMasterMessageMs = 0.0;
+    std::deque<ClockSample> clockSamples;
+    double clockOffsetMs = 0.0;
+    double roundTripMs = -1.0;
+    int nextPingId = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PageTurnSync)
+};
@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    PdfPageRenderer.cpp
+    Created: 19 Oct 2026 2:18:40pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PdfPageRenderer.h"
+#include "Trace.h"
+#include <glib.h>                  // GLib 头文件，用于 GError 等类型
+
+PopplerDocument* openPdfDocument(const juce::File& pdfFile)
+{
+    // 构建正确的文件 URI
+    juce::String fileURI = juce::URL(pdfFile).toString(true);
+
+    // 使用 Poppler C API 加载 PDF 文档
+    GError* gerror = nullptr;
+    PopplerDocument* document = poppler_document_new_from_file(fileURI.toRawUTF8(), nullptr, &gerror);
+
+    if (!document)
+    {
+        juce::String errorMessage = "Failed to load PDF file.";
+        if (gerror != nullptr && gerror->message != nullptr)
+        {
+            errorMessage += " Error: " + juce::String(gerror->message);
+        }
+        else
+        {
+            errorMessage += " Unknown error.";
+        }
+
+        DBG(errorMessage);
+    }
+
+    if (gerror != nullptr)
+    {
+        g_error_free(gerror);
+    }
+
+    return document;
+}
+
+juce::Rectangle<int> getFittedPageSize(double pageWidth, double pageHeight, int maxWidth, int maxHeight)
+{
+    if (pageWidth <= 0.0 || pageHeight <= 0.0 || maxWidth <= 0 || maxHeight <= 0)
+        return {};
+
+    // 计算 PDF 页面宽高比
+    const double pdfAspectRatio = pageWidth / pageHeight;
+    const double areaAspectRatio = static_cast<double>(maxWidth) / maxHeight;
+
+    int renderWidth, renderHeight;
+    if (pdfAspectRatio > areaAspectRatio)
+    {
+        // PDF 更宽，以区域宽度为基准
+        renderWidth = maxWidth;
+        renderHeight = static_cast<int>(renderWidth / pdfAspectRatio);
+    }
+    else
+    {
+        // PDF 更高，以区域高度为基准
+        renderHeight = maxHeight;
+        renderWidth = static_cast<int>(renderHeight * pdfAspectRatio);
+    }
+
+    return { std::max(1, renderWidth), std::max(1, renderHeight) };
+}
+
+juce::Image renderPdfPageToImage(PopplerPage* pdfPage, int maxWidth, int maxHeight)
+{
+    if (pdfPage == nullptr)
+        return {};
+
+    // 获取 PDF 页面尺寸（以点为单位，1点=1/72英寸）
+    double pdfPageWidthPoints, pdfPageHeightPoints;
+    poppler_page_get_size(pdfPage, &pdfPageWidthPoints, &pdfPageHeightPoints);
+
+    const auto renderSize = getFittedPageSize(pdfPageWidthPoints, pdfPageHeightPoints, maxWidth, maxHeight);
+    if (renderSize.isEmpty())
+        return {};
+
+    // 创建 Cairo Surface
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, renderSize.getWidth(), renderSize.getHeight());
+    cairo_t* cr = cairo_create(surface);
+
+    // 设置抗锯齿
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_BEST);
+
+    // 设置缩放比例，使页面正好铺满渲染尺寸
+    const double scale = renderSize.getWidth() / pdfPageWidthPoints;
+    cairo_scale(cr, scale, scale);
+
+    // 渲染 PDF 页面到 Cairo Surface
+    {
+        PLAYER_TRACE_SCOPE("popplerRender", "page");
+        poppler_page_render(pdfPage, cr);
+    }
+
+    juce::Image image = convertCairoSurfaceToImage(surface);
+
+    // 清理 Cairo 资源
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+
+    return image;
+}
+
+juce::Image convertCairoSurfaceToImage(cairo_surface_t* surface)
+{
+    PLAYER_TRACE_SCOPE("pixelConversion", "page");
+
+    cairo_surface_flush(surface);  // 确保数据已刷新
+
+    const int width = cairo_image_surface_get_width(surface);
+    const int height = cairo_image_surface_get_height(surface);
+    const int stride = cairo_image_surface_get_stride(surface);
+    const unsigned char* data = cairo_image_surface_get_data(surface);
+
+    if (data == nullptr || width <= 0 || height <= 0)
+        return {};
+
+    juce::Image image(juce::Image::ARGB, width, height, false);
+    juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::writeOnly);
+    jassert(bitmap.pixelStride == 4);
+
+    for (int y = 0; y < height; ++y)
+        std::memcpy(bitmap.getLinePointer(y), data + static_cast<size_t>(y) * static_cast<size_t>(stride),
+                    static_cast<size_t>(width) * 4);
+
+    return image;
+}
@@ -0,0 +1,27 @@
+/*
+  ==============================================================================
+
+    PdfPageRenderer.h
+    Created: 19 Oct 2026 2:18:40pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <poppler/glib/poppler.h>  // Poppler C API
+#include <cairo/cairo.h>            // Cairo 库
+
+// 用 Poppler 打开 PDF 文件，失败时返回 nullptr 并输出原因。返回的文档由调用者 g_object_unref
+PopplerDocument* openPdfDocument(const juce::File& pdfFile);
+
+// 计算 PDF 页面按比例放入 maxWidth x maxHeight 区域后的尺寸（与显示时的居中缩放一致）
+juce::Rectangle<int> getFittedPageSize(double pageWidth, double pageHeight, int maxWidth, int maxHeight);
+
+// 用 Poppler 把一页 PDF 渲染成 JUCE 图像，图像按页面比例放入 maxWidth x maxHeight
+juce::Image renderPdfPageToImage(PopplerPage* pdfPage, int maxWidth, int maxHeight);
+
+// 把 Cairo ARGB32 surface 复制成 juce::Image::ARGB。
+// 两者都是本机字节序的预乘 0xAARRGGBB，所以可以逐行整块复制，不需要逐像素转换。
+juce::Image convertCairoSurfaceToImage(cairo_surface_t* surface);
@@ -0,0 +1,98 @@
+/*
+  ==============================================================================
+
+    PdfRendererWarmup.cpp
+    Created: 24 Oct 2026 10:31:15am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PdfRendererWarmup.h"
+#include "PdfPageRenderer.h"
+#include "Trace.h"
+#include <glib.h>                   // GLib 头文件，用于 GError 等类型
+
+#include <vector>
+
+PdfRendererWarmup::PdfRendererWarmup()
+    : juce::Thread("PDF renderer warmup")
+{
+}
+
+PdfRendererWarmup::~PdfRendererWarmup()
+{
+    cancelPendingUpdate();
+    // Poppler 的调用不能中断，最多等它渲染完这一页
+    stopThread(10000);
+}
+
+juce::MemoryBlock PdfRendererWarmup::createWarmupDocument()
+{
+    const juce::String content = "BT /F1 12 Tf 4 30 Td (Warm up) Tj ET";
+    const juce::StringArray objects {
+        "<< /Type /Catalog /Pages 2 0 R >>",
+        "<< /Type /Pages /Kids [3 0 R] /Count 1 >>",
+        "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 72 72] /Resources << /Font << /F1 4 0 R >> >> /Contents 5 0 R >>",
+        "<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica >>",
+        "<< /Length " + juce::String(content.length()) + " >>\nstream\n" + content + "\nendstream"
+    };
+
+    juce::MemoryOutputStream out;
+    out << "%PDF-1.4\n";
+
+    std::vector<juce::int64> offsets;
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        offsets.push_back(out.getPosition());
+        out << juce::String(i + 1) << " 0 obj\n" << objects[i] << "\nendobj\n";
+    }
+
+    // 每条交叉引用正好 20 字节
+    const juce::int64 xrefOffset = out.getPosition();
+    out << "xref\n0 " << juce::String(objects.size() + 1) << "\n";
+    out << "0000000000 65535 f \n";
+    for (auto offset : offsets)
+        out << juce::String(offset).paddedLeft('0', 10) << " 00000 n \n";
+
+    out << "trailer\n<< /Size " << juce::String(objects.size() + 1) << " /Root 1 0 R >>\n"
+        << "startxref\n" << juce::String(xrefOffset) << "\n%%EOF\n";
+
+    return out.getMemoryBlock();
+}
+
+void PdfRendererWarmup::run()
+{
+    PLAYER_TRACE_SCOPE("pdfWarmup", "startup");
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+
+    // openPdfDocument 只接受文件，和正常打开走同一条路径
+    const juce::MemoryBlock pdfData = createWarmupDocument();
+    juce::TemporaryFile tempFile(".pdf");
+    if (!tempFile.getFile().replaceWithData(pdfData.getData(), pdfData.getSize()))
+    {
+        DBG("Failed to write PDF warmup document");
+    }
+    else if (PopplerDocument* document = openPdfDocument(tempFile.getFile()))
+    {
+        if (PopplerPage* page = poppler_document_get_page(document, 0))
+        {
+            // 渲染文字时才会查找字体
+            renderPdfPageToImage(page, 72, 72);
+            g_object_unref(page);
+        }
+
+        g_object_unref(document);
+    }
+
+    elapsedMs = juce::Time::getMillisecondCounterHiRes() - startMs;
+    triggerAsyncUpdate();
+}
+
+void PdfRendererWarmup::handleAsyncUpdate()
+{
+    finished = true;
+
+    if (onFinished)
+        onFinished(elapsedMs.load());
+}
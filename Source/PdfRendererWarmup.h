@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    PdfRendererWarmup.h
+    Created: 24 Oct 2026 10:31:15am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <atomic>
+#include <functional>
+
+// 启动后在后台打开并渲染一个很小的 PDF（文字用没有嵌入的 Helvetica），
+// 让 Poppler、Cairo 和 fontconfig 的初始化（第一次扫描字体目录可能要几百毫秒）在用户拖入 PDF 之前完成。
+// 只用自己的文档，不影响其它线程。完成后通过 AsyncUpdater 在消息线程调用 onFinished。
+class PdfRendererWarmup : private juce::Thread,
+                          private juce::AsyncUpdater
+{
+public:
+    PdfRendererWarmup();
+    ~PdfRendererWarmup() override;
+
+    void start() { startThread(juce::Thread::Priority::low); }
+    bool isFinished() const { return finished; }
+
+    // 参数是后台线程花的时间（毫秒）
+    std::function<void(double milliseconds)> onFinished;
+
+    // 一页 72 x 72 点、写着一行文字的 PDF，交叉引用表的偏移都是算好的（Poppler 不会报语法错误）
+    static juce::MemoryBlock createWarmupDocument();
+
+private:
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    std::atomic<double> elapsedMs { 0.0 };
+    bool finished = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PdfRendererWarmup)
+};
@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    PiecePreloader.cpp
+    Created: 19 Oct 2026 4:26:18pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "PiecePreloader.h"
+#include "PdfPageRenderer.h"
+#include "PageRasterDiskCache.h"
+#include "MarkerFile.h"
+#include <glib.h>                   // GLib 头文件，用于 GError 等类型
+
+PreparedPiece::~PreparedPiece()
+{
+    if (pdfDocument != nullptr)
+        g_object_unref(pdfDocument);
+}
+
+//==============================================================================
+PiecePreloader::PiecePreloader(juce::AudioFormatManager& formatManagerToUse, juce::AudioThumbnailCache& thumbnailCacheToUse,
+                               AudioDeckPlayer& playerToPrepareFor)
+    : formatManager(formatManagerToUse),
+      thumbnailCache(thumbnailCacheToUse),
+      player(playerToPrepareFor)
+{
+    worker.process = [this](const Request& request, int generation) { process(request, generation); };
+    worker.onResult = [this](std::unique_ptr<PreparedPiece> piece)
+    {
+        preparedPiece = std::move(piece);
+
+        if (preparedPiece != nullptr && onPieceReady)
+            onPieceReady(preparedPiece->entry);
+    };
+    worker.start();
+}
+
+PiecePreloader::~PiecePreloader()
+{
+    worker.stop();
+}
+
+void PiecePreloader::preload(const SetlistEntry& entry, int width, int height)
+{
+    preparedPiece.reset();
+    worker.request({ entry, width, height });
+}
+
+void PiecePreloader::cancel()
+{
+    worker.cancel();
+    preparedPiece.reset();
+}
+
+std::unique_ptr<PreparedPiece> PiecePreloader::takePreparedPiece(const SetlistEntry& entry)
+{
+    if (preparedPiece != nullptr && preparedPiece->entry == entry)
+        return std::move(preparedPiece);
+
+    return nullptr;
+}
+
+size_t PiecePreloader::getMemoryUsage() const
+{
+    if (preparedPiece == nullptr)
+        return 0;
+
+    return preparedPiece->memoryUsed + (preparedPiece->deck != nullptr ? preparedPiece->deck->getMemoryUsage() : 0);
+}
+
+bool PiecePreloader::buildThumbnail(juce::AudioFormatReader& reader, const juce::File& audioFile, int generation)
+{
+    // 在后台读完整个文件生成波形峰值，存进共享的 AudioThumbnailCache，
+    // 之后消息线程用同一个文件 setSource 时会直接命中缓存
+    juce::AudioThumbnail thumbnail(512, formatManager, thumbnailCache);
+    thumbnail.reset(static_cast<int>(reader.numChannels), reader.sampleRate, reader.lengthInSamples);
+
+    constexpr int blockSize = 65536;
+    juce::AudioBuffer<float> buffer(static_cast<int>(reader.numChannels), blockSize);
+
+    for (juce::int64 start = 0; start < reader.lengthInSamples; start += blockSize)
+    {
+        if (worker.isStale(generation))
+            return false;
+
+        const int numSamples = static_cast<int>(std::min<juce::int64>(blockSize, reader.lengthInSamples - start));
+        reader.read(&buffer, 0, numSamples, start, true, true);
+        thumbnail.addBlock(start, buffer, 0, numSamples);
+    }
+
+    thumbnailCache.storeThumb(thumbnail, juce::FileInputSource(audioFile).hashCode());
+    return true;
+}
+
+void PiecePreloader::process(const Request& request, int generation)
+{
+    const SetlistEntry& entry = request.entry;
+    const int width = request.pageWidth, height = request.pageHeight;
+
+    auto piece = std::make_unique<PreparedPiece>();
+    piece->entry = entry;
+
+    // 打开音频并识别格式，生成波形峰值，再创建并 prepare 好 AudioDeck
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(entry.audioFile));
+    if (reader == nullptr)
+    {
+        DBG("Preload failed to open audio: " + entry.audioFile.getFullPathName());
+        return;
+    }
+
+    if (!buildThumbnail(*reader, entry.audioFile, generation))
+        return;
+
+    piece->deck = AudioDeck::create(std::move(reader), player.getPreparedBlockSize(), player.getPreparedSampleRate());
+    piece->deck->file = entry.audioFile;
+
+    // 打开 PDF，在内存预算内渲染前几页
+    if (entry.pdfFile.existsAsFile())
+    {
+        piece->pdfDocument = openPdfDocument(entry.pdfFile);
+
+        if (piece->pdfDocument != nullptr && width > 0 && height > 0)
+        {
+            const int numPages = std::min(maxPreloadedPages, poppler_document_get_n_pages(piece->pdfDocument));
+            const size_t budget = memoryBudget.load();
+
+            PageRasterDiskCache diskCache;
+            diskCache.setDocument(entry.pdfFile);
+
+            for (int i = 0; i < numPages && !worker.isStale(generation); ++i)
+            {
+                const size_t pageBytes = static_cast<size_t>(width) * static_cast<size_t>(height) * 4;
+                if (piece->memoryUsed + pageBytes > budget)
+                    break;
+
+                // 磁盘缓存里有的页直接解码，没有的再渲染
+                auto image = diskCache.loadPage(i, width, height);
+                if (!image.isValid())
+                {
+                    PopplerPage* pdfPage = poppler_document_get_page(piece->pdfDocument, i);
+                    if (pdfPage == nullptr)
+                        break;
+
+                    image = renderPdfPageToImage(pdfPage, width, height);
+                    g_object_unref(pdfPage);
+                }
+
+                piece->memoryUsed += static_cast<size_t>(image.getWidth()) * static_cast<size_t>(image.getHeight()) * 4;
+                piece->firstPages.push_back(image);
+            }
+        }
+    }
+
+    if (entry.markersFile.existsAsFile())
+        piece->hasMarkers = readMarkers(entry.markersFile, piece->markers);
+
+    worker.emit(generation, std::move(piece));
+}
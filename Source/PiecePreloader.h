@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    PiecePreloader.h
+    Created: 19 Oct 2026 4:26:18pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <poppler/glib/poppler.h>  // Poppler C API
+#include "Setlist.h"
+#include "AudioDeckPlayer.h"
+#include "Marker.h"
+#include "LatestRequestWorker.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 后台准备好的一首曲子，切换时直接交给 MainComponent 使用
+struct PreparedPiece
+{
+    PreparedPiece() = default;
+    ~PreparedPiece();
+
+    SetlistEntry entry;
+    std::unique_ptr<AudioDeck> deck;                  // 已经打开、识别好格式并 prepare 好的音频
+    PopplerDocument* pdfDocument = nullptr;           // 已经打开的 PDF 文档（交出后置空）
+    std::vector<juce::Image> firstPages;              // 预先渲染的前几页，下标就是页码
+    std::vector<Marker> markers;                      // 从 .markers 读取的标记
+    bool hasMarkers = false;
+    size_t memoryUsed = 0;                            // 预渲染页面占用的字节数
+
+    JUCE_DECLARE_NON_COPYABLE(PreparedPiece)
+};
+
+// 在后台线程准备曲目单中的下一首：打开音频、生成波形缩略图（存入 AudioThumbnailCache）、
+// 打开 PDF 并在内存预算内渲染前几页。同一时间只准备一首。
+class PiecePreloader
+{
+public:
+    PiecePreloader(juce::AudioFormatManager& formatManagerToUse, juce::AudioThumbnailCache& thumbnailCacheToUse,
+                   AudioDeckPlayer& playerToPrepareFor);
+    ~PiecePreloader();
+
+    // 开始准备这一首，会放弃之前没完成或没取走的结果
+    void preload(const SetlistEntry& entry, int pageWidth, int pageHeight);
+
+    // 取走准备好的曲子；还没准备好或不是这一首时返回 nullptr
+    std::unique_ptr<PreparedPiece> takePreparedPiece(const SetlistEntry& entry);
+
+    void cancel();
+
+    // 预渲染页面的内存上限
+    void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+
+    // 准备好还没取走的曲子占用的内存：预渲染页面和音频缓冲
+    size_t getMemoryUsage() const;
+
+    // 准备完成后在消息线程上调用
+    std::function<void(const SetlistEntry&)> onPieceReady;
+
+private:
+    struct Request
+    {
+        SetlistEntry entry;
+        int pageWidth = 0, pageHeight = 0;
+    };
+
+    void process(const Request& request, int generation);
+    bool buildThumbnail(juce::AudioFormatReader& reader, const juce::File& audioFile, int generation);
+
+    juce::AudioFormatManager& formatManager;
+    juce::AudioThumbnailCache& thumbnailCache;
+    AudioDeckPlayer& player;
+
+    // 只在消息线程访问
+    std::unique_ptr<PreparedPiece> preparedPiece;
+
+    LatestRequestWorker<Request, std::unique_ptr<PreparedPiece>> worker { "Setlist preloader", juce::Thread::Priority::low, 4000 };
+
+    std::atomic<size_t> memoryBudget { 96 * 1024 * 1024 };
+    static constexpr int maxPreloadedPages = 4;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PiecePreloader)
+};
@@ -0,0 +1,495 @@
+/*
+  ==============================================================================
+
+    ProjectFile.cpp
+    Created: 22 Oct 2026 10:12:45am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "ProjectFile.h"
+
+#include <cstring>
+#include <functional>
+
+namespace
+{
+    constexpr juce::uint32 makeSectionType(char a, char b, char c, char d)
+    {
+        return static_cast<juce::uint32>(static_cast<unsigned char>(a))
+             | (static_cast<juce::uint32>(static_cast<unsigned char>(b)) << 8)
+             | (static_cast<juce::uint32>(static_cast<unsigned char>(c)) << 16)
+             | (static_cast<juce::uint32>(static_cast<unsigned char>(d)) << 24);
+    }
+
+    constexpr auto sourcesSection = makeSectionType('S', 'R', 'C', 'S');
+    constexpr auto markersSection = makeSectionType('M', 'R', 'K', 'S');
+    constexpr auto tempoSection = makeSectionType('T', 'M', 'P', 'O');
+    constexpr auto analysisSection = makeSectionType('A', 'N', 'L', 'S');
+    constexpr auto annotationsSection = makeSectionType('A', 'N', 'N', 'O');
+    constexpr auto peaksSection = makeSectionType('P', 'E', 'A', 'K');
+    constexpr auto pageSizesSection = makeSectionType('P', 'G', 'S', 'Z');  // 早先保存的每页尺寸，读到时跳过
+    constexpr auto latencySection = makeSectionType('P', 'T', 'L', 'T');
+
+    constexpr const char* magic = "PLPJ";
+    constexpr size_t headerSize = 16;        // 魔数、版本、段数、保留
+    constexpr size_t sectionEntrySize = 24;  // 类型、保留、偏移（64 位）、长度（64 位）
+    constexpr size_t sectionAlignment = 64;
+
+    size_t alignOffset(size_t offset)
+    {
+        return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+    }
+
+    void writeReference(juce::OutputStream& out, const ProjectFileReference& reference)
+    {
+        out.writeString(reference.fullPath);
+        out.writeString(reference.relativePath);
+        out.writeInt64(reference.size);
+        out.writeInt64(reference.modificationTime);
+        out.writeInt64(static_cast<juce::int64>(reference.contentHash));
+    }
+
+    ProjectFileReference readReference(juce::InputStream& in)
+    {
+        ProjectFileReference reference;
+        reference.fullPath = in.readString();
+        reference.relativePath = in.readString();
+        reference.size = in.readInt64();
+        reference.modificationTime = in.readInt64();
+        reference.contentHash = static_cast<juce::uint64>(in.readInt64());
+        return reference;
+    }
+
+    void writeTimes(juce::OutputStream& out, const std::vector<double>& times)
+    {
+        out.writeInt(static_cast<int>(times.size()));
+        for (double time : times)
+            out.writeDouble(time);
+    }
+
+    bool readTimes(juce::InputStream& in, std::vector<double>& times)
+    {
+        const int count = in.readInt();
+        if (count < 0 || count > in.getNumBytesRemaining() / 8)
+            return false;
+
+        times.resize(static_cast<size_t>(count));
+        for (auto& time : times)
+            time = in.readDouble();
+        return true;
+    }
+}
+
+//==============================================================================
+ProjectFileReference ProjectFileReference::create(const juce::File& file, const juce::File& projectFile)
+{
+    ProjectFileReference reference;
+    if (!file.existsAsFile())
+        return reference;
+
+    reference.fullPath = file.getFullPathName();
+    reference.relativePath = file.getRelativePathFrom(projectFile.getParentDirectory());
+    reference.size = file.getSize();
+    reference.modificationTime = file.getLastModificationTime().toMilliseconds();
+    reference.contentHash = computeContentHash(file);
+    return reference;
+}
+
+juce::uint64 ProjectFileReference::computeContentHash(const juce::File& file)
+{
+    juce::FileInputStream in(file);
+    if (!in.openedOk())
+        return 0;
+
+    // 64 位 FNV-1a，只用来认出同一个文件，不用于安全用途
+    juce::uint64 hash = 14695981039346656037ull;
+    auto addBytes = [&hash](const juce::uint8* bytes, size_t numBytes)
+    {
+        for (size_t i = 0; i < numBytes; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    const juce::int64 totalSize = in.getTotalLength();
+    addBytes(reinterpret_cast<const juce::uint8*>(&totalSize), sizeof(totalSize));
+
+    // 开头和结尾各一段（文件头、尾部的索引），中间再均匀取几小段；小文件整个读
+    constexpr int edgeChunkSize = 64 * 1024;
+    constexpr int middleChunkSize = 4 * 1024;
+    constexpr int numMiddleChunks = 16;
+
+    std::vector<std::pair<juce::int64, int>> chunks;
+    if (totalSize <= 2 * edgeChunkSize + numMiddleChunks * middleChunkSize)
+    {
+        chunks.emplace_back(0, static_cast<int>(totalSize));
+    }
+    else
+    {
+        chunks.emplace_back(0, edgeChunkSize);
+        for (int i = 1; i <= numMiddleChunks; ++i)
+            chunks.emplace_back(totalSize * i / (numMiddleChunks + 1), middleChunkSize);
+        chunks.emplace_back(totalSize - edgeChunkSize, edgeChunkSize);
+    }
+
+    juce::HeapBlock<juce::uint8> buffer(static_cast<size_t>(std::max(edgeChunkSize, chunks.front().second)));
+    for (const auto& [offset, length] : chunks)
+    {
+        if (!in.setPosition(offset))
+            return 0;
+
+        const int numRead = in.read(buffer.get(), length);
+        if (numRead > 0)
+            addBytes(buffer.get(), static_cast<size_t>(numRead));
+    }
+
+    return hash;
+}
+
+bool ProjectFileReference::matches(const juce::File& candidate) const
+{
+    if (!candidate.existsAsFile() || candidate.getSize() != size)
+        return false;
+
+    // 大小和修改时间都没变时不再读整个文件
+    if (candidate.getLastModificationTime().toMilliseconds() == modificationTime)
+        return true;
+
+    return computeContentHash(candidate) == contentHash;
+}
+
+juce::File ProjectFileReference::resolve(const juce::File& projectFile) const
+{
+    if (!isValid())
+        return {};
+
+    const auto directory = projectFile.getParentDirectory();
+    juce::Array<juce::File> candidates;
+
+    if (juce::File::isAbsolutePath(fullPath))
+        candidates.add(juce::File(fullPath));
+    if (relativePath.isNotEmpty())
+        candidates.addIfNotAlreadyThere(directory.getChildFile(relativePath));
+    candidates.addIfNotAlreadyThere(directory.getChildFile(juce::File::createFileWithoutCheckingPath(fullPath).getFileName()));
+
+    for (const auto& candidate : candidates)
+        if (matches(candidate))
+            return candidate;
+
+    // 被改名了：在工程目录里找大小相同、内容一样的文件
+    for (const auto& candidate : directory.findChildFiles(juce::File::findFiles, false))
+        if (!candidates.contains(candidate) && candidate.getSize() == size && computeContentHash(candidate) == contentHash)
+            return candidate;
+
+    DBG("Referenced file not found: " + fullPath);
+    return {};
+}
+
+//==============================================================================
+bool ProjectFile::save(const juce::File& file, const ProjectData& data, const juce::AudioThumbnail* thumbnail)
+{
+    if (file == juce::File{})
+    {
+        DBG("Invalid file provided for saving the project.");
+        return false;
+    }
+
+    // 先把每一段写进内存
+    std::vector<std::pair<juce::uint32, juce::MemoryBlock>> sections;
+    auto addSection = [&sections](juce::uint32 type, const std::function<void(juce::OutputStream&)>& writeContent)
+    {
+        juce::MemoryOutputStream out;
+        writeContent(out);
+        sections.emplace_back(type, out.getMemoryBlock());
+    };
+
+    addSection(sourcesSection, [&data](juce::OutputStream& out)
+    {
+        writeReference(out, data.audio);
+        writeReference(out, data.pdf);
+        out.writeDouble(data.audioLengthSeconds);
+        out.writeInt(data.numPages);
+    });
+
+    addSection(markersSection, [&data](juce::OutputStream& out)
+    {
+        out.writeInt(static_cast<int>(data.markers.size()));
+        for (const auto& marker : data.markers)
+        {
+            out.writeDouble(marker.position);
+            out.writeByte(static_cast<char>(marker.action));
+            out.writeInt(marker.targetPage);
+        }
+    });
+
+    addSection(tempoSection, [&data](juce::OutputStream& out)
+    {
+        out.writeBool(data.tempoMapFromFile);
+        out.writeInt(static_cast<int>(data.tempoSegments.size()));
+        for (const auto& segment : data.tempoSegments)
+        {
+            out.writeDouble(segment.startTime);
+            out.writeDouble(segment.bpm);
+            out.writeInt(segment.beatsPerBar);
+        }
+    });
+
+    if (data.hasAnalysis)
+    {
+        addSection(analysisSection, [&data](juce::OutputStream& out)
+        {
+            out.writeBool(data.barsShown);
+            out.writeDouble(data.analysis.bpm);
+            out.writeInt(data.analysis.beatsPerBar);
+            writeTimes(out, data.analysis.beatTimes);
+            writeTimes(out, data.analysis.barTimes);
+            writeTimes(out, data.analysis.onsetTimes);
+        });
+    }
+
+    addSection(annotationsSection, [&data](juce::OutputStream& out)
+    {
+        out.writeInt(static_cast<int>(data.annotations.size()));
+        for (const auto& annotation : data.annotations)
+        {
+            out.writeInt(annotation.page);
+            out.writeFloat(annotation.area.getX());
+            out.writeFloat(annotation.area.getY());
+            out.writeFloat(annotation.area.getWidth());
+            out.writeFloat(annotation.area.getHeight());
+            out.writeString(annotation.text);
+        }
+    });
+
+    if (!data.pageTurnLatencies.empty())
+    {
+        addSection(latencySection, [&data](juce::OutputStream& out)
+        {
+            out.writeInt(static_cast<int>(data.pageTurnLatencies.size()));
+            for (const auto& sample : data.pageTurnLatencies)
+            {
+                out.writeDouble(sample.markerTime);
+                out.writeInt(sample.page);
+                out.writeDouble(sample.detectionMs);
+                out.writeDouble(sample.renderMs);
+                out.writeDouble(sample.paintMs);
+            }
+        });
+    }
+
+    if (thumbnail != nullptr && thumbnail->isFullyLoaded() && thumbnail->getTotalLength() > 0.0)
+        addSection(peaksSection, [thumbnail](juce::OutputStream& out) { thumbnail->saveTo(out); });
+
+    // 写到临时文件，避免保存失败时破坏原来的工程
+    juce::TemporaryFile temporaryFile(file);
+    {
+        juce::FileOutputStream out(temporaryFile.getFile());
+        if (!out.openedOk())
+        {
+            DBG("Failed to open file for writing: " + temporaryFile.getFile().getFullPathName());
+            return false;
+        }
+
+        out.write(magic, 4);
+        out.writeInt(static_cast<int>(currentVersion));
+        out.writeInt(static_cast<int>(sections.size()));
+        out.writeInt(0);
+
+        size_t offset = alignOffset(headerSize + sections.size() * sectionEntrySize);
+        for (const auto& [type, block] : sections)
+        {
+            out.writeInt(static_cast<int>(type));
+            out.writeInt(0);
+            out.writeInt64(static_cast<juce::int64>(offset));
+            out.writeInt64(static_cast<juce::int64>(block.getSize()));
+            offset = alignOffset(offset + block.getSize());
+        }
+
+        for (const auto& section : sections)
+        {
+            const auto padding = static_cast<size_t>(alignOffset(static_cast<size_t>(out.getPosition())) - static_cast<size_t>(out.getPosition()));
+            out.writeRepeatedByte(0, padding);
+            out.write(section.second.getData(), section.second.getSize());
+        }
+
+        out.flush();
+        if (out.getStatus().failed())
+        {
+            DBG("Failed to write project: " + out.getStatus().getErrorMessage());
+            return false;
+        }
+    }
+
+    return temporaryFile.overwriteTargetFileWithTemporary();
+}
+
+bool ProjectFile::open(const juce::File& file)
+{
+    projectFile = file;
+    mappedFile.reset();
+    data = ProjectData();
+    peaksData = nullptr;
+    peaksSize = 0;
+
+    auto mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+    const auto* base = static_cast<const char*>(mapped->getData());
+    const size_t totalSize = mapped->getSize();
+
+    if (base == nullptr || totalSize < headerSize || std::memcmp(base, magic, 4) != 0)
+    {
+        DBG("Not a project file: " + file.getFullPathName());
+        return false;
+    }
+
+    const auto version = juce::ByteOrder::littleEndianInt(base + 4);
+    if (version == 0 || version > currentVersion)
+    {
+        DBG("Unsupported project version " + juce::String(version) + ": " + file.getFullPathName());
+        return false;
+    }
+
+    const auto numSections = juce::ByteOrder::littleEndianInt(base + 8);
+    if (numSections > (totalSize - headerSize) / sectionEntrySize)
+    {
+        DBG("Corrupt project section table: " + file.getFullPathName());
+        return false;
+    }
+
+    for (juce::uint32 i = 0; i < numSections; ++i)
+    {
+        const char* entry = base + headerSize + i * sectionEntrySize;
+        const auto type = juce::ByteOrder::littleEndianInt(entry);
+        const auto offset = juce::ByteOrder::littleEndianInt64(entry + 8);
+        const auto size = juce::ByteOrder::littleEndianInt64(entry + 16);
+
+        if (offset > totalSize || size > totalSize - offset || !readSection(type, base + offset, static_cast<size_t>(size)))
+        {
+            DBG("Corrupt project section " + juce::String(i) + ": " + file.getFullPathName());
+            data = ProjectData();
+            peaksData = nullptr;
+            peaksSize = 0;
+            return false;
+        }
+    }
+
+    mappedFile = std::move(mapped);
+    return true;
+}
+
+bool ProjectFile::readSection(juce::uint32 type, const char* sectionData, size_t sectionSize)
+{
+    juce::MemoryInputStream in(sectionData, sectionSize, false);
+
+    if (type == sourcesSection)
+    {
+        data.audio = readReference(in);
+        data.pdf = readReference(in);
+        data.audioLengthSeconds = in.readDouble();
+        data.numPages = in.readInt();
+    }
+    else if (type == markersSection)
+    {
+        const int count = in.readInt();
+        if (count < 0 || count > in.getNumBytesRemaining() / 13)
+            return false;
+
+        data.markers.reserve(static_cast<size_t>(count));
+        for (int i = 0; i < count; ++i)
+        {
+            Marker marker(in.readDouble());
+            const int action = static_cast<unsigned char>(in.readByte());
+            marker.action = action <= static_cast<int>(MarkerAction::hold) ? static_cast<MarkerAction>(action) : MarkerAction::turn;
+            marker.targetPage = in.readInt();
+            data.markers.push_back(marker);
+        }
+    }
+    else if (type == tempoSection)
+    {
+        data.tempoMapFromFile = in.readBool();
+        const int count = in.readInt();
+        if (count < 0 || count > in.getNumBytesRemaining() / 20)
+            return false;
+
+        for (int i = 0; i < count; ++i)
+        {
+            TempoSegment segment;
+            segment.startTime = in.readDouble();
+            segment.bpm = in.readDouble();
+            segment.beatsPerBar = in.readInt();
+            data.tempoSegments.push_back(segment);
+        }
+    }
+    else if (type == analysisSection)
+    {
+        data.hasAnalysis = true;
+        data.barsShown = in.readBool();
+        data.analysis.bpm = in.readDouble();
+        data.analysis.beatsPerBar = in.readInt();
+        if (!readTimes(in, data.analysis.beatTimes) || !readTimes(in, data.analysis.barTimes) || !readTimes(in, data.analysis.onsetTimes))
+            return false;
+    }
+    else if (type == annotationsSection)
+    {
+        const int count = in.readInt();
+        if (count < 0 || count > in.getNumBytesRemaining() / 21)
+            return false;
+
+        for (int i = 0; i < count; ++i)
+        {
+            ProjectAnnotation annotation;
+            annotation.page = in.readInt();
+            const float x = in.readFloat();
+            const float y = in.readFloat();
+            const float width = in.readFloat();
+            const float height = in.readFloat();
+            annotation.area = { x, y, width, height };
+            annotation.text = in.readString();
+            data.annotations.push_back(annotation);
+        }
+    }
+    else if (type == latencySection)
+    {
+        const int count = in.readInt();
+        if (count < 0 || count > in.getNumBytesRemaining() / 36)
+            return false;
+
+        data.pageTurnLatencies.reserve(static_cast<size_t>(count));
+        for (int i = 0; i < count; ++i)
+        {
+            PageTurnSample sample;
+            sample.markerTime = in.readDouble();
+            sample.page = in.readInt();
+            sample.detectionMs = in.readDouble();
+            sample.renderMs = in.readDouble();
+            sample.paintMs = in.readDouble();
+            data.pageTurnLatencies.push_back(sample);
+        }
+    }
+    else if (type == peaksSection)
+    {
+        peaksData = sectionData;
+        peaksSize = sectionSize;
+    }
+    else if (type == pageSizesSection)
+    {
+        // 页面尺寸打开时从 PDF 本身就能拿到，不再使用
+    }
+    else
+    {
+        // 新版本增加的段，旧版本跳过
+        DBG("Skipping unknown project section");
+    }
+
+    return true;
+}
+
+std::unique_ptr<juce::InputStream> ProjectFile::createPeaksStream() const
+{
+    if (peaksData == nullptr)
+        return nullptr;
+
+    return std::make_unique<juce::MemoryInputStream>(peaksData, peaksSize, false);
+}
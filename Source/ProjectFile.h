@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    ProjectFile.h
+    Created: 22 Oct 2026 10:12:45am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Marker.h"
+#include "TempoMap.h"
+#include "BeatTracker.h"
+#include "PageTurnLatency.h"
+
+#include <memory>
+#include <vector>
+
+// 工程引用的一个文件：保存时的路径、大小、修改时间和内容哈希。
+// 文件被移动或改名后，按哈希在工程文件旁边重新找到它。
+// 哈希只读文件开头、结尾和中间均匀分布的几小段（再加上文件大小），多大的文件都只读几百 KB，
+// 可以直接在消息线程上算；它只用来认出同一个文件，不是完整的内容校验。
+struct ProjectFileReference
+{
+    juce::String fullPath;
+    juce::String relativePath;  // 相对于工程文件所在的目录
+    juce::int64 size = 0;
+    juce::int64 modificationTime = 0;
+    juce::uint64 contentHash = 0;
+
+    bool isValid() const { return size > 0; }
+
+    static ProjectFileReference create(const juce::File& file, const juce::File& projectFile);
+    static juce::uint64 computeContentHash(const juce::File& file);
+
+    // 依次尝试原路径、相对路径、工程目录下的同名文件，最后在工程目录里按大小和哈希查找；找不到返回空文件
+    juce::File resolve(const juce::File& projectFile) const;
+
+private:
+    bool matches(const juce::File& candidate) const;
+};
+
+// PDF 上的一条注释：页码和页面内的区域（0..1 的相对坐标）
+struct ProjectAnnotation
+{
+    int page = 0;
+    juce::Rectangle<float> area;
+    juce::String text;
+};
+
+// 工程里除了可映射段以外的全部内容
+struct ProjectData
+{
+    ProjectFileReference audio, pdf;
+    double audioLengthSeconds = 0.0;
+    int numPages = 0;
+
+    std::vector<Marker> markers;  // 包括每个标记的翻页动作和目标页
+    std::vector<TempoSegment> tempoSegments;
+    bool tempoMapFromFile = false;
+
+    BeatAnalysis analysis;
+    bool hasAnalysis = false;
+    bool barsShown = false;
+
+    std::vector<ProjectAnnotation> annotations;
+
+    // 演奏时测到的翻页延迟，随工程一起保存以便换机器比较
+    std::vector<PageTurnSample> pageTurnLatencies;
+};
+
+// 二进制工程文件（.playerproj），所有数值都是小端：
+//   头部：魔数 "PLPJ"、版本号、段数，然后是段表（每段：类型、偏移、长度）；
+//   每段从 64 字节对齐的位置开始。标记、速度图、分析结果和注释的段读入 ProjectData；
+//   波形峰值（AudioThumbnail 的数据）是可选的段，打开时整个文件只做内存映射，
+//   这一段直接在映射的内存上读取，不复制。不认识的段会被跳过，版本号比当前新的文件拒绝打开。
+class ProjectFile
+{
+public:
+    ProjectFile() = default;
+
+    // 写到临时文件，成功后再替换目标文件；thumbnail 没有完全生成时不保存峰值段
+    static bool save(const juce::File& file, const ProjectData& data, const juce::AudioThumbnail* thumbnail);
+
+    bool open(const juce::File& file);
+    bool isOpen() const { return mappedFile != nullptr; }
+    const juce::File& getFile() const { return projectFile; }
+    const ProjectData& getData() const { return data; }
+
+    // 映射的波形峰值段，可以交给 AudioThumbnail::loadFrom；没有时返回 nullptr
+    std::unique_ptr<juce::InputStream> createPeaksStream() const;
+    bool hasPeaks() const { return peaksSize > 0; }
+
+    static constexpr juce::uint32 currentVersion = 1;
+    static constexpr const char* fileExtension = ".playerproj";
+
+private:
+    bool readSection(juce::uint32 type, const char* sectionData, size_t sectionSize);
+
+    juce::File projectFile;
+    std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+    ProjectData data;
+
+    const char* peaksData = nullptr;
+    size_t peaksSize = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectFile)
+};
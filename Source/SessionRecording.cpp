@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+
+    SessionRecording.cpp
+    Created: 23 Oct 2026 7:13:36pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "SessionRecording.h"
+#include "MarkerFile.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr const char* typeNames[] = { "drop", "play", "pause", "seek", "markers", "page" };
+}
+
+juce::var SessionEvent::toVar() const
+{
+    auto* object = new juce::DynamicObject();
+    object->setProperty("t", time);
+    object->setProperty("type", typeNames[static_cast<int>(type)]);
+    object->setProperty("pos", audioPosition);
+
+    switch (type)
+    {
+        case Type::filesDropped:
+        {
+            juce::Array<juce::var> paths;
+            for (const auto& file : files)
+                paths.add(file);
+            object->setProperty("files", paths);
+            break;
+        }
+        case Type::seek:
+            object->setProperty("to", seekPosition);
+            break;
+        case Type::markers:
+        {
+            // 和 .markers 文件的一行相同
+            juce::Array<juce::var> lines;
+            for (const auto& marker : markers)
+                lines.add(formatMarkerLine(marker));
+            object->setProperty("markers", lines);
+            break;
+        }
+        case Type::page:
+            object->setProperty("page", page);
+            break;
+        case Type::play:
+        case Type::pause:
+            break;
+    }
+
+    return juce::var(object);
+}
+
+bool SessionEvent::fromVar(const juce::var& value, SessionEvent& event)
+{
+    const auto typeName = value["type"].toString();
+    const auto* found = std::find_if(std::begin(typeNames), std::end(typeNames),
+                                     [&typeName](const char* name) { return typeName == name; });
+    if (found == std::end(typeNames))
+        return false;
+
+    event = SessionEvent();
+    event.type = static_cast<Type>(found - std::begin(typeNames));
+    event.time = value["t"];
+    event.audioPosition = value["pos"];
+    event.seekPosition = value["to"];
+    event.page = value["page"];
+
+    if (const auto* paths = value["files"].getArray())
+        for (const auto& path : *paths)
+            event.files.add(path.toString());
+
+    if (const auto* lines = value["markers"].getArray())
+        for (const auto& line : *lines)
+            event.markers.push_back(parseMarkerLine(line.toString()));
+
+    return true;
+}
+
+//==============================================================================
+bool SessionRecorder::start(const juce::File& file)
+{
+    stream.reset();
+    file.deleteFile();
+
+    auto newStream = std::make_unique<juce::FileOutputStream>(file);
+    if (!newStream->openedOk())
+    {
+        DBG("Failed to open session file for recording: " + file.getFullPathName());
+        return false;
+    }
+
+    auto* header = new juce::DynamicObject();
+    header->setProperty("format", "player-session");
+    header->setProperty("version", formatVersion);
+    header->setProperty("created", juce::Time::getCurrentTime().toISO8601(true));
+    *newStream << juce::JSON::toString(juce::var(header), true) << "\n";
+    newStream->flush();
+
+    stream = std::move(newStream);
+    startTime = juce::Time::getMillisecondCounterHiRes();
+    pausedSince = -1.0;
+    pausedTotal = 0.0;
+    return true;
+}
+
+void SessionRecorder::setClockPaused(bool shouldBePaused)
+{
+    const double now = juce::Time::getMillisecondCounterHiRes();
+
+    if (shouldBePaused && pausedSince < 0.0)
+    {
+        pausedSince = now;
+    }
+    else if (!shouldBePaused && pausedSince >= 0.0)
+    {
+        pausedTotal += now - pausedSince;
+        pausedSince = -1.0;
+    }
+}
+
+double SessionRecorder::getClockTime() const
+{
+    const double now = pausedSince >= 0.0 ? pausedSince : juce::Time::getMillisecondCounterHiRes();
+    return now - startTime - pausedTotal;
+}
+
+void SessionRecorder::record(SessionEvent event)
+{
+    if (stream == nullptr)
+        return;
+
+    event.time = getClockTime();
+    *stream << juce::JSON::toString(event.toVar(), true) << "\n";
+    stream->flush();
+}
+
+bool SessionRecorder::readEvents(const juce::File& file, std::vector<SessionEvent>& events)
+{
+    juce::StringArray lines;
+    file.readLines(lines);
+    lines.removeEmptyStrings();
+
+    if (lines.isEmpty())
+    {
+        DBG("Empty session file: " + file.getFullPathName());
+        return false;
+    }
+
+    const auto header = juce::JSON::parse(lines[0]);
+    if (header["format"].toString() != "player-session" || static_cast<int>(header["version"]) > formatVersion)
+    {
+        DBG("Not a supported session file: " + file.getFullPathName());
+        return false;
+    }
+
+    events.clear();
+    for (int i = 1; i < lines.size(); ++i)
+    {
+        SessionEvent event;
+        if (SessionEvent::fromVar(juce::JSON::parse(lines[i]), event))
+            events.push_back(std::move(event));
+        else
+            DBG("Skipping unknown session event: " + lines[i]);
+    }
+
+    // 文件是按时间顺序写的，这里只是防止手工编辑过
+    std::stable_sort(events.begin(), events.end(), [](const SessionEvent& a, const SessionEvent& b) { return a.time < b.time; });
+    return true;
+}
+
+//==============================================================================
+void SessionReplayer::start(std::vector<SessionEvent> eventsToReplay, double sampleRate, int blockSize, double uiIntervalMs, double speed)
+{
+    events = std::move(eventsToReplay);
+    nextEvent = 0;
+    blockBuffer.setSize(2, blockSize);
+    blockMilliseconds = 1000.0 * blockSize / sampleRate;
+    uiInterval = uiIntervalMs;
+    nextUiTick = uiIntervalMs;
+    playbackSpeed = speed;
+    simulatedTime = simulatedLimit = 0.0;
+    scheduledTime = -1.0;
+    wallStartTime = lastTickTime = juce::Time::getMillisecondCounterHiRes();
+    summary = Summary();
+    summary.numEvents = static_cast<int>(events.size());
+
+    startTimer(1);
+}
+
+void SessionReplayer::timerCallback()
+{
+    const double now = juce::Time::getMillisecondCounterHiRes();
+
+    // 按倍速回放时，模拟时钟最多走到“实际经过的时间 × 倍速”；等待加载的时间不算
+    const bool busy = isBusy && isBusy();
+    if (playbackSpeed > 0.0 && !busy)
+        simulatedLimit += (now - lastTickTime) * playbackSpeed;
+    lastTickTime = now;
+
+    if (busy)
+        return;
+
+    const double endTime = (events.empty() ? 0.0 : events.back().time) + tailMilliseconds;
+
+    while (juce::Time::getMillisecondCounterHiRes() - now < sliceMilliseconds)
+    {
+        while (nextEvent < events.size() && events[nextEvent].time <= simulatedTime)
+        {
+            const auto& event = events[nextEvent++];
+
+            if (getAudioPosition)
+                summary.maxDriftMs = std::max(summary.maxDriftMs, std::abs(getAudioPosition() - event.audioPosition) * 1000.0);
+
+            if (applyEvent)
+                applyEvent(event);
+
+            // 打开文件等后台任务完成后再继续
+            if (isBusy && isBusy())
+                return;
+        }
+
+        if (nextEvent >= events.size() && simulatedTime >= endTime)
+        {
+            stopTimer();
+            summary.simulatedSeconds = simulatedTime / 1000.0;
+            summary.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - wallStartTime) / 1000.0;
+
+            if (onFinished)
+                onFinished(summary);
+            return;
+        }
+
+        if (playbackSpeed > 0.0 && simulatedTime >= simulatedLimit)
+            return;
+
+        if (renderBlock)
+            renderBlock(juce::AudioSourceChannelInfo(&blockBuffer, 0, blockBuffer.getNumSamples()));
+
+        simulatedTime += blockMilliseconds;
+
+        if (scheduledTime >= 0.0 && simulatedTime >= scheduledTime)
+        {
+            scheduledTime = -1.0;
+            if (onScheduled)
+                onScheduled();
+        }
+
+        if (simulatedTime >= nextUiTick)
+        {
+            nextUiTick += uiInterval;
+            if (onUiTick)
+                onUiTick();
+        }
+    }
+}
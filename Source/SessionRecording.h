@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    SessionRecording.h
+    Created: 23 Oct 2026 7:13:36pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Marker.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+// 录下来的一次用户操作
+struct SessionEvent
+{
+    enum class Type { filesDropped, play, pause, seek, markers, page };
+
+    Type type = Type::play;
+    double time = 0.0;           // 录制开始后的毫秒数；回放时按模拟时钟触发
+    double audioPosition = 0.0;  // 发生时的播放位置（秒），回放时用来检查偏差
+
+    juce::StringArray files;      // filesDropped
+    double seekPosition = 0.0;    // seek
+    std::vector<Marker> markers;  // markers：拖动或修改后的全部标记
+    int page = 0;                 // page：手动翻到的页
+
+    juce::var toVar() const;
+    static bool fromVar(const juce::var& value, SessionEvent& event);
+};
+
+// 把操作逐条写进 .session 文件（每行一个 JSON 对象，第一行是文件头），每条都立刻写盘，程序崩溃时也能留下记录
+class SessionRecorder
+{
+public:
+    bool start(const juce::File& file);
+    void stop() { stream.reset(); }
+    bool isRecording() const { return stream != nullptr; }
+
+    // 打上时间戳后写入
+    void record(SessionEvent event);
+
+    // 后台加载文件期间暂停录制时钟：回放时模拟时钟在加载期间也停着，
+    // 所以时间戳只算加载以外的时间，两边的事件时机才对得上
+    void setClockPaused(bool shouldBePaused);
+
+    static bool readEvents(const juce::File& file, std::vector<SessionEvent>& events);
+
+    static constexpr const char* fileExtension = ".session";
+    static constexpr int formatVersion = 1;
+
+private:
+    double getClockTime() const;
+
+    std::unique_ptr<juce::FileOutputStream> stream;
+    double startTime = 0.0;
+    double pausedSince = -1.0;  // 小于 0 表示没有暂停
+    double pausedTotal = 0.0;
+};
+
+// 回放一个录下来的会话：不打开音频设备，由模拟的音频时钟一块一块地拉音频（和设备回调走同一条路径），
+// 到了事件的时间就把它交给 applyEvent，每隔 uiIntervalMs 模拟毫秒调用一次 onUiTick（代替界面的定时器），
+// 用 scheduleCallback 定下的时刻到了就调用 onScheduled（代替换页检查的一次性定时器）。
+// 后台还在加载文件时模拟时钟暂停（录制时的时间戳同样不含加载时间），多轨的预读缓冲每块都等它准备好，
+// 所以同一个会话每次回放看到的输入顺序和时机都一样。
+// speed 为 0 时尽可能快，否则是相对实时的倍数。所有方法都在消息线程调用。
+class SessionReplayer : private juce::Timer
+{
+public:
+    struct Summary
+    {
+        int numEvents = 0;
+        double simulatedSeconds = 0.0;
+        double wallSeconds = 0.0;
+        double maxDriftMs = 0.0;  // 回放时的播放位置和录制时的最大偏差
+    };
+
+    void start(std::vector<SessionEvent> eventsToReplay, double sampleRate, int blockSize, double uiIntervalMs, double speed);
+    void stop() { stopTimer(); cancelScheduledCallback(); }
+    bool isReplaying() const { return isTimerRunning(); }
+
+    // 模拟时钟上的一次性定时器：再走 delayMs 模拟毫秒后调用 onScheduled，重新设置会替换之前的时刻。
+    // 按音频块检查，和设备回调一样是块的精度
+    void scheduleCallback(double delayMs) { scheduledTime = simulatedTime + delayMs; }
+    void cancelScheduledCallback() { scheduledTime = -1.0; }
+
+    std::function<void(const SessionEvent&)> applyEvent;
+    std::function<bool()> isBusy;  // 返回 true 时等待，不推进模拟时钟
+    std::function<void(const juce::AudioSourceChannelInfo&)> renderBlock;
+    std::function<void()> onUiTick;
+    std::function<void()> onScheduled;
+    std::function<double()> getAudioPosition;
+    std::function<void(const Summary&)> onFinished;
+
+    static constexpr double tailMilliseconds = 1000.0;  // 最后一个事件之后再跑一会儿
+    static constexpr double defaultSampleRate = 48000.0;
+    static constexpr int defaultBlockSize = 512;
+
+private:
+    void timerCallback() override;
+
+    std::vector<SessionEvent> events;
+    size_t nextEvent = 0;
+    juce::AudioBuffer<float> blockBuffer;
+    double blockMilliseconds = 0.0;
+    double uiInterval = 500.0, nextUiTick = 0.0;
+    double playbackSpeed = 0.0;
+    double simulatedTime = 0.0, simulatedLimit = 0.0;
+    double scheduledTime = -1.0;  // 小于 0 表示没有定时
+    double wallStartTime = 0.0, lastTickTime = 0.0;
+    Summary summary;
+
+    static constexpr double sliceMilliseconds = 20.0;  // 每次定时器回调最多占用消息线程这么久
+};
@@ -0,0 +1,79 @@
+/*
+  ==============================================================================
+
+    Setlist.cpp
+    Created: 19 Oct 2026 4:11:50pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "Setlist.h"
+
+namespace
+{
+    juce::File resolvePath(const juce::File& baseDirectory, const juce::String& path)
+    {
+        const auto trimmed = path.trim().unquoted();
+        if (trimmed.isEmpty())
+            return {};
+
+        return juce::File::isAbsolutePath(trimmed) ? juce::File(trimmed) : baseDirectory.getChildFile(trimmed);
+    }
+
+    // 没有写出来的文件，找与音频同名的兄弟文件
+    juce::File findSibling(const juce::File& audioFile, const juce::String& extension)
+    {
+        const auto sibling = audioFile.withFileExtension(extension);
+        return sibling.existsAsFile() ? sibling : juce::File{};
+    }
+}
+
+bool Setlist::loadFromFile(const juce::File& setlistFile)
+{
+    juce::StringArray lines;
+    setlistFile.readLines(lines);
+
+    if (lines.isEmpty())
+    {
+        DBG("Setlist is empty or unreadable: " + setlistFile.getFullPathName());
+        return false;
+    }
+
+    const auto baseDirectory = setlistFile.getParentDirectory();
+    std::vector<SetlistEntry> newEntries;
+
+    for (const auto& line : lines)
+    {
+        if (line.trim().isEmpty() || line.trimStart().startsWithChar('#'))
+            continue;
+
+        const auto fields = juce::StringArray::fromTokens(line, "|", "\"");
+
+        SetlistEntry entry;
+        entry.audioFile = resolvePath(baseDirectory, fields[0]);
+        entry.pdfFile = fields.size() > 1 ? resolvePath(baseDirectory, fields[1]) : juce::File{};
+        entry.markersFile = fields.size() > 2 ? resolvePath(baseDirectory, fields[2]) : juce::File{};
+
+        if (!entry.audioFile.existsAsFile())
+        {
+            DBG("Setlist audio file not found: " + line);
+            continue;
+        }
+
+        if (entry.pdfFile == juce::File{})
+            entry.pdfFile = findSibling(entry.audioFile, ".pdf");
+
+        if (entry.markersFile == juce::File{})
+            entry.markersFile = findSibling(entry.audioFile, ".markers");
+
+        newEntries.push_back(entry);
+    }
+
+    if (newEntries.empty())
+        return false;
+
+    entries = std::move(newEntries);
+    currentIndex = -1;
+    return true;
+}
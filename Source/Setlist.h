@@ -0,0 +1,49 @@
+/*
+  ==============================================================================
+
+    Setlist.h
+    Created: 19 Oct 2026 4:11:50pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <vector>
+
+// 演出曲目单中的一首曲子：音频、乐谱 PDF 和标记文件
+struct SetlistEntry
+{
+    juce::File audioFile;
+    juce::File pdfFile;
+    juce::File markersFile;
+
+    juce::String getName() const { return audioFile.getFileNameWithoutExtension(); }
+    bool operator==(const SetlistEntry& other) const
+    {
+        return audioFile == other.audioFile && pdfFile == other.pdfFile && markersFile == other.markersFile;
+    }
+};
+
+// 有序的曲目单，从 .setlist 文本文件读取。
+// 每行一首：audio|pdf|markers，路径可以相对于 .setlist 文件；# 开头的行是注释。
+// 省略 pdf 或 markers 时，会找与音频同名的 .pdf / .markers 文件。
+class Setlist
+{
+public:
+    bool loadFromFile(const juce::File& setlistFile);
+
+    int getNumEntries() const { return static_cast<int>(entries.size()); }
+    const SetlistEntry& getEntry(int index) const { return entries[static_cast<size_t>(index)]; }
+
+    int getCurrentIndex() const { return currentIndex; }
+    void setCurrentIndex(int index) { currentIndex = juce::jlimit(-1, getNumEntries() - 1, index); }
+    bool hasNextEntry() const { return currentIndex + 1 < getNumEntries(); }
+
+    bool isEmpty() const { return entries.empty(); }
+
+private:
+    std::vector<SetlistEntry> entries;
+    int currentIndex = -1;  // 还没有开始时为 -1
+};
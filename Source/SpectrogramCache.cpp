@@ -0,0 +1,391 @@
+/*
+  ==============================================================================
+
+    SpectrogramCache.cpp
+    Created: 21 Oct 2026 5:36:02pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "SpectrogramCache.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr double minimumFrequency = 30.0;
+    constexpr double maximumFrequency = 16000.0;
+    constexpr float floorDecibels = -90.0f;
+}
+
+SpectrogramCache::SpectrogramCache(juce::AudioFormatManager& formatManagerToUse)
+    : formatManager(formatManagerToUse),
+      pool(std::max(1, juce::SystemStats::getNumCpus() - 1))
+{
+    // 黑 -> 深蓝 -> 紫 -> 红 -> 橙 -> 黄 -> 白
+    juce::ColourGradient gradient(juce::Colours::black, 0.0f, 0.0f, juce::Colours::white, 1.0f, 0.0f, false);
+    gradient.addColour(0.2, juce::Colour(0xff10104a));
+    gradient.addColour(0.4, juce::Colour(0xff6a1b8a));
+    gradient.addColour(0.6, juce::Colour(0xffd3283a));
+    gradient.addColour(0.75, juce::Colour(0xfff57c20));
+    gradient.addColour(0.9, juce::Colour(0xfff5e356));
+
+    for (size_t i = 0; i < palette.size(); ++i)
+        palette[i] = gradient.getColourAtPosition(static_cast<double>(i) / (palette.size() - 1)).getPixelARGB();
+}
+
+SpectrogramCache::~SpectrogramCache()
+{
+    ++generation;
+    pool.removeAllJobs(true, 10000);
+    cancelPendingUpdate();
+}
+
+void SpectrogramCache::setSource(const juce::File& audioFile, double sampleRate, juce::int64 lengthInSamples)
+{
+    // 正在计算的任务看到新的 generation 会尽快放弃，结果也会被丢掉
+    ++generation;
+    layout = Layout();
+    tiles.clear();
+    tileInFlight.clear();
+    cachedBytes = 0;
+    playheadTile = -1;
+
+    if (audioFile == juce::File() || sampleRate <= 0.0 || lengthInSamples <= 0)
+    {
+        if (onTilesChanged)
+            onTilesChanged();
+        if (onMemoryUsageChanged)
+            onMemoryUsageChanged();
+        return;
+    }
+
+    layout.file = audioFile;
+    layout.sampleRate = sampleRate;
+    layout.lengthInSamples = lengthInSamples;
+    layout.fftOrder = sampleRate > 60000.0 ? 12 : 11;
+
+    // 正常长度的曲子每列前进半帧；很长的文件列数有上限，每列取几帧的最大值
+    const int fftSize = 1 << layout.fftOrder;
+    layout.hopSamples = std::max<juce::int64>(fftSize / 2, (lengthInSamples + maximumColumns - 1) / maximumColumns);
+    layout.framesPerColumn = static_cast<int>(juce::jlimit<juce::int64>(1, 4, layout.hopSamples / (fftSize / 2)));
+    layout.numColumns = static_cast<int>((lengthInSamples + layout.hopSamples - 1) / layout.hopSamples);
+    layout.numTiles = (layout.numColumns + columnsPerTile - 1) / columnsPerTile;
+
+    // 每一行覆盖一段对数频率，至少一个 bin
+    const double topFrequency = std::min(maximumFrequency, sampleRate * 0.5);
+    const double binsPerHz = fftSize / sampleRate;
+    const int numBins = fftSize / 2 + 1;
+
+    for (int row = 0; row < numRows; ++row)
+    {
+        const double low = minimumFrequency * std::pow(topFrequency / minimumFrequency, static_cast<double>(row) / numRows);
+        const double high = minimumFrequency * std::pow(topFrequency / minimumFrequency, static_cast<double>(row + 1) / numRows);
+        const int startBin = juce::jlimit(0, numBins - 1, static_cast<int>(std::floor(low * binsPerHz)));
+        const int endBin = juce::jlimit(startBin + 1, numBins, static_cast<int>(std::ceil(high * binsPerHz)));
+        layout.rowStartBins.push_back(startBin);
+        layout.rowEndBins.push_back(endBin);
+    }
+
+    tiles.resize(static_cast<size_t>(layout.numTiles));
+    tileInFlight.resize(static_cast<size_t>(layout.numTiles), false);
+    scheduleTiles();
+}
+
+void SpectrogramCache::setEnabled(bool shouldBeEnabled)
+{
+    enabled = shouldBeEnabled;
+    scheduleTiles();
+}
+
+void SpectrogramCache::setViewport(double playheadSeconds, double visibleStartSeconds, double visibleEndSeconds)
+{
+    const int newPlayheadTile = getTileForSeconds(playheadSeconds);
+    const bool rangeChanged = visibleStartSeconds != visibleStart || visibleEndSeconds != visibleEnd;
+
+    playhead = playheadSeconds;
+    visibleStart = visibleStartSeconds;
+    visibleEnd = visibleEndSeconds;
+
+    // 播放位置在同一块里移动不改变计算顺序
+    if (newPlayheadTile != playheadTile || rangeChanged)
+    {
+        playheadTile = newPlayheadTile;
+        scheduleTiles();
+    }
+}
+
+void SpectrogramCache::setMemoryBudget(size_t numBytes)
+{
+    memoryBudget = numBytes;
+    liveBudget = numBytes;
+    evictDownTo(liveBudget);
+}
+
+void SpectrogramCache::evictDownTo(size_t numBytes)
+{
+    // 从最远的块开始丢
+    while (cachedBytes > numBytes)
+    {
+        int farthest = -1;
+        for (int tile = 0; tile < layout.numTiles; ++tile)
+            if (tiles[static_cast<size_t>(tile)].isValid() && (farthest < 0 || getPriority(tile) > getPriority(farthest)))
+                farthest = tile;
+
+        if (farthest < 0)
+            break;
+
+        tiles[static_cast<size_t>(farthest)] = juce::Image();
+        cachedBytes -= getTileBytes();
+    }
+}
+
+size_t SpectrogramCache::shrink(size_t bytesToFree)
+{
+    const size_t before = cachedBytes;
+    const size_t target = before > bytesToFree ? before - bytesToFree : 0;
+    liveBudget = std::max(minimumMemoryBudget, std::min(liveBudget, target));
+    evictDownTo(liveBudget);
+    return before - cachedBytes;
+}
+
+void SpectrogramCache::restoreMemoryBudget()
+{
+    if (liveBudget == memoryBudget)
+        return;
+
+    liveBudget = memoryBudget;
+    scheduleTiles();
+}
+
+double SpectrogramCache::getTileStartSeconds(int tileIndex) const
+{
+    return static_cast<double>(tileIndex) * columnsPerTile * layout.hopSamples / layout.sampleRate;
+}
+
+int SpectrogramCache::getTileForSeconds(double seconds) const
+{
+    if (layout.numTiles == 0)
+        return -1;
+
+    const double column = seconds * layout.sampleRate / layout.hopSamples;
+    return juce::jlimit(0, layout.numTiles - 1, static_cast<int>(column / columnsPerTile));
+}
+
+double SpectrogramCache::getPriority(int tileIndex) const
+{
+    // 越小越先算：播放位置所在的块为 0，可见范围内按离播放位置的距离，范围外的排在后面
+    if (tileIndex == playheadTile)
+        return 0.0;
+
+    const double start = getTileStartSeconds(tileIndex);
+    const double end = getTileStartSeconds(tileIndex + 1);
+    const double distance = playhead < start ? start - playhead : std::max(0.0, playhead - end);
+    const bool visible = end > visibleStart && start < visibleEnd;
+    const double lengthSeconds = static_cast<double>(layout.lengthInSamples) / layout.sampleRate;
+
+    return 1.0 + distance + (visible ? 0.0 : lengthSeconds);
+}
+
+void SpectrogramCache::scheduleTiles()
+{
+    if (!enabled || layout.numTiles == 0)
+        return;
+
+    const int maxInFlight = pool.getNumThreads();
+
+    while (numInFlight < maxInFlight)
+    {
+        int next = -1;
+        for (int tile = 0; tile < layout.numTiles; ++tile)
+            if (!tiles[static_cast<size_t>(tile)].isValid() && !tileInFlight[static_cast<size_t>(tile)]
+                && (next < 0 || getPriority(tile) < getPriority(next)))
+                next = tile;
+
+        if (next < 0)
+            return;
+
+        // 预算用完时只为更近的块腾地方，否则远处的块会来回被丢掉又重新计算
+        if (cachedBytes + getTileBytes() * static_cast<size_t>(numInFlight + 1) > liveBudget)
+        {
+            int farthest = -1;
+            for (int tile = 0; tile < layout.numTiles; ++tile)
+                if (tiles[static_cast<size_t>(tile)].isValid() && (farthest < 0 || getPriority(tile) > getPriority(farthest)))
+                    farthest = tile;
+
+            if (farthest < 0 || getPriority(farthest) <= getPriority(next))
+                return;
+
+            tiles[static_cast<size_t>(farthest)] = juce::Image();
+            cachedBytes -= getTileBytes();
+        }
+
+        tileInFlight[static_cast<size_t>(next)] = true;
+        ++numInFlight;
+
+        const int jobGeneration = generation.load();
+        pool.addJob([this, tileLayout = layout, next, jobGeneration]
+        {
+            juce::Image image;
+
+            if (jobGeneration == generation.load())
+            {
+                std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(tileLayout.file));
+
+                if (reader != nullptr)
+                    image = renderTile(*reader, tileLayout, next, palette, generation, jobGeneration);
+                else
+                    DBG("Spectrogram could not open " + tileLayout.file.getFullPathName());
+            }
+
+            // 即使作废了也要交回去，消息线程据此知道有一个任务结束了
+            {
+                const juce::ScopedLock sl(lock);
+                finishedTiles.push_back({ jobGeneration, next, image });
+            }
+
+            triggerAsyncUpdate();
+            return juce::ThreadPoolJob::jobHasFinished;
+        });
+    }
+}
+
+void SpectrogramCache::handleAsyncUpdate()
+{
+    std::vector<FinishedTile> finished;
+
+    {
+        const juce::ScopedLock sl(lock);
+        finished.swap(finishedTiles);
+    }
+
+    bool changed = false;
+
+    for (auto& result : finished)
+    {
+        --numInFlight;
+
+        if (result.generation != generation.load())
+            continue;
+
+        tileInFlight[static_cast<size_t>(result.tileIndex)] = false;
+
+        if (result.image.isValid() && !tiles[static_cast<size_t>(result.tileIndex)].isValid())
+        {
+            tiles[static_cast<size_t>(result.tileIndex)] = result.image;
+            cachedBytes += getTileBytes();
+            changed = true;
+        }
+    }
+
+    scheduleTiles();
+
+    if (!changed)
+        return;
+
+    if (onTilesChanged)
+        onTilesChanged();
+    if (onMemoryUsageChanged)
+        onMemoryUsageChanged();
+}
+
+juce::Image SpectrogramCache::renderTile(juce::AudioFormatReader& reader, const Layout& tileLayout, int tileIndex,
+                                         const std::array<juce::PixelARGB, 256>& palette, const std::atomic<int>& generation, int expectedGeneration)
+{
+    const int fftSize = 1 << tileLayout.fftOrder;
+    const int numBins = fftSize / 2 + 1;
+    const int firstColumn = tileIndex * columnsPerTile;
+    const int numColumns = std::min(columnsPerTile, tileLayout.numColumns - firstColumn);
+    const int numChannels = static_cast<int>(std::min(2u, reader.numChannels));
+    const juce::int64 frameStep = tileLayout.hopSamples / tileLayout.framesPerColumn;
+
+    juce::dsp::FFT fft(tileLayout.fftOrder);
+    std::vector<float> window(static_cast<size_t>(fftSize));
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), static_cast<size_t>(fftSize),
+                                                             juce::dsp::WindowingFunction<float>::hann, false);
+
+    // 满幅正弦经过 Hann 窗后的幅度是 fftSize / 4，归一化到 0dB
+    juce::FloatVectorOperations::multiply(window.data(), 4.0f / fftSize, fftSize);
+
+    juce::AudioBuffer<float> audio(std::max(1, numChannels), fftSize);
+    std::vector<float> fftData(static_cast<size_t>(2 * fftSize));
+    std::vector<float> columnMagnitudes(static_cast<size_t>(numBins));
+
+    juce::Image image(juce::Image::ARGB, columnsPerTile, numRows, true);
+    juce::Image::BitmapData bitmap(image, juce::Image::BitmapData::writeOnly);
+
+    for (int column = 0; column < numColumns; ++column)
+    {
+        if (generation.load() != expectedGeneration)
+            return {};
+
+        juce::FloatVectorOperations::clear(columnMagnitudes.data(), numBins);
+        const juce::int64 columnStart = static_cast<juce::int64>(firstColumn + column) * tileLayout.hopSamples;
+
+        for (int frame = 0; frame < tileLayout.framesPerColumn; ++frame)
+        {
+            // 帧以列的位置为中心；文件开头之前和结尾之后由 reader 填零
+            reader.read(&audio, 0, fftSize, columnStart + frame * frameStep - fftSize / 2, true, true);
+
+            float* mono = audio.getWritePointer(0);
+            if (numChannels > 1)
+            {
+                juce::FloatVectorOperations::add(mono, audio.getReadPointer(1), fftSize);
+                juce::FloatVectorOperations::multiply(mono, 0.5f, fftSize);
+            }
+
+            juce::FloatVectorOperations::multiply(fftData.data(), mono, window.data(), fftSize);
+            juce::FloatVectorOperations::clear(fftData.data() + fftSize, fftSize);
+            fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+            juce::FloatVectorOperations::max(columnMagnitudes.data(), columnMagnitudes.data(), fftData.data(), numBins);
+        }
+
+        // 低频在下面
+        for (int row = 0; row < numRows; ++row)
+        {
+            const int startBin = tileLayout.rowStartBins[static_cast<size_t>(row)];
+            const int endBin = tileLayout.rowEndBins[static_cast<size_t>(row)];
+            const float magnitude = juce::FloatVectorOperations::findMaximum(columnMagnitudes.data() + startBin, endBin - startBin);
+            const float decibels = juce::Decibels::gainToDecibels(magnitude, floorDecibels);
+            const int level = juce::jlimit(0, 255, juce::roundToInt((decibels - floorDecibels) / -floorDecibels * 255.0f));
+
+            *reinterpret_cast<juce::PixelARGB*>(bitmap.getPixelPointer(column, numRows - 1 - row)) = palette[static_cast<size_t>(level)];
+        }
+    }
+
+    return image;
+}
+
+void SpectrogramCache::draw(juce::Graphics& g, juce::Rectangle<int> area, double startSeconds, double endSeconds) const
+{
+    g.setColour(juce::Colours::black);
+    g.fillRect(area);
+
+    if (layout.numTiles == 0 || endSeconds <= startSeconds)
+        return;
+
+    const double pixelsPerSecond = area.getWidth() / (endSeconds - startSeconds);
+    const double secondsPerColumn = static_cast<double>(layout.hopSamples) / layout.sampleRate;
+
+    g.setImageResamplingQuality(juce::Graphics::mediumResamplingQuality);
+
+    for (int tile = getTileForSeconds(startSeconds); tile >= 0 && tile < layout.numTiles; ++tile)
+    {
+        const double tileStart = getTileStartSeconds(tile);
+        if (tileStart >= endSeconds)
+            break;
+
+        const auto& image = tiles[static_cast<size_t>(tile)];
+        if (!image.isValid())
+            continue;
+
+        // 图块宽度固定，最后一块只用到前面一部分列
+        const int numColumns = std::min(columnsPerTile, layout.numColumns - tile * columnsPerTile);
+        const int left = juce::roundToInt(area.getX() + (tileStart - startSeconds) * pixelsPerSecond);
+        const int right = juce::roundToInt(area.getX() + (tileStart + numColumns * secondsPerColumn - startSeconds) * pixelsPerSecond);
+
+        g.drawImage(image, left, area.getY(), std::max(1, right - left), area.getHeight(), 0, 0, numColumns, numRows);
+    }
+}
@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    SpectrogramCache.h
+    Created: 21 Oct 2026 5:36:02pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// 频谱图缓存：整首曲子按时间切成固定列数的图块，每块是一张图像，每一列是一个 STFT 帧（对数频率、dB 着色）。
+// 图块在线程池上计算（juce::dsp::FFT，每个任务用自己的 reader），同时只有和线程数一样多的任务在跑，
+// 每空出一个就按当前优先级挑下一个：先播放位置所在的块，再可见范围内离播放位置近的，最后其余部分。
+// 所有图块的内存有预算，超出时丢掉离播放位置最远的块。公开方法都在消息线程调用。
+class SpectrogramCache : private juce::AsyncUpdater
+{
+public:
+    explicit SpectrogramCache(juce::AudioFormatManager& formatManagerToUse);
+    ~SpectrogramCache() override;
+
+    // 换成新的音频（空文件表示清空），之前的图块和未完成的任务全部作废
+    void setSource(const juce::File& audioFile, double sampleRate, juce::int64 lengthInSamples);
+    void clear() { setSource({}, 0.0, 0); }
+    bool isEmpty() const { return layout.numTiles == 0; }
+
+    // 只在显示频谱图时计算；关掉后已经算好的图块保留
+    void setEnabled(bool shouldBeEnabled);
+
+    // 播放位置和可见范围（秒）决定计算顺序；播放位置所在的块没变时几乎没有开销
+    void setViewport(double playheadSeconds, double visibleStartSeconds, double visibleEndSeconds);
+
+    // 把 [startSeconds, endSeconds) 画进 area，还没算好的部分留空
+    void draw(juce::Graphics& g, juce::Rectangle<int> area, double startSeconds, double endSeconds) const;
+
+    // 设定的预算；shrink 只临时压低实际使用的上限，不改变它
+    void setMemoryBudget(size_t numBytes);
+    size_t getMemoryBudget() const { return memoryBudget; }
+    size_t getMemoryUsage() const { return cachedBytes; }
+
+    // 全局内存紧张时调用：上限降到当前用量减去 bytesToFree（不低于 minimumMemoryBudget），
+    // 直到 restoreMemoryBudget 才回到设定的预算。返回实际释放的字节数
+    size_t shrink(size_t bytesToFree);
+
+    // 全局内存回到预算以内后调用：上限恢复为设定的预算，之前丢掉的块按需重新计算
+    void restoreMemoryBudget();
+
+    // 有新的图块算好时调用（onTilesChanged 给显示用，onMemoryUsageChanged 给内存统计用）
+    std::function<void()> onTilesChanged;
+    std::function<void()> onMemoryUsageChanged;
+
+    static constexpr int numRows = 128;           // 每列的像素数（对数频率）
+    static constexpr int columnsPerTile = 256;
+    static constexpr int maximumColumns = 16384;  // 很长的文件每列跨过更多样本
+    static constexpr size_t defaultMemoryBudget = 16 * 1024 * 1024;
+    static constexpr size_t minimumMemoryBudget = 2 * 1024 * 1024;
+
+private:
+    struct Layout
+    {
+        juce::File file;
+        double sampleRate = 0.0;
+        juce::int64 lengthInSamples = 0;
+        int fftOrder = 11;
+        juce::int64 hopSamples = 0;
+        int framesPerColumn = 1;  // 每列跨过很多样本时取几帧的最大值，避免漏掉短促的声音
+        int numColumns = 0;
+        int numTiles = 0;
+        std::vector<int> rowStartBins, rowEndBins;
+    };
+
+    struct FinishedTile
+    {
+        int generation;
+        int tileIndex;
+        juce::Image image;
+    };
+
+    static juce::Image renderTile(juce::AudioFormatReader& reader, const Layout& tileLayout, int tileIndex,
+                                  const std::array<juce::PixelARGB, 256>& palette, const std::atomic<int>& generation, int expectedGeneration);
+
+    void handleAsyncUpdate() override;
+    void scheduleTiles();
+    double getPriority(int tileIndex) const;
+    double getTileStartSeconds(int tileIndex) const;
+    int getTileForSeconds(double seconds) const;
+    void evictDownTo(size_t numBytes);
+    size_t getTileBytes() const { return static_cast<size_t>(columnsPerTile) * numRows * 4; }
+
+    juce::AudioFormatManager& formatManager;
+    std::array<juce::PixelARGB, 256> palette;
+
+    // 只在消息线程访问
+    Layout layout;
+    std::vector<juce::Image> tiles;
+    std::vector<bool> tileInFlight;
+    int numInFlight = 0;
+    size_t cachedBytes = 0;
+    size_t memoryBudget = defaultMemoryBudget;  // 设定的预算
+    size_t liveBudget = defaultMemoryBudget;    // 实际使用的上限，收缩时低于 memoryBudget
+    bool enabled = false;
+    double playhead = 0.0, visibleStart = 0.0, visibleEnd = 0.0;
+    int playheadTile = -1;
+
+    // 工作线程 -> 消息线程
+    juce::CriticalSection lock;
+    std::vector<FinishedTile> finishedTiles;
+    std::atomic<int> generation { 0 };
+
+    juce::ThreadPool pool;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramCache)
+};
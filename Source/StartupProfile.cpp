@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    StartupProfile.cpp
+    Created: 24 Oct 2026 10:06:48am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "StartupProfile.h"
+
+#include <utility>
+#include <vector>
+
+namespace StartupProfile
+{
+    namespace
+    {
+        const double launchMs = juce::Time::getMillisecondCounterHiRes();
+
+        juce::CriticalSection lock;
+        std::vector<std::pair<juce::String, double>> milestones;
+    }
+
+    double getMillisecondsSinceLaunch()
+    {
+        return juce::Time::getMillisecondCounterHiRes() - launchMs;
+    }
+
+    void mark(const juce::String& milestone)
+    {
+        const double elapsed = getMillisecondsSinceLaunch();
+
+        const juce::ScopedLock sl(lock);
+        for (const auto& entry : milestones)
+            if (entry.first == milestone)
+                return;
+
+        milestones.emplace_back(milestone, elapsed);
+        DBG("Startup: " + milestone + " at " + juce::String(elapsed, 1) + " ms");
+    }
+
+    double getMilestone(const juce::String& milestone)
+    {
+        const juce::ScopedLock sl(lock);
+        for (const auto& entry : milestones)
+            if (entry.first == milestone)
+                return entry.second;
+
+        return -1.0;
+    }
+
+    juce::var toVar()
+    {
+        auto* result = new juce::DynamicObject();
+
+        const juce::ScopedLock sl(lock);
+        for (const auto& entry : milestones)
+            result->setProperty(juce::Identifier(entry.first), entry.second);
+
+        return juce::var(result);
+    }
+
+    juce::String toString()
+    {
+        juce::StringArray parts;
+
+        const juce::ScopedLock sl(lock);
+        for (const auto& entry : milestones)
+            parts.add(entry.first + " " + juce::String(entry.second, 1));
+
+        return parts.joinIntoString(", ") + " ms";
+    }
+}
@@ -0,0 +1,28 @@
+/*
+  ==============================================================================
+
+    StartupProfile.h
+    Created: 24 Oct 2026 10:06:48am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+// 冷启动的各个阶段相对于进程启动的时间（毫秒）。进程启动时间取静态初始化时的时钟，
+// 不包括动态链接器加载库的时间。可以在任意线程调用 mark；同一个名字只记第一次。
+namespace StartupProfile
+{
+    double getMillisecondsSinceLaunch();
+
+    void mark(const juce::String& milestone);
+
+    // 没有记录过时返回 -1
+    double getMilestone(const juce::String& milestone);
+
+    // {"milestone": ms, ...}，按记录的先后顺序
+    juce::var toVar();
+    juce::String toString();
+}
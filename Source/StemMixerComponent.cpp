@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    StemMixerComponent.cpp
+    Created: 20 Oct 2026 7:02:15pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "StemMixerComponent.h"
+#include "ActivityMeter.h"
+
+StemMixerComponent::StemMixerComponent()
+{
+    addAndMakeVisible(totalLoadLabel);
+    totalLoadLabel.setColour(juce::Label::textColourId, juce::Colours::black);
+}
+
+StemMixerComponent::~StemMixerComponent()
+{
+    stopTimer();
+}
+
+void StemMixerComponent::setSource(MultiStemAudioSource* newSource)
+{
+    source = newSource;
+    rows.clear();
+
+    if (source == nullptr)
+    {
+        stopTimer();
+        return;
+    }
+
+    for (int i = 0; i < source->getNumStems(); ++i)
+    {
+        auto row = std::make_unique<Row>();
+
+        row->nameLabel.setText(source->getStemName(i), juce::dontSendNotification);
+        row->nameLabel.setColour(juce::Label::textColourId, juce::Colours::black);
+        row->loadLabel.setColour(juce::Label::textColourId, juce::Colours::darkgrey);
+        row->loadLabel.setJustificationType(juce::Justification::centredRight);
+
+        row->muteButton.setColour(juce::ToggleButton::textColourId, juce::Colours::black);
+        row->muteButton.setToggleState(source->isStemMuted(i), juce::dontSendNotification);
+        row->muteButton.onClick = [this, i, button = &row->muteButton] { source->setStemMuted(i, button->getToggleState()); };
+
+        row->gainSlider.setSliderStyle(juce::Slider::LinearHorizontal);
+        row->gainSlider.setTextBoxStyle(juce::Slider::NoTextBox, false, 0, 0);
+        row->gainSlider.setRange(0.0, 1.5, 0.01);
+        row->gainSlider.setValue(source->getStemGain(i), juce::dontSendNotification);
+        row->gainSlider.setDoubleClickReturnValue(true, 1.0);
+        row->gainSlider.onValueChange = [this, i, slider = &row->gainSlider] { source->setStemGain(i, static_cast<float>(slider->getValue())); };
+
+        addAndMakeVisible(row->nameLabel);
+        addAndMakeVisible(row->muteButton);
+        addAndMakeVisible(row->gainSlider);
+        addAndMakeVisible(row->loadLabel);
+        rows.push_back(std::move(row));
+    }
+
+    resized();
+    refreshLoads();
+}
+
+void StemMixerComponent::setTransportRunning(bool isRunning)
+{
+    if (isRunning && source != nullptr)
+    {
+        startTimer(500);
+    }
+    else
+    {
+        stopTimer();
+        refreshLoads();
+    }
+}
+
+void StemMixerComponent::paint(juce::Graphics& g)
+{
+    g.setColour(juce::Colours::pink);
+    g.drawRect(getLocalBounds(), 2);
+}
+
+void StemMixerComponent::resized()
+{
+    auto area = getLocalBounds().reduced(4);
+    const int rowHeight = rows.empty() ? 20 : juce::jlimit(14, 22, (area.getHeight() - 20) / static_cast<int>(rows.size()));
+
+    totalLoadLabel.setBounds(area.removeFromTop(20));
+
+    for (auto& row : rows)
+    {
+        auto rowArea = area.removeFromTop(rowHeight);
+        row->muteButton.setBounds(rowArea.removeFromLeft(40));
+        row->loadLabel.setBounds(rowArea.removeFromRight(50));
+        row->nameLabel.setBounds(rowArea.removeFromLeft(rowArea.getWidth() / 3));
+        row->gainSlider.setBounds(rowArea);
+    }
+}
+
+void StemMixerComponent::timerCallback()
+{
+    ActivityMeter::noteTimerCallback();
+    refreshLoads();
+}
+
+void StemMixerComponent::refreshLoads()
+{
+    if (source == nullptr)
+        return;
+
+    // 每轨读取+混音占回调时长的比例
+    for (size_t i = 0; i < rows.size(); ++i)
+        rows[i]->loadLabel.setText(juce::String(source->getStemLoad(static_cast<int>(i)) * 100.0f, 2) + "%", juce::dontSendNotification);
+
+    juce::String summary = juce::String(source->getNumStems()) + " stems, mixer CPU " + juce::String(source->getTotalLoad() * 100.0f, 2) + "%";
+    const int misses = source->getNumReadAheadMisses();
+    if (misses > 0)
+        summary << ", read-ahead misses " << misses;
+
+    totalLoadLabel.setText(summary, juce::dontSendNotification);
+}
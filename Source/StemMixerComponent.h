@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    StemMixerComponent.h
+    Created: 20 Oct 2026 7:02:15pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "MultiStemAudioSource.h"
+
+#include <memory>
+#include <vector>
+
+// 多轨混音面板：每轨一行，静音按钮、音量滑块，以及该轨在音频回调里占用的 CPU 比例。
+class StemMixerComponent : public juce::Component,
+                           private juce::Timer
+{
+public:
+    StemMixerComponent();
+    ~StemMixerComponent() override;
+
+    // 显示这组分轨（nullptr 时清空）。source 必须一直有效，直到下一次调用 setSource
+    void setSource(MultiStemAudioSource* newSource);
+
+    // 只在播放时定时刷新 CPU 占用，停下来后显示最后一次的值
+    void setTransportRunning(bool isRunning);
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void refreshLoads();
+
+    struct Row
+    {
+        juce::Label nameLabel;
+        juce::ToggleButton muteButton{ "M" };
+        juce::Slider gainSlider;
+        juce::Label loadLabel;
+    };
+
+    MultiStemAudioSource* source = nullptr;
+    std::vector<std::unique_ptr<Row>> rows;
+    juce::Label totalLoadLabel;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemMixerComponent)
+};
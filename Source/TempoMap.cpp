@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    TempoMap.cpp
+    Created: 20 Oct 2026 8:34:51pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "TempoMap.h"
+
+#include <algorithm>
+
+bool TempoMap::loadFromFile(const juce::File& tempoFile)
+{
+    juce::StringArray lines;
+    tempoFile.readLines(lines);
+
+    std::vector<TempoSegment> newSegments;
+
+    for (const auto& line : lines)
+    {
+        if (line.trim().isEmpty() || line.trimStart().startsWithChar('#'))
+            continue;
+
+        const auto fields = juce::StringArray::fromTokens(line, " \t", "");
+        if (fields.size() < 2)
+        {
+            DBG("Invalid tempo map line: " + line);
+            continue;
+        }
+
+        TempoSegment segment;
+        segment.startTime = fields[0].getDoubleValue();
+        segment.bpm = fields[1].getDoubleValue();
+        segment.beatsPerBar = fields.size() > 2 ? fields[2].getIntValue() : 4;
+        newSegments.push_back(segment);
+    }
+
+    if (newSegments.empty())
+    {
+        DBG("Tempo map is empty or unreadable: " + tempoFile.getFullPathName());
+        return false;
+    }
+
+    setSegments(std::move(newSegments));
+    return !segments.empty();
+}
+
+void TempoMap::buildFromMarkers(const std::vector<Marker>& markers, int beatsPerBar, double referenceBpm)
+{
+    std::vector<double> times;
+    times.reserve(markers.size());
+
+    for (const auto& marker : markers)
+        times.push_back(marker.position);
+
+    buildFromGaps(std::move(times), beatsPerBar, referenceBpm > 0.0 ? referenceBpm : defaultBpm);
+}
+
+void TempoMap::buildFromBarTimes(std::vector<double> times, int beatsPerBar)
+{
+    buildFromGaps(std::move(times), beatsPerBar, 0.0);
+}
+
+void TempoMap::buildFromGaps(std::vector<double> times, int beatsPerBar, double referenceBpm)
+{
+    std::sort(times.begin(), times.end());
+    beatsPerBar = std::max(1, beatsPerBar);
+
+    std::vector<TempoSegment> newSegments;
+
+    for (size_t i = 0; i + 1 < times.size(); ++i)
+    {
+        const double gap = times[i + 1] - times[i];
+        if (gap <= 0.0)
+            continue;
+
+        // referenceBpm 为 0 时这段就是一小节，否则取让速度最接近 referenceBpm 的小节数
+        const int numBars = referenceBpm > 0.0 ? std::max(1, juce::roundToInt(gap * referenceBpm / (60.0 * beatsPerBar))) : 1;
+        newSegments.push_back({ times[i], numBars * beatsPerBar * 60.0 / gap, beatsPerBar });
+    }
+
+    // 最后一个标记之后沿用最后一段的速度
+    if (!newSegments.empty())
+        newSegments.push_back({ times.back(), newSegments.back().bpm, beatsPerBar });
+
+    setSegments(std::move(newSegments));
+}
+
+void TempoMap::setSegments(std::vector<TempoSegment> newSegments)
+{
+    const auto numRequested = newSegments.size();
+
+    // 去掉不合理的段，按时间排序
+    newSegments.erase(std::remove_if(newSegments.begin(), newSegments.end(),
+                                     [](const TempoSegment& segment)
+                                     {
+                                         return segment.startTime < 0.0 || segment.beatsPerBar <= 0
+                                             || segment.bpm < minimumBpm || segment.bpm > maximumBpm;
+                                     }),
+                      newSegments.end());
+
+    std::sort(newSegments.begin(), newSegments.end(),
+              [](const TempoSegment& a, const TempoSegment& b) { return a.startTime < b.startTime; });
+
+    segments = std::move(newSegments);
+
+    if (numRequested > 0 && segments.empty())
+        DBG("No tempo segment between " + juce::String(minimumBpm) + " and " + juce::String(maximumBpm) + " BPM, the click track is silent");
+}
+
+std::vector<ClickBeat> TempoMap::computeBeats(double lengthSeconds) const
+{
+    std::vector<ClickBeat> beats;
+
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        const auto& segment = segments[i];
+        const double segmentEnd = i + 1 < segments.size() ? segments[i + 1].startTime : lengthSeconds;
+        const double beatLength = 60.0 / segment.bpm;
+
+        // 用拍号乘出时间，避免累加误差；留一点余量，避免下一段的第一拍和这一段的最后一拍重复
+        for (int beat = 0;; ++beat)
+        {
+            const double time = segment.startTime + beat * beatLength;
+            if (time >= segmentEnd - 1.0e-3 || time >= lengthSeconds)
+                break;
+
+            beats.push_back({ time, beat % segment.beatsPerBar == 0 });
+        }
+    }
+
+    return beats;
+}
@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    TempoMap.h
+    Created: 20 Oct 2026 8:34:51pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include "Marker.h"
+
+#include <vector>
+
+// 一段固定速度：从 startTime（秒）开始，每个新段都从小节的第一拍开始
+struct TempoSegment
+{
+    double startTime = 0.0;
+    double bpm = 120.0;
+    int beatsPerBar = 4;
+};
+
+// 节拍器的一拍：时间（秒）以及是不是小节的第一拍
+struct ClickBeat
+{
+    double time = 0.0;
+    bool isDownbeat = false;
+};
+
+// 速度图：手动写在 .tempo 文件里，或者从检测到的小节/标记推算。
+class TempoMap
+{
+public:
+    // 每行 "起始秒 BPM [每小节拍数]"，# 开头为注释
+    bool loadFromFile(const juce::File& tempoFile);
+
+    // 标记通常隔好几个小节（段落、换页），所以把相邻两个标记之间分成若干小节，
+    // 小节数取让速度最接近 referenceBpm 的那个（例如节拍检测的速度，没有时用 defaultBpm）
+    void buildFromMarkers(const std::vector<Marker>& markers, int beatsPerBar, double referenceBpm = defaultBpm);
+
+    // 输入是小节起点（秒），例如节拍检测的结果；相邻两个之间就是一小节
+    void buildFromBarTimes(std::vector<double> barTimes, int beatsPerBar);
+
+    void setSegments(std::vector<TempoSegment> newSegments);
+    const std::vector<TempoSegment>& getSegments() const { return segments; }
+    bool isEmpty() const { return segments.empty(); }
+    void clear() { segments.clear(); }
+
+    // 从第一段开始到 lengthSeconds 之间的所有拍子，按时间排好序
+    std::vector<ClickBeat> computeBeats(double lengthSeconds) const;
+
+    static constexpr double minimumBpm = 20.0;
+    static constexpr double maximumBpm = 400.0;
+    static constexpr double defaultBpm = 120.0;
+
+private:
+    void buildFromGaps(std::vector<double> times, int beatsPerBar, double referenceBpm);
+
+    std::vector<TempoSegment> segments;  // 按 startTime 排好序
+};
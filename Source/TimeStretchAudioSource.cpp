@@ -0,0 +1,257 @@
+/*
+  ==============================================================================
+
+    TimeStretchAudioSource.cpp
+    Created: 20 Oct 2026 10:12:55am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "TimeStretchAudioSource.h"
+#include "VectorMath.h"
+
+TimeStretchAudioSource::TimeStretchAudioSource(juce::PositionableAudioSource* inputSource)
+    : input(inputSource)
+{
+    jassert(input != nullptr);
+}
+
+void TimeStretchAudioSource::setTempo(double newTempo)
+{
+    tempo = juce::jlimit(minimumTempo, maximumTempo, newTempo);
+}
+
+void TimeStretchAudioSource::prepareToPlay(int samplesPerBlockExpected, double sampleRate)
+{
+    input->prepareToPlay(samplesPerBlockExpected, sampleRate);
+
+    // 帧长约 40ms，50% 重叠，搜索范围 ±1/4 帧
+    frameSize = juce::nextPowerOfTwo(juce::roundToInt(sampleRate * 0.04));
+    hopSize = frameSize / 2;
+    searchRadius = frameSize / 4;
+
+    window.resize(static_cast<size_t>(frameSize));
+    for (int i = 0; i < frameSize; ++i)
+        window[static_cast<size_t>(i)] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi * static_cast<float>(i) / static_cast<float>(frameSize));
+
+    const int capacity = 4 * frameSize + 2 * searchRadius;
+    inputBuffer.setSize(maxChannels, capacity);
+    overlapBuffer.setSize(maxChannels, frameSize);
+    readyBuffer.setSize(maxChannels, hopSize);
+    templateMono.resize(static_cast<size_t>(hopSize));
+    searchMono.resize(static_cast<size_t>(2 * searchRadius + hopSize));
+    searchEnergy.resize(searchMono.size() + 1);
+
+    stretching = std::abs(tempo.load() - 1.0) > 1.0e-3;
+    resetStretcher(input->getNextReadPosition());
+}
+
+void TimeStretchAudioSource::releaseResources()
+{
+    input->releaseResources();
+}
+
+void TimeStretchAudioSource::setNextReadPosition(juce::int64 newPosition)
+{
+    // 由音频线程在下一个回调开始时处理，避免和正在进行的处理冲突
+    pendingSeek = std::max<juce::int64>(0, newPosition);
+    reportedPosition = newPosition;
+}
+
+juce::int64 TimeStretchAudioSource::getNextReadPosition() const
+{
+    const auto seek = pendingSeek.load();
+    return seek >= 0 ? seek : reportedPosition.load();
+}
+
+void TimeStretchAudioSource::resetStretcher(juce::int64 sourcePosition)
+{
+    input->setNextReadPosition(sourcePosition);
+    inputStart = sourcePosition;
+    inputCount = 0;
+    overlapBuffer.clear();
+    readyCount = readyRead = 0;
+    readySourceStart = static_cast<double>(sourcePosition);
+    readyTempo = 1.0;
+    analysisPosition = static_cast<double>(sourcePosition);
+    previousFramePosition = -1;
+    reportedPosition = sourcePosition;
+}
+
+void TimeStretchAudioSource::ensureInput(juce::int64 endPosition, int numChannels)
+{
+    int needed = static_cast<int>(endPosition - (inputStart + inputCount));
+    if (needed <= 0)
+        return;
+
+    jassert(inputCount + needed <= inputBuffer.getNumSamples());
+    needed = std::min(needed, inputBuffer.getNumSamples() - inputCount);
+
+    // 按顺序从输入读取，直接写进输入缓冲的末尾
+    juce::AudioBuffer<float> view(inputBuffer.getArrayOfWritePointers(), numChannels, inputCount + needed);
+    input->getNextAudioBlock(juce::AudioSourceChannelInfo(&view, inputCount, needed));
+    inputCount += needed;
+}
+
+void TimeStretchAudioSource::discardInputBefore(juce::int64 position)
+{
+    const int numToDrop = static_cast<int>(juce::jlimit<juce::int64>(0, inputCount, position - inputStart));
+    if (numToDrop == 0)
+        return;
+
+    const int numRemaining = inputCount - numToDrop;
+    for (int channel = 0; channel < inputBuffer.getNumChannels(); ++channel)
+    {
+        auto* data = inputBuffer.getWritePointer(channel);
+        std::memmove(data, data + numToDrop, static_cast<size_t>(numRemaining) * sizeof(float));
+    }
+
+    inputStart += numToDrop;
+    inputCount = numRemaining;
+}
+
+int TimeStretchAudioSource::findBestOffset(juce::int64 nominal, int numChannels)
+{
+    // 模板是上一帧的“自然延续”，在名义位置附近找波形最相似的地方
+    const juce::int64 templateStart = previousFramePosition + hopSize;
+    const int overlapLength = hopSize;
+    const int minOffset = static_cast<int>(std::max<juce::int64>(-searchRadius, inputStart - nominal));
+    const int maxOffset = searchRadius;
+
+    if (minOffset >= maxOffset)
+        return minOffset;
+
+    ensureInput(std::max(nominal + maxOffset + frameSize, templateStart + overlapLength), numChannels);
+
+    const int searchLength = (maxOffset - minOffset) + overlapLength;
+    const int templateBase = static_cast<int>(templateStart - inputStart);
+    const int searchBase = static_cast<int>(nominal + minOffset - inputStart);
+
+    // 各声道混成单声道再比较
+    juce::FloatVectorOperations::copy(templateMono.data(), inputBuffer.getReadPointer(0, templateBase), overlapLength);
+    juce::FloatVectorOperations::copy(searchMono.data(), inputBuffer.getReadPointer(0, searchBase), searchLength);
+
+    for (int channel = 1; channel < numChannels; ++channel)
+    {
+        juce::FloatVectorOperations::add(templateMono.data(), inputBuffer.getReadPointer(channel, templateBase), overlapLength);
+        juce::FloatVectorOperations::add(searchMono.data(), inputBuffer.getReadPointer(channel, searchBase), searchLength);
+    }
+
+    // 候选段能量的前缀和，用来做归一化
+    searchEnergy[0] = 0.0;
+    for (int i = 0; i < searchLength; ++i)
+        searchEnergy[static_cast<size_t>(i + 1)] = searchEnergy[static_cast<size_t>(i)] + searchMono[static_cast<size_t>(i)] * searchMono[static_cast<size_t>(i)];
+
+    auto score = [&](int offset)
+    {
+        const int start = offset - minOffset;
+        const float correlation = VectorMath::dotProduct(templateMono.data(), searchMono.data() + start, overlapLength);
+        const double energy = searchEnergy[static_cast<size_t>(start + overlapLength)] - searchEnergy[static_cast<size_t>(start)];
+        return correlation / std::sqrt(energy + 1.0e-9);
+    };
+
+    // 先粗搜（步长 4），再在最佳点附近逐个样本细搜
+    int bestOffset = 0;
+    double bestScore = -std::numeric_limits<double>::max();
+
+    for (int offset = minOffset; offset <= maxOffset; offset += 4)
+    {
+        const double s = score(offset);
+        if (s > bestScore)
+        {
+            bestScore = s;
+            bestOffset = offset;
+        }
+    }
+
+    const int coarseBest = bestOffset;
+    for (int offset = std::max(minOffset, coarseBest - 3); offset <= std::min(maxOffset, coarseBest + 3); ++offset)
+    {
+        const double s = score(offset);
+        if (s > bestScore)
+        {
+            bestScore = s;
+            bestOffset = offset;
+        }
+    }
+
+    return bestOffset;
+}
+
+void TimeStretchAudioSource::processFrame(int numChannels)
+{
+    const double currentTempo = tempo.load();
+    const juce::int64 nominal = static_cast<juce::int64>(std::llround(analysisPosition));
+    const int offset = previousFramePosition < 0 ? 0 : findBestOffset(nominal, numChannels);
+    const juce::int64 frameStart = nominal + offset;
+
+    ensureInput(frameStart + frameSize, numChannels);
+    const int frameBase = static_cast<int>(frameStart - inputStart);
+
+    // 加窗后叠加，前半帧和上一帧的后半帧拼成一个输出块
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* overlap = overlapBuffer.getWritePointer(channel);
+        juce::FloatVectorOperations::addWithMultiply(overlap, inputBuffer.getReadPointer(channel, frameBase), window.data(), frameSize);
+
+        readyBuffer.copyFrom(channel, 0, overlap, hopSize);
+        std::memmove(overlap, overlap + hopSize, static_cast<size_t>(frameSize - hopSize) * sizeof(float));
+        juce::FloatVectorOperations::clear(overlap + frameSize - hopSize, hopSize);
+    }
+
+    readyCount = hopSize;
+    readyRead = 0;
+    readySourceStart = analysisPosition;
+    readyTempo = currentTempo;
+
+    previousFramePosition = frameStart;
+    analysisPosition += hopSize * currentTempo;
+
+    discardInputBefore(std::min(previousFramePosition + hopSize, static_cast<juce::int64>(analysisPosition) - searchRadius));
+}
+
+void TimeStretchAudioSource::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const auto seek = pendingSeek.exchange(-1);
+    if (seek >= 0)
+        resetStretcher(seek);
+
+    // 原速时直接旁路；在两种模式之间切换时从当前的源位置重新开始
+    const bool shouldStretch = std::abs(tempo.load() - 1.0) > 1.0e-3;
+    if (shouldStretch != stretching)
+    {
+        stretching = shouldStretch;
+        resetStretcher(reportedPosition.load());
+    }
+
+    if (!stretching)
+    {
+        input->getNextAudioBlock(bufferToFill);
+        reportedPosition = input->getNextReadPosition();
+        return;
+    }
+
+    const int numChannels = std::min(bufferToFill.buffer->getNumChannels(), maxChannels);
+    int numWritten = 0;
+
+    while (numWritten < bufferToFill.numSamples)
+    {
+        if (readyRead >= readyCount)
+            processFrame(numChannels);
+
+        const int numToCopy = std::min(readyCount - readyRead, bufferToFill.numSamples - numWritten);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            bufferToFill.buffer->copyFrom(channel, bufferToFill.startSample + numWritten, readyBuffer, channel, readyRead, numToCopy);
+
+        readyRead += numToCopy;
+        numWritten += numToCopy;
+    }
+
+    for (int channel = numChannels; channel < bufferToFill.buffer->getNumChannels(); ++channel)
+        bufferToFill.buffer->clear(channel, bufferToFill.startSample, bufferToFill.numSamples);
+
+    // 输出对应的源位置 = 当前输出块的起点 + 已输出样本数 × 速度
+    reportedPosition = static_cast<juce::int64>(readySourceStart + readyRead * readyTempo);
+}
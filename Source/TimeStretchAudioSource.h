@@ -0,0 +1,84 @@
+/*
+  ==============================================================================
+
+    TimeStretchAudioSource.h
+    Created: 20 Oct 2026 10:12:55am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+#include <atomic>
+#include <vector>
+
+// 练习用的变速不变调：WSOLA（波形相似叠加）。
+// 放在读取源和 AudioTransportSource 之间，对外报告的读取位置始终是源文件的时间，
+// 所以 transport 的 getCurrentPosition() 和标记都保持在原始时间轴上，任何速度下翻页都对得上。
+// 所有缓冲在 prepareToPlay 中分配；getNextAudioBlock 不分配内存、不加锁，延迟不超过一帧。
+class TimeStretchAudioSource : public juce::PositionableAudioSource
+{
+public:
+    explicit TimeStretchAudioSource(juce::PositionableAudioSource* inputSource);
+    ~TimeStretchAudioSource() override = default;
+
+    // 速度比例，1.0 为原速（直接旁路），0.75 表示 75% 速度。可以在任意线程调用
+    void setTempo(double newTempo);
+    double getTempo() const { return tempo.load(); }
+
+    static constexpr double minimumTempo = 0.5;
+    static constexpr double maximumTempo = 1.5;
+
+    //==============================================================================
+    void prepareToPlay(int samplesPerBlockExpected, double sampleRate) override;
+    void releaseResources() override;
+    void getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferToFill) override;
+
+    void setNextReadPosition(juce::int64 newPosition) override;
+    juce::int64 getNextReadPosition() const override;
+    juce::int64 getTotalLength() const override { return input->getTotalLength(); }
+    bool isLooping() const override { return input->isLooping(); }
+    void setLooping(bool shouldLoop) override { input->setLooping(shouldLoop); }
+
+private:
+    void resetStretcher(juce::int64 sourcePosition);
+    void ensureInput(juce::int64 endPosition, int numChannels);
+    void discardInputBefore(juce::int64 position);
+    int findBestOffset(juce::int64 nominal, int numChannels);
+    void processFrame(int numChannels);
+
+    juce::PositionableAudioSource* input;
+
+    std::atomic<double> tempo { 1.0 };
+    std::atomic<juce::int64> pendingSeek { -1 };
+    std::atomic<juce::int64> reportedPosition { 0 };
+
+    // WSOLA 参数（按采样率在 prepareToPlay 中确定）
+    int frameSize = 0, hopSize = 0, searchRadius = 0;
+    std::vector<float> window;
+
+    // 输入缓冲：inputBuffer[0] 对应源位置 inputStart
+    juce::AudioBuffer<float> inputBuffer;
+    juce::int64 inputStart = 0;
+    int inputCount = 0;
+
+    // 叠加缓冲和已经完成、等待输出的样本
+    juce::AudioBuffer<float> overlapBuffer;
+    juce::AudioBuffer<float> readyBuffer;
+    int readyCount = 0, readyRead = 0;
+
+    // 相关性搜索用的单声道缓冲
+    std::vector<float> templateMono, searchMono;
+    std::vector<double> searchEnergy;
+
+    double analysisPosition = 0.0;  // 下一帧的名义分析位置（源样本）
+    juce::int64 previousFramePosition = -1;
+    double readySourceStart = 0.0;  // 等待输出的第一个样本对应的源位置
+    double readyTempo = 1.0;
+    bool stretching = false;
+
+    static constexpr int maxChannels = 8;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TimeStretchAudioSource)
+};
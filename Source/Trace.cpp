@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    Trace.cpp
+    Created: 23 Oct 2026 9:38:54am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include "Trace.h"
+
+#include <array>
+#include <memory>
+
+namespace Trace
+{
+    namespace
+    {
+        constexpr int maxThreads = 32;
+        constexpr size_t eventsPerThread = 1 << 15;
+
+        // 只被一个线程写；导出时从其它线程读
+        struct ThreadBuffer
+        {
+            std::array<Event, eventsPerThread> events;
+            std::atomic<juce::uint64> numWritten { 0 };
+            std::atomic<bool> isMessageThread { false };
+            std::atomic<const char*> firstCategory { nullptr };
+        };
+
+        std::array<std::unique_ptr<ThreadBuffer>, maxThreads> buffers;
+        std::atomic<bool> buffersAllocated { false };
+        std::atomic<int> numClaimed { 0 };
+
+        ThreadBuffer* claimBuffer(const char* category) noexcept
+        {
+            if (!buffersAllocated.load(std::memory_order_acquire))
+                return nullptr;
+
+            const int index = numClaimed.fetch_add(1);
+            if (index >= maxThreads)
+                return nullptr;
+
+            auto* buffer = buffers[static_cast<size_t>(index)].get();
+            auto* messageManager = juce::MessageManager::getInstanceWithoutCreating();
+            buffer->isMessageThread = messageManager != nullptr && messageManager->isThisTheMessageThread();
+            buffer->firstCategory = category;
+            return buffer;
+        }
+    }
+
+    void setEnabled(bool shouldBeEnabled)
+    {
+        if (shouldBeEnabled && !buffersAllocated.load())
+        {
+            for (auto& buffer : buffers)
+                buffer = std::make_unique<ThreadBuffer>();
+
+            buffersAllocated.store(true, std::memory_order_release);
+        }
+
+        enabledFlag = shouldBeEnabled;
+    }
+
+    void record(const Event& event) noexcept
+    {
+        // 每个线程第一次记录时领一个缓冲区，之后一直用它
+        thread_local ThreadBuffer* buffer = claimBuffer(event.category);
+        if (buffer == nullptr)
+            return;
+
+        const auto index = buffer->numWritten.load(std::memory_order_relaxed);
+        buffer->events[static_cast<size_t>(index % eventsPerThread)] = event;
+        buffer->numWritten.store(index + 1, std::memory_order_release);
+    }
+
+    void clear()
+    {
+        if (!buffersAllocated.load())
+            return;
+
+        for (auto& buffer : buffers)
+            buffer->numWritten = 0;
+    }
+
+    bool writeChromeTrace(const juce::File& file)
+    {
+        juce::MemoryOutputStream out;
+        out << "{\"traceEvents\":[";
+
+        const double ticksToMicros = 1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond());
+        const int processId = 1;
+        bool first = true;
+
+        auto separator = [&]
+        {
+            if (!first)
+                out << ",";
+            first = false;
+            out << "\n";
+        };
+
+        const int numThreads = buffersAllocated.load() ? std::min(numClaimed.load(), maxThreads) : 0;
+
+        for (int threadIndex = 0; threadIndex < numThreads; ++threadIndex)
+        {
+            const auto& buffer = *buffers[static_cast<size_t>(threadIndex)];
+            const juce::uint64 numWritten = buffer.numWritten.load(std::memory_order_acquire);
+            const juce::uint64 numEvents = std::min<juce::uint64>(numWritten, eventsPerThread);
+
+            // 线程名：消息线程，或者按第一个事件的类别命名（例如 audio）
+            const char* category = buffer.firstCategory.load();
+            const juce::String threadName = buffer.isMessageThread.load() ? juce::String("Message thread")
+                                                                           : juce::String(category != nullptr ? category : "worker") + " thread " + juce::String(threadIndex);
+            separator();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << processId << ",\"tid\":" << threadIndex
+                << ",\"args\":{\"name\":" << juce::JSON::toString(threadName) << "}}";
+
+            for (juce::uint64 i = numWritten - numEvents; i < numWritten; ++i)
+            {
+                const auto& event = buffer.events[static_cast<size_t>(i % eventsPerThread)];
+                if (event.name == nullptr)
+                    continue;
+
+                separator();
+                out << "{\"ph\":\"X\",\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+                    << "\",\"pid\":" << processId << ",\"tid\":" << threadIndex
+                    << ",\"ts\":" << juce::String(static_cast<double>(event.startTicks) * ticksToMicros, 3)
+                    << ",\"dur\":" << juce::String(static_cast<double>(event.endTicks - event.startTicks) * ticksToMicros, 3) << "}";
+            }
+        }
+
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        if (!file.replaceWithData(out.getData(), out.getDataSize()))
+        {
+            DBG("Failed to write trace: " + file.getFullPathName());
+            return false;
+        }
+
+        return true;
+    }
+}
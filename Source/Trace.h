@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    Trace.h
+    Created: 23 Oct 2026 9:38:54am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+#include <JuceHeader.h>
+
+#include <atomic>
+
+// 轻量级的事件追踪，导出为 Chrome trace JSON（在 chrome://tracing 或 Perfetto 里打开）。
+// 每个线程第一次记录时从预先分配好的环形缓冲区里领一个，之后只写自己的缓冲区：
+// 不加锁、不分配内存，可以在音频线程使用。关闭时每个事件只多一次原子读取。
+// 缓冲区写满后覆盖最旧的事件。事件名和类别必须是字符串常量（只保存指针）。
+// 编译时把 PLAYER_ENABLE_TRACING 定义为 0 可以去掉所有追踪代码。
+#ifndef PLAYER_ENABLE_TRACING
+ #define PLAYER_ENABLE_TRACING 1
+#endif
+
+namespace Trace
+{
+    struct Event
+    {
+        const char* name = nullptr;
+        const char* category = nullptr;
+        juce::int64 startTicks = 0;
+        juce::int64 endTicks = 0;
+    };
+
+    inline std::atomic<bool> enabledFlag { false };
+    inline bool isEnabled() noexcept { return enabledFlag.load(std::memory_order_relaxed); }
+
+    // 第一次打开时分配所有线程的缓冲区（消息线程调用）
+    void setEnabled(bool shouldBeEnabled);
+
+    // 记录一个已经结束的事件；拿不到缓冲区（线程太多）时丢掉
+    void record(const Event& event) noexcept;
+
+    // 把所有缓冲区里的事件写成 Chrome trace JSON；最好在关闭记录之后调用，否则正在写的事件可能不完整
+    bool writeChromeTrace(const juce::File& file);
+    void clear();
+
+    // 作用域内的一个事件
+    class ScopedEvent
+    {
+    public:
+        ScopedEvent(const char* eventName, const char* eventCategory) noexcept
+        {
+            if (isEnabled())
+            {
+                event.name = eventName;
+                event.category = eventCategory;
+                event.startTicks = juce::Time::getHighResolutionTicks();
+            }
+        }
+
+        ~ScopedEvent() noexcept
+        {
+            if (event.name != nullptr)
+            {
+                event.endTicks = juce::Time::getHighResolutionTicks();
+                record(event);
+            }
+        }
+
+    private:
+        Event event;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedEvent)
+    };
+}
+
+#if PLAYER_ENABLE_TRACING
+ #define PLAYER_TRACE_SCOPE(name, category) const Trace::ScopedEvent JUCE_JOIN_MACRO(traceEvent_, __LINE__) (name, category)
+#else
+ #define PLAYER_TRACE_SCOPE(name, category)
+#endif
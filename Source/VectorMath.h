@@ -0,0 +1,35 @@
+/*
+  ==============================================================================
+
+    VectorMath.h
+    Created: 25 Oct 2026 10:41:03am
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#pragma once
+
+// 音频线程和后台分析共用的小向量内核
+namespace VectorMath
+{
+    // 四路独立累加，方便编译器向量化（SSE/NEON）
+    inline float dotProduct(const float* a, const float* b, int numSamples)
+    {
+        float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+        int i = 0;
+
+        for (; i + 4 <= numSamples; i += 4)
+        {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+
+        for (; i < numSamples; ++i)
+            s0 += a[i] * b[i];
+
+        return (s0 + s1) + (s2 + s3);
+    }
+}
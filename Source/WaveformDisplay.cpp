@@ -9,6 +9,7 @@
 */
 
 #include "WaveformDisplay.h"
+#include "ActivityMeter.h"
 
 
 //AudioThumbnail 是 JUCE 库中用于绘制音频波形的类。
@@ -21,24 +22,128 @@ WaveformDisplay::WaveformDisplay(juce::AudioThumbnail& thumbnailToUse)//造函
 WaveformDisplay::~WaveformDisplay()
 {
     audioThumbnail.removeChangeListener(this);
+
+    if (spectrogram != nullptr)
+        spectrogram->onTilesChanged = nullptr;
+}
+
+void WaveformDisplay::setSpectrogram(SpectrogramCache* cacheToUse)
+{
+    spectrogram = cacheToUse;
+
+    if (spectrogram != nullptr)
+        spectrogram->onTilesChanged = [this]
+        {
+            if (displayMode == DisplayMode::spectrogram)
+                invalidateContentLayer();
+        };
+}
+
+void WaveformDisplay::setDisplayMode(DisplayMode newMode)
+{
+    displayMode = newMode;
+
+    // 只有显示频谱图时才在后台计算
+    if (spectrogram != nullptr)
+    {
+        spectrogram->setEnabled(displayMode == DisplayMode::spectrogram);
+        updateSpectrogramViewport();
+    }
+
+    invalidateContentLayer();
+}
+
+void WaveformDisplay::updateSpectrogramViewport()
+{
+    // 目前总是显示整首曲子
+    if (spectrogram != nullptr && displayMode == DisplayMode::spectrogram)
+        spectrogram->setViewport(currentPosition, 0.0, audioThumbnail.getTotalLength());
+}
+
+void WaveformDisplay::paint(juce::Graphics& g)
+{
+    ActivityMeter::notePaint(g.getClipBounds());
+
+    if (!contentLayerValid || (contentLayer.isValid() && (contentLayer.getWidth() != getWidth() || contentLayer.getHeight() != getHeight())))
+        rebuildContentLayer();
+
+    if (contentLayer.isValid())
+        g.drawImageAt(contentLayer, 0, 0);
+
+    // 绘制播放位置线
+    if (audioThumbnail.getTotalLength() > 0.0)
+    {
+        g.setColour(juce::Colours::red);
+        const int x = getPlayheadX();
+        g.drawLine(static_cast<float>(x), 0.0f, static_cast<float>(x), static_cast<float>(getHeight()), 2.0f);
+    }
+}
+
+void WaveformDisplay::resized()
+{
+    invalidateContentLayer();
+}
+
+void WaveformDisplay::invalidateContentLayer()
+{
+    contentLayerValid = false;
+    repaint();
+}
+
+int WaveformDisplay::getPlayheadX() const
+{
+    const double length = audioThumbnail.getTotalLength();
+    return length > 0.0 ? static_cast<int>(currentPosition / length * getWidth()) : -1;
+}
+
+void WaveformDisplay::repaintPlayheadStrip(int x)
+{
+    if (x >= 0)
+        repaint(x - 2, 0, 5, getHeight());
 }
 
-void WaveformDisplay::paint(juce::Graphics& g)//如果 audioThumbnail 有有效的音频数据，则绘制波形；否则，显示提示文字。
+void WaveformDisplay::rebuildContentLayer()//如果 audioThumbnail 有有效的音频数据，则绘制波形；否则，显示提示文字。
 {
+    contentLayerValid = true;
+
+    if (getWidth() <= 0 || getHeight() <= 0)
+    {
+        contentLayer = juce::Image();
+        return;
+    }
+
+    contentLayer = juce::Image(juce::Image::RGB, getWidth(), getHeight(), false);
+    juce::Graphics g(contentLayer);
+
     //背景颜色
     g.fillAll(juce::Colours::white);
 
     if (audioThumbnail.getTotalLength() > 0.0)
     {
-        //绘制波形
-        g.setColour(juce::Colours::blue);
-        audioThumbnail.drawChannels(g, getLocalBounds(), 0.0, audioThumbnail.getTotalLength(), 1.0f);
+        if (displayMode == DisplayMode::spectrogram && spectrogram != nullptr && !spectrogram->isEmpty())
+        {
+            // 频谱图：已经算好的图块
+            spectrogram->draw(g, getLocalBounds(), 0.0, audioThumbnail.getTotalLength());
+        }
+        else
+        {
+            //绘制波形
+            g.setColour(juce::Colours::blue);
+            audioThumbnail.drawChannels(g, getLocalBounds(), 0.0, audioThumbnail.getTotalLength(), 1.0f);
+        }
 
-        // 绘制播放位置线
-        g.setColour(juce::Colours::red);
-        auto audioPosition = currentPosition / audioThumbnail.getTotalLength();
-        int x = static_cast<int>(audioPosition * getWidth());
-        g.drawLine(x, 0, x, getHeight(), 2.0f);
+        // 绘制 A/B 循环区间和正在拖动的选区
+        if (loopEnd > loopStart)
+        {
+            g.setColour(juce::Colours::green.withAlpha(0.25f));
+            g.fillRect(juce::Rectangle<float>(getXForTime(loopStart), 0.0f, getXForTime(loopEnd) - getXForTime(loopStart), static_cast<float>(getHeight())));
+        }
+
+        if (hasSelection())
+        {
+            g.setColour(juce::Colours::orange.withAlpha(0.3f));
+            g.fillRect(juce::Rectangle<float>(getXForTime(selectionStart), 0.0f, getXForTime(selectionEnd) - getXForTime(selectionStart), static_cast<float>(getHeight())));
+        }
     }
     else
     {
@@ -55,24 +160,97 @@ void WaveformDisplay::changeListenerCallback(juce::ChangeBroadcaster* source)//
 {
     if (source == &audioThumbnail)
     {
-        repaint();
+        invalidateContentLayer();
     }
 }
 
-void WaveformDisplay::setPosition(double position)//更新成员变量 currentPosition，表示当前音频的播放位置（以秒为单位）。调用 repaint()，请求组件重绘，以更新播放位置指示线。
+void WaveformDisplay::setPosition(double position)//更新成员变量 currentPosition，表示当前音频的播放位置（以秒为单位）。只重绘播放位置指示线移动过的地方。
 {
     currentPosition = position;
-    repaint();
+    updateSpectrogramViewport();
+
+    // 播放位置线没有移动到另一个像素时不重绘
+    const int newPlayheadX = getPlayheadX();
+    if (newPlayheadX == playheadX && contentLayerValid)
+        return;
+
+    repaintPlayheadStrip(playheadX);
+    repaintPlayheadStrip(newPlayheadX);
+    playheadX = newPlayheadX;
 }
 
 void WaveformDisplay::mouseDown(const juce::MouseEvent& event)//点击，更新时间
 {
     if (audioThumbnail.getTotalLength() > 0.0)
     {
-        auto clickPosition = event.position.x / static_cast<float>(getWidth());
+        // 事件也可能来自盖在波形上面的进度条，统一换算到自己的坐标
+        const auto localEvent = event.getEventRelativeTo(this);
+
+        if (localEvent.mods.isShiftDown())
+        {
+            // Shift 按下时开始选择区间
+            isSelecting = true;
+            selectionAnchor = getTimeForX(localEvent.position.x);
+            selectionStart = selectionEnd = selectionAnchor;
+            invalidateContentLayer();
+            return;
+        }
+
+        // 进度条自己会处理普通的点击
+        if (event.eventComponent != this)
+            return;
+
+        auto clickPosition = localEvent.position.x / static_cast<float>(getWidth());
         auto newPosition = audioThumbnail.getTotalLength() * clickPosition;
 
         if (onPositionChanged)
             onPositionChanged(newPosition);
     }
 }
+
+void WaveformDisplay::mouseDrag(const juce::MouseEvent& event)
+{
+    if (!isSelecting)
+        return;
+
+    const double time = getTimeForX(event.getEventRelativeTo(this).position.x);
+    selectionStart = std::min(selectionAnchor, time);
+    selectionEnd = std::max(selectionAnchor, time);
+    invalidateContentLayer();
+}
+
+void WaveformDisplay::mouseUp(const juce::MouseEvent&)
+{
+    if (!isSelecting)
+        return;
+
+    isSelecting = false;
+
+    if (onSelectionChanged)
+        onSelectionChanged(selectionStart, selectionEnd);
+}
+
+void WaveformDisplay::clearSelection()
+{
+    selectionStart = selectionEnd = 0.0;
+    invalidateContentLayer();
+}
+
+void WaveformDisplay::setLoopRange(double start, double end)
+{
+    loopStart = start;
+    loopEnd = end;
+    invalidateContentLayer();
+}
+
+double WaveformDisplay::getTimeForX(float x) const
+{
+    const double proportion = juce::jlimit(0.0, 1.0, static_cast<double>(x) / std::max(1, getWidth()));
+    return proportion * audioThumbnail.getTotalLength();
+}
+
+float WaveformDisplay::getXForTime(double time) const
+{
+    const double length = audioThumbnail.getTotalLength();
+    return length > 0.0 ? static_cast<float>(time / length * getWidth()) : 0.0f;
+}
@@ -10,6 +10,7 @@
 
 #pragma once
 #include <JuceHeader.h>
+#include "SpectrogramCache.h"
 
 // WaveformDisplay 类声明
 class WaveformDisplay : public juce::Component,
@@ -20,19 +21,60 @@ public:
     ~WaveformDisplay() override;
 
     void paint(juce::Graphics& g) override;
+    void resized() override;
     void changeListenerCallback(juce::ChangeBroadcaster* source) override;//当 AudioThumbnail 数据发生变化时，接收通知并更新显示。
     void setPosition(double position);//设置当前播放位置，用于在波形上显示播放指示线。
 
     void mouseDown(const juce::MouseEvent& event) override;//处理鼠标点击事件，支持用户点击波形来改变播放位置。
     std::function<void(double)> onPositionChanged;//当用户点击波形改变播放位置时，调用此回调函数通知外部组件。
+
+    // 按住 Shift 拖动选择一段区间（秒），可以用来设置 A/B 循环
+    void mouseDrag(const juce::MouseEvent& event) override;
+    void mouseUp(const juce::MouseEvent& event) override;
+    bool hasSelection() const { return selectionEnd > selectionStart; }
+    double getSelectionStart() const { return selectionStart; }
+    double getSelectionEnd() const { return selectionEnd; }
+    void clearSelection();
+    std::function<void(double, double)> onSelectionChanged;
+
+    // 显示当前的 A/B 循环区间，start >= end 表示没有循环
+    void setLoopRange(double start, double end);
+
+    // 显示波形还是频谱图；频谱图由外部的缓存在后台逐块计算
+    enum class DisplayMode { waveform, spectrogram };
+    void setSpectrogram(SpectrogramCache* cacheToUse);
+    void setDisplayMode(DisplayMode newMode);
+    DisplayMode getDisplayMode() const { return displayMode; }
     void setCurrentPosition(double newPosition)
         {
-            currentPosition = newPosition;
-            repaint();
+            setPosition(newPosition);
         }
 private:
+    void updateSpectrogramViewport();
+
+    // 波形/频谱图、循环区间、选区和边框画进缓存图像，内容变化时才重画；
+    // 播放位置移动时只重绘新旧两条竖线附近
+    void invalidateContentLayer();
+    void rebuildContentLayer();
+    int getPlayheadX() const;
+    void repaintPlayheadStrip(int x);
+    juce::Image contentLayer;
+    bool contentLayerValid = false;
+    int playheadX = -1;
+
     juce::AudioThumbnail& audioThumbnail;//用于绘制音频波形，引用juce::AudioThumbnail
     double currentPosition = 0.0;//当前播放位置
+    double getTimeForX(float x) const;
+    float getXForTime(double time) const;
+
+    // Shift 拖动的选区和循环区间（秒）
+    bool isSelecting = false;
+    double selectionAnchor = 0.0;
+    double selectionStart = 0.0, selectionEnd = 0.0;
+    double loopStart = 0.0, loopEnd = 0.0;
+
+    SpectrogramCache* spectrogram = nullptr;
+    DisplayMode displayMode = DisplayMode::waveform;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformDisplay)
 };
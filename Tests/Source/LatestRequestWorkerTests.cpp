@@ -0,0 +1,127 @@
+/*
+  ==============================================================================
+
+    LatestRequestWorkerTests.cpp
+    Created: 25 Oct 2026 4:12:07pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/LatestRequestWorker.h"
+
+class LatestRequestWorkerTests : public juce::UnitTest
+{
+public:
+    LatestRequestWorkerTests() : juce::UnitTest("LatestRequestWorker", "Workers") {}
+
+    void runTest() override
+    {
+        beginTest("onIdle fires when the last result is delivered before the worker records it");
+        {
+            LatestRequestWorker<int, int> worker("Test worker", juce::Thread::Priority::normal, 2000);
+            juce::WaitableEvent resultDelivered;
+            bool busyDuringResult = false;
+            int numResults = 0, numIdle = 0;
+
+            // 交出结果后等消息线程把它交给 onResult，才让 run 记下 finishedGeneration：
+            // 第一次 handleAsyncUpdate 交出结果时请求还算没做完
+            worker.process = [&](const int& request, int generation)
+            {
+                worker.emit(generation, request);
+                resultDelivered.wait(2000);
+            };
+            worker.onResult = [&](int)
+            {
+                ++numResults;
+                busyDuringResult = worker.isBusy();
+                resultDelivered.signal();
+            };
+            worker.onIdle = [&] { ++numIdle; };
+            worker.start();
+
+            worker.request(1);
+            expect(worker.isBusy());
+            pumpMessagesUntil([&] { return numIdle > 0; });
+
+            expectEquals(numResults, 1);
+            expect(busyDuringResult, "the interleaving was not reproduced");
+            expectEquals(numIdle, 1);
+            expect(!worker.isBusy());
+
+            worker.stop();
+        }
+
+        beginTest("superseded requests report idle once, after the latest one");
+        {
+            LatestRequestWorker<int, int> worker("Test worker", juce::Thread::Priority::normal, 2000);
+            juce::WaitableEvent release;
+            juce::Array<int> delivered;
+            int numIdle = 0;
+
+            worker.process = [&](const int& request, int generation)
+            {
+                if (request == 1)
+                    release.wait(2000);
+
+                worker.emit(generation, request);
+            };
+            worker.onResult = [&](int result) { delivered.add(result); };
+            worker.onIdle = [&] { ++numIdle; };
+            worker.start();
+
+            worker.request(1);
+            worker.request(2);
+            release.signal();
+            pumpMessagesUntil([&] { return numIdle > 0; });
+            pumpMessagesUntil([] { return false; }, 50);
+
+            expect(delivered == juce::Array<int> { 2 });
+            expectEquals(numIdle, 1);
+
+            worker.stop();
+        }
+
+        beginTest("cancel reports idle straight away");
+        {
+            LatestRequestWorker<int, int> worker("Test worker", juce::Thread::Priority::normal, 2000);
+            juce::WaitableEvent release;
+            int numResults = 0, numIdle = 0;
+
+            worker.process = [&](const int& request, int generation)
+            {
+                release.wait(2000);
+                worker.emit(generation, request);
+            };
+            worker.onResult = [&](int) { ++numResults; };
+            worker.onIdle = [&] { ++numIdle; };
+            worker.start();
+
+            worker.request(1);
+            worker.cancel();
+            expectEquals(numIdle, 1);
+            expect(!worker.isBusy());
+
+            release.signal();
+            pumpMessagesUntil([] { return false; }, 50);
+            expectEquals(numResults, 0);
+            expectEquals(numIdle, 1);
+
+            worker.stop();
+        }
+    }
+
+private:
+    // 跑消息循环直到条件成立或超时
+    template <typename Condition>
+    void pumpMessagesUntil(Condition condition, int timeoutMs = 2000)
+    {
+        const auto end = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(timeoutMs);
+
+        while (!condition() && juce::Time::getMillisecondCounter() < end)
+            juce::MessageManager::getInstance()->runDispatchLoopUntil(5);
+    }
+};
+
+static LatestRequestWorkerTests latestRequestWorkerTests;
@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    TestMain.cpp
+    Created: 25 Oct 2026 4:12:07pm
+    Author:  liann77
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+
+#include <iostream>
+
+// 跑所有注册过的 juce::UnitTest；有失败时返回 1，可以直接放进 CI：
+//   tests [--category 类别]
+int main(int argc, char* argv[])
+{
+    // 测试里要跑消息循环
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray arguments;
+    for (int i = 1; i < argc; ++i)
+        arguments.add(juce::CharPointer_UTF8(argv[i]));
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+
+    const int categoryIndex = arguments.indexOf("--category");
+    if (categoryIndex >= 0)
+        runner.runTestsInCategory(arguments[categoryIndex + 1]);
+    else
+        runner.runAllTests();
+
+    int failures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        failures += runner.getResult(i)->failures;
+
+    std::cerr << (failures == 0 ? "All tests passed" : juce::String(failures) + " failure(s)") << std::endl;
+    return failures == 0 ? 0 : 1;
+}